@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// YCSB like throughput of the ConcurrentHashTable versus a HashTable protected
+// by a reader-writer lock. Every thread performs a mix of reads and updates
+// (insertions of existing keys) over uniformly distributed keys:
+// workload C is read only, B has 5% of updates and A 50%.
+
+#include <stdio.h>
+#include <time.h>
+#include "c-container.h"
+
+#define NENTRIES (1 << 16)
+#define NOPS (1 << 19)
+#define MAXTHREADS 16
+#define NLOCKS 64
+
+struct threadArgs {
+	void *table;
+	unsigned int seed;
+	unsigned int updatePercent;
+};
+
+static pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+void *rwlockfunc(void *arg)
+{
+	struct threadArgs *args = arg;
+	HashTable *table = args->table;
+
+	for (size_t i = 0; i < NOPS; ++i) {
+		const int key = rand_r(&args->seed) % NENTRIES;
+
+		if ((unsigned int) rand_r(&args->seed) % 100 < args->updatePercent) {
+			pthread_rwlock_wrlock(&rwlock);
+			insertKeyHashTable(table, key, NULL);
+			pthread_rwlock_unlock(&rwlock);
+		} else {
+			pthread_rwlock_rdlock(&rwlock);
+			getKeyHashTable(table, key);
+			pthread_rwlock_unlock(&rwlock);
+		}
+	}
+
+	return NULL;
+}
+
+void *concurrentfunc(void *arg)
+{
+	struct threadArgs *args = arg;
+	ConcurrentHashTable *table = args->table;
+
+	for (size_t i = 0; i < NOPS; ++i) {
+		const int key = rand_r(&args->seed) % NENTRIES;
+
+		if ((unsigned int) rand_r(&args->seed) % 100 < args->updatePercent)
+			insertKeyConcurrentHashTable(table, key, NULL);
+		else
+			getKeyConcurrentHashTable(table, key, NULL, NULL);
+	}
+
+	return NULL;
+}
+
+double run(int concurrent, unsigned int updatePercent, size_t nThreads)
+{
+	HashTable hashTable;
+	ConcurrentHashTable concurrentTable;
+
+	if (concurrent) {
+		allocInitConcurrentHashTable(&concurrentTable, NENTRIES, NLOCKS);
+		for (int i = 0; i < NENTRIES; ++i)
+			insertKeyConcurrentHashTable(&concurrentTable, i, NULL);
+	} else {
+		allocInitHashTable(&hashTable, NENTRIES);
+		for (int i = 0; i < NENTRIES; ++i)
+			insertKeyHashTable(&hashTable, i, NULL);
+	}
+
+	pthread_t threads[MAXTHREADS];
+	struct threadArgs args[MAXTHREADS];
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < nThreads; ++i) {
+		args[i] = (struct threadArgs) {
+			concurrent ? (void *) &concurrentTable : (void *) &hashTable,
+			i + 1,
+			updatePercent
+		};
+		pthread_create(&threads[i], NULL,
+		               concurrent ? concurrentfunc : rwlockfunc, &args[i]);
+	}
+
+	for (size_t i = 0; i < nThreads; ++i)
+		pthread_join(threads[i], NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (concurrent)
+		freeConcurrentHashTable(&concurrentTable);
+	else
+		freeHashTable(&hashTable);
+
+	const double elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) * 1E-9;
+
+	return nThreads * NOPS / elapsed * 1E-6;
+}
+
+int main()
+{
+	const struct {
+		const char *name;
+		unsigned int updatePercent;
+	} workloads[] = {{"C (100/0)", 0}, {"B (95/5)", 5}, {"A (50/50)", 50}};
+
+	for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+		printf("Workload %s\n", workloads[w].name);
+		printf("%8s  %18s  %18s\n", "threads", "rwlock(Mop/s)", "concurrent(Mop/s)");
+
+		for (size_t nThreads = 1; nThreads <= MAXTHREADS; nThreads *= 2) {
+			printf("%8zu  %18.2f  %18.2f\n", nThreads,
+			       run(0, workloads[w].updatePercent, nThreads),
+			       run(1, workloads[w].updatePercent, nThreads));
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Lookup latency percentiles of the CuckooHashTable versus the chained
+// HashTable with the same number of slots (buckets for the HashTable) at
+// different load factors. The keys are random and all the lookups hit. The
+// latencies include the clock_gettime overhead.
+
+#include <stdio.h>
+#include <time.h>
+#include "c-container.h"
+
+#define NSLOTS (1 << 18)
+#define NOPS (1 << 20)
+
+static int keys[NSLOTS];
+static double latencies[NOPS];
+
+int compare(const void *a, const void *b)
+{
+	const double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static inline double elapsed(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1E9 + (end->tv_nsec - start->tv_nsec);
+}
+
+void report(const char *name, double load)
+{
+	qsort(latencies, NOPS, sizeof(double), compare);
+
+	printf("%-10s %5.2f %8.0f %8.0f %8.0f %8.0f\n", name, load,
+	       latencies[NOPS / 2],
+	       latencies[NOPS * 99 / 100],
+	       latencies[NOPS * 999 / 1000],
+	       latencies[NOPS - 1]);
+}
+
+void run(double load)
+{
+	const size_t entries = load * NSLOTS;
+	unsigned int seed = 1;
+
+	// Random distinct keys
+	CuckooHashTable cuckoo;
+	allocInitCuckooHashTable(&cuckoo, NSLOTS / 2);
+	assert(cuckoo.nBuckets * CUCKOO_HASH_TABLE_SLOTS == NSLOTS);
+
+	HashTable chained;
+	allocInitHashTable(&chained, NSLOTS);
+
+	for (size_t i = 0; i < entries; ) {
+		const int key = rand_r(&seed);
+		if (getKeyCuckooHashTable(&cuckoo, key) != NULL)
+			continue;
+
+		keys[i++] = key;
+		insertKeyCuckooHashTable(&cuckoo, key, NULL);
+		insertKeyHashTable(&chained, key, NULL);
+	}
+	assert(cuckoo.nBuckets * CUCKOO_HASH_TABLE_SLOTS == NSLOTS);
+
+	struct timespec start, end;
+
+	for (size_t i = 0; i < NOPS; ++i) {
+		const int key = keys[rand_r(&seed) % entries];
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		void **value = getKeyCuckooHashTable(&cuckoo, key);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		assert(value != NULL);
+		latencies[i] = elapsed(&start, &end);
+	}
+	report("cuckoo", load);
+
+	for (size_t i = 0; i < NOPS; ++i) {
+		const int key = keys[rand_r(&seed) % entries];
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		HashTableNode *node = getKeyHashTable(&chained, key);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		assert(node != NULL);
+		latencies[i] = elapsed(&start, &end);
+	}
+	report("chained", load);
+
+	freeCuckooHashTable(&cuckoo);
+	freeHashTable(&chained);
+}
+
+int main()
+{
+	printf("%-10s %5s %8s %8s %8s %8s\n", "lookup(ns)", "load", "p50", "p99", "p99.9", "max");
+
+	const double loads[] = {0.5, 0.75, 0.9, 0.95};
+	for (size_t i = 0; i < sizeof(loads) / sizeof(loads[0]); ++i)
+		run(loads[i]);
+
+	return 0;
+}
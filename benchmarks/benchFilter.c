@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Lookups with 80% of misses in a HashTable (load factor 2) and a BinaryTree
+// without filter and with each type of Filter attached. The false positive
+// rate is the fraction of the absent keys the filter let through.
+
+#include <stdio.h>
+#include <time.h>
+#include "c-container.h"
+
+#define NENTRIES (1 << 18)
+#define NLOOKUPS (1 << 22)
+#define MISS_PERCENT 80
+
+static int keys[NENTRIES];
+static int lookups[NLOOKUPS];
+
+static const char *names[] = {"none", "bloom", "cuckoo"};
+
+double elapsed(const struct timespec *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) * 1E-9;
+}
+
+void report(const char *container, FilterType type, const Filter *filter,
+            double seconds, double reference, size_t found)
+{
+	double rate = 0;
+	if (filter != NULL) {
+		const size_t absent = NLOOKUPS - found;
+		rate = 100.0 * (absent - filter->negatives) / absent;
+	}
+
+	printf("%-10s %-7s %10.2f %8.2f %8.3f\n", container, names[type],
+	       NLOOKUPS / seconds * 1E-6, reference / seconds, rate);
+}
+
+int main()
+{
+	unsigned int seed = 1;
+	for (size_t i = 0; i < NENTRIES; ++i)
+		keys[i] = rand_r(&seed);
+
+	// The random keys are absent with high probability.
+	for (size_t i = 0; i < NLOOKUPS; ++i) {
+		const int r = rand_r(&seed);
+		lookups[i] = (r % 100 < MISS_PERCENT) ? rand_r(&seed) : keys[r % NENTRIES];
+	}
+
+	printf("%-10s %-7s %10s %8s %8s\n", "container", "filter", "Mop/s", "speedup", "fp %");
+
+	double reference = 0;
+
+	for (FilterType type = FILTER_NONE; type <= FILTER_CUCKOO; ++type) {
+		HashTable table;
+		allocInitHashTable(&table, NENTRIES / 2);
+
+		for (size_t i = 0; i < NENTRIES; ++i)
+			insertKeyHashTable(&table, keys[i], NULL);
+		setFilterHashTable(&table, type);
+		if (table.filter != NULL)
+			setCountersFilter(table.filter, 1);
+
+		size_t found = 0;
+
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (size_t i = 0; i < NLOOKUPS; ++i)
+			found += getKeyHashTable(&table, lookups[i]) != NULL;
+		const double seconds = elapsed(&start);
+
+		reference = (type == FILTER_NONE) ? seconds : reference;
+		report("HashTable", type, table.filter, seconds, reference, found);
+
+		freeHashTable(&table);
+	}
+
+	for (FilterType type = FILTER_NONE; type <= FILTER_CUCKOO; ++type) {
+		BinaryTree tree;
+		allocInitBinaryTree(&tree);
+
+		for (size_t i = 0; i < NENTRIES; ++i)
+			insertBinaryTree(&tree, keys[i], NULL);
+		setFilterBinaryTree(&tree, type);
+		if (tree.filter != NULL)
+			setCountersFilter(tree.filter, 1);
+
+		size_t found = 0;
+
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (size_t i = 0; i < NLOOKUPS; ++i)
+			found += getKeyBinaryTree(&tree, lookups[i]) != NULL;
+		const double seconds = elapsed(&start);
+
+		reference = (type == FILTER_NONE) ? seconds : reference;
+		report("BinaryTree", type, tree.filter, seconds, reference, found);
+
+		freeBinaryTree(&tree);
+	}
+
+	return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Build time and memory of a FrozenHashTable and random lookups (all hits)
+// compared with the HashTable it was built from, one by one and batched.
+
+#include <stdio.h>
+#include <time.h>
+#include "c-container.h"
+
+#define NENTRIES (1 << 20)
+#define NLOOKUPS (1 << 22)
+#define BATCH 256
+
+static int keys[NENTRIES];
+static int lookups[NLOOKUPS];
+static const void *values[BATCH];
+
+double elapsed(const struct timespec *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) * 1E-9;
+}
+
+int main()
+{
+	HashTable table;
+	allocInitHashTable(&table, NENTRIES);
+
+	unsigned int seed = 1;
+	for (size_t i = 0; i < NENTRIES; ) {
+		const int key = rand_r(&seed);
+		if (getKeyHashTable(&table, key) != NULL)
+			continue;
+
+		int *value = malloc(sizeof(int));
+		*value = key;
+		insertKeyHashTable(&table, key, value);
+		keys[i++] = key;
+	}
+
+	for (size_t i = 0; i < NLOOKUPS; ++i)
+		lookups[i] = keys[rand_r(&seed) % NENTRIES];
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	FrozenHashTable frozen;
+	const int ret = freezeHashTable(&table, &frozen, sizeof(int));
+	assert(ret == 0);
+
+	const double build = elapsed(&start);
+	const double bits = 8.0 * (frozen.nBuckets * sizeof(uint16_t)
+	                           + (frozen.nSlots - frozen.entries) * sizeof(uint32_t));
+
+	printf("Build %zu keys: %.3f s, hash function %.2f bits/key, %zu bytes total\n",
+	       frozen.entries, build, bits / frozen.entries, frozen.bufferSize);
+
+	size_t sum = 0;
+	double seconds[3];
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (size_t i = 0; i < NLOOKUPS; ++i)
+		sum += *(int *) getKeyHashTable(&table, lookups[i])->value;
+	seconds[0] = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (size_t i = 0; i < NLOOKUPS; ++i)
+		sum += *(const int *) getKeyFrozenHashTable(&frozen, lookups[i]);
+	seconds[1] = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (size_t i = 0; i < NLOOKUPS; i += BATCH) {
+		const size_t found = getKeysFrozenHashTable(&frozen, &lookups[i], BATCH, values);
+		assert(found == BATCH);
+
+		for (size_t j = 0; j < BATCH; ++j)
+			sum += *(const int *) values[j];
+	}
+	seconds[2] = elapsed(&start);
+
+	printf("%-10s %10s %8s\n", "lookups", "Mop/s", "speedup");
+	printf("%-10s %10.2f %8.2f\n", "HashTable", NLOOKUPS / seconds[0] * 1E-6, 1.0);
+	printf("%-10s %10.2f %8.2f\n", "frozen", NLOOKUPS / seconds[1] * 1E-6, seconds[0] / seconds[1]);
+	printf("%-10s %10.2f %8.2f\n", "batched", NLOOKUPS / seconds[2] * 1E-6, seconds[0] / seconds[2]);
+	printf("(checksum %zu)\n", sum);
+
+	freeFrozenHashTable(&frozen);
+	freeHashTable(&table);
+
+	return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Lookups in the HashTable vs the InlineHashTable with the same number of
+// buckets and entries. Every HashTable key comparison dereferences a node
+// while the InlineHashTable resolves most of them in the bucket header.
+
+#include <stdio.h>
+#include <time.h>
+#include "c-container.h"
+
+#define NBUCKETS (1 << 18)
+#define NLOOKUPS (1 << 23)
+
+static int keys[NBUCKETS * 2];
+
+double elapsed(const struct timespec *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) * 1E-9;
+}
+
+int main()
+{
+	const double loads[] = {0.5, 1.0, 2.0};
+
+	printf("%6s %12s %12s %12s %12s\n", "load",
+	       "hit Mop/s", "inline", "miss Mop/s", "inline");
+
+	for (size_t l = 0; l < sizeof(loads) / sizeof(loads[0]); ++l) {
+		const size_t nEntries = loads[l] * NBUCKETS;
+		unsigned int seed = 1;
+
+		HashTable table;
+		allocInitHashTable(&table, NBUCKETS);
+
+		InlineHashTable inlineTable;
+		allocInitInlineHashTable(&inlineTable, NBUCKETS);
+
+		for (size_t i = 0; i < nEntries; ) {
+			const int key = rand_r(&seed);
+			if (getKeyInlineHashTable(&inlineTable, key) != NULL)
+				continue;
+
+			keys[i++] = key;
+			insertKeyHashTable(&table, key, NULL);
+			insertKeyInlineHashTable(&inlineTable, key, NULL);
+		}
+
+		double seconds[4];
+		size_t found = 0;
+		struct timespec start;
+
+		// Hits
+		seed = 2;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (size_t i = 0; i < NLOOKUPS; ++i)
+			found += getKeyHashTable(&table, keys[rand_r(&seed) % nEntries]) != NULL;
+		seconds[0] = elapsed(&start);
+
+		seed = 2;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (size_t i = 0; i < NLOOKUPS; ++i)
+			found += getKeyInlineHashTable(&inlineTable, keys[rand_r(&seed) % nEntries]) != NULL;
+		seconds[1] = elapsed(&start);
+
+		assert(found == 2 * NLOOKUPS);
+
+		// Misses (most of them)
+		seed = 3;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (size_t i = 0; i < NLOOKUPS; ++i)
+			found += getKeyHashTable(&table, rand_r(&seed)) != NULL;
+		seconds[2] = elapsed(&start);
+
+		seed = 3;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (size_t i = 0; i < NLOOKUPS; ++i)
+			found += getKeyInlineHashTable(&inlineTable, rand_r(&seed)) != NULL;
+		seconds[3] = elapsed(&start);
+
+		printf("%6.2f", loads[l]);
+		for (int i = 0; i < 4; ++i)
+			printf(" %12.2f", NLOOKUPS / seconds[i] * 1E-6);
+		printf("\n");
+
+		freeInlineHashTable(&inlineTable);
+		freeHashTable(&table);
+	}
+
+	return 0;
+}
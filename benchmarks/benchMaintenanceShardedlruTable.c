@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Insert latency percentiles of the ShardedlruTable with the evictions inline
+// and with the background maintenance thread.
+
+#include <stdio.h>
+#include <time.h>
+#include "c-container.h"
+
+#define NENTRIES (1 << 16)
+#define NSHARDS 16
+#define NOPS (1 << 20)
+#define VALUESIZE 256
+
+static double latencies[NOPS];
+
+int compare(const void *a, const void *b)
+{
+	const double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+void run(const char *name, size_t highPercent, size_t lowPercent)
+{
+	ShardedlruTable table;
+	allocInitShardedlruTable(&table, NSHARDS, NENTRIES);
+
+	if (highPercent > 0)
+		startMaintenanceShardedlruTable(&table, highPercent, lowPercent);
+
+	unsigned int seed = 1;
+
+	for (size_t i = 0; i < NOPS; ++i) {
+		const int key = rand_r(&seed) % (4 * NENTRIES);
+		void *value = malloc(VALUESIZE);
+
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		insertKeyShardedlruTable(&table, key, value);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		latencies[i] = (end.tv_sec - start.tv_sec) * 1E9
+			+ (end.tv_nsec - start.tv_nsec);
+	}
+
+	freeShardedlruTable(&table);
+
+	qsort(latencies, NOPS, sizeof(double), compare);
+
+	printf("%-24s %10.0f %10.0f %10.0f %10.0f\n", name,
+	       latencies[NOPS / 2],
+	       latencies[NOPS * 99 / 100],
+	       latencies[NOPS * 999 / 1000],
+	       latencies[NOPS - 1]);
+}
+
+int main()
+{
+	printf("%-24s %10s %10s %10s %10s\n",
+	       "insert latency (ns)", "p50", "p99", "p99.9", "max");
+
+	run("inline eviction", 0, 0);
+	run("maintenance 90%-75%", 90, 75);
+	run("maintenance 75%-50%", 75, 50);
+
+	return 0;
+}
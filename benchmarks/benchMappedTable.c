@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Startup cost of a big HashTable: rebuilding it from an image (like parsing
+// a dump and inserting every key) vs mapping the image and querying it in
+// place, and the lookup throughput of both.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "c-container.h"
+
+#define NENTRIES (1 << 20)
+#define NLOOKUPS (1 << 22)
+#define VALUE_SIZE 16
+
+static int lookups[NLOOKUPS];
+
+double elapsed(const struct timespec *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) * 1E-9;
+}
+
+size_t serialize(const void *value, void *buffer, size_t size, void *arg)
+{
+	if (size >= VALUE_SIZE)
+		memcpy(buffer, value, VALUE_SIZE);
+	return VALUE_SIZE;
+}
+
+int main()
+{
+	char filename[] = "/tmp/benchMappedTable.XXXXXX";
+	const int fd = mkstemp(filename);
+	assert(fd >= 0);
+	close(fd);
+
+	HashTable table;
+	allocInitHashTable(&table, NENTRIES);
+
+	unsigned int seed = 1;
+	for (int i = 0; i < NENTRIES; ++i) {
+		int *value = calloc(1, VALUE_SIZE);
+		*value = i;
+		insertKeyHashTable(&table, i, value);
+	}
+
+	for (size_t i = 0; i < NLOOKUPS; ++i)
+		lookups[i] = rand_r(&seed) % NENTRIES;
+
+	assert(dumpMappedHashTable(&table, filename, serialize, NULL) == 0);
+	freeHashTable(&table);
+
+	struct timespec start;
+	double seconds[4];
+
+	// Rebuild
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	MappedTable mapped;
+	assert(openMappedTable(&mapped, filename, 0) == 0);
+	allocInitHashTable(&table, NENTRIES);
+	thawMappedHashTable(&mapped, &table, NULL, NULL);
+	freeMappedTable(&mapped);
+	seconds[0] = elapsed(&start);
+
+	// Map
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	assert(openMappedTable(&mapped, filename, 0) == 0);
+	seconds[1] = elapsed(&start);
+
+	size_t sum = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (size_t i = 0; i < NLOOKUPS; ++i)
+		sum += *(int *) getKeyHashTable(&table, lookups[i])->value;
+	seconds[2] = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (size_t i = 0; i < NLOOKUPS; ++i)
+		sum += *(const int *) getKeyMappedTable(&mapped, lookups[i], NULL);
+	seconds[3] = elapsed(&start);
+
+	printf("%d entries, image of %zu bytes\n", NENTRIES, mapped.mapSize);
+	printf("%-10s %12s %12s\n", "", "startup ms", "lookup Mop/s");
+	printf("%-10s %12.3f %12.2f\n", "HashTable", seconds[0] * 1E3, NLOOKUPS / seconds[2] * 1E-6);
+	printf("%-10s %12.3f %12.2f\n", "mapped", seconds[1] * 1E3, NLOOKUPS / seconds[3] * 1E-6);
+	printf("(checksum %zu)\n", sum);
+
+	freeMappedTable(&mapped);
+	freeHashTable(&table);
+	unlink(filename);
+
+	return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Probe length distribution of the RobinHoodHashTable during a long churn
+// run: the table is filled at 85% and then every step removes a random key
+// and inserts a new one, like session keys do. Without tombstones the
+// distribution must stay stable.
+
+#include <stdio.h>
+#include <time.h>
+#include "c-container.h"
+
+#define NSLOTS (1 << 18)
+#define LOAD (NENTRIES / (double) NSLOTS)
+#define NENTRIES (NSLOTS / 100 * 85)
+#define NSTEPS (1 << 22)
+#define NREPORTS 4
+
+static int keys[NENTRIES];
+
+void report(RobinHoodHashTable *table, size_t steps, double seconds)
+{
+	const size_t limits[] = {1, 2, 3, 4, 8, 16, 32};
+	const size_t nLimits = sizeof(limits) / sizeof(limits[0]);
+	size_t histogram[sizeof(limits) / sizeof(limits[0]) + 1] = {0};
+
+	size_t total = 0, max = 0;
+
+	for (size_t i = 0; i < table->N; ++i) {
+		const size_t distance = table->table[i].distance;
+		if (distance == 0)
+			continue;
+
+		size_t bin = 0;
+		while (bin < nLimits && distance > limits[bin])
+			++bin;
+
+		histogram[bin]++;
+		total += distance;
+		max = distance > max ? distance : max;
+	}
+
+	printf("%10zu %8.2f %6.2f %4zu", steps, steps / seconds * 1E-6,
+	       (double) total / table->entries, max);
+
+	for (size_t bin = 0; bin <= nLimits; ++bin)
+		printf(" %6.2f", 100.0 * histogram[bin] / table->entries);
+	printf("\n");
+}
+
+int main()
+{
+	RobinHoodHashTable table;
+	allocInitRobinHoodHashTable(&table, NENTRIES);
+	assert(table.N == NSLOTS);
+
+	unsigned int seed = 1;
+
+	for (size_t i = 0; i < NENTRIES; ) {
+		const int key = rand_r(&seed);
+		if (getKeyRobinHoodHashTable(&table, key) != NULL)
+			continue;
+
+		keys[i++] = key;
+		insertKeyRobinHoodHashTable(&table, key, NULL);
+	}
+
+	printf("Probe length (%% of keys) at load %.2f\n", LOAD);
+	printf("%10s %8s %6s %4s %6s %6s %6s %6s %6s %6s %6s %6s\n",
+	       "churn", "Mop/s", "mean", "max",
+	       "1", "2", "3", "4", "5-8", "9-16", "17-32", ">32");
+
+	report(&table, 0, 1);
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t step = 1; step <= NSTEPS; ++step) {
+		const size_t victim = rand_r(&seed) % NENTRIES;
+
+		int key;
+		do {
+			key = rand_r(&seed);
+		} while (getKeyRobinHoodHashTable(&table, key) != NULL);
+
+		popKeyRobinHoodHashTable(&table, keys[victim]);
+		insertKeyRobinHoodHashTable(&table, key, NULL);
+		keys[victim] = key;
+
+		if (step % (NSTEPS / NREPORTS) == 0) {
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			const double seconds = (end.tv_sec - start.tv_sec)
+				+ (end.tv_nsec - start.tv_nsec) * 1E-9;
+			report(&table, step, seconds);
+		}
+	}
+
+	assert(table.N == NSLOTS);
+	freeRobinHoodHashTable(&table);
+
+	return 0;
+}
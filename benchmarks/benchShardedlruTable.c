@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Hit throughput of the ShardedlruTable versus the number of threads. A table
+// with a single shard is equivalent to a lruTable protected by a global lock.
+
+#include <stdio.h>
+#include <time.h>
+#include "c-container.h"
+
+#define NENTRIES (1 << 16)
+#define NOPS (1 << 20)
+#define MAXTHREADS 16
+
+struct threadArgs {
+	ShardedlruTable *table;
+	unsigned int seed;
+	size_t hits;
+};
+
+void *threadfunc(void *arg)
+{
+	struct threadArgs *args = arg;
+
+	for (size_t i = 0; i < NOPS; ++i) {
+		const int key = rand_r(&args->seed) % NENTRIES;
+		args->hits += getKeyShardedlruTable(args->table, key, NULL, NULL);
+	}
+
+	return NULL;
+}
+
+double run(size_t nShards, size_t nThreads)
+{
+	ShardedlruTable table;
+	allocInitShardedlruTable(&table, nShards, NENTRIES);
+
+	// Per shard capacity is rounded, so leave some margin to have all hits.
+	for (int i = 0; i < NENTRIES - nShards; ++i)
+		insertKeyShardedlruTable(&table, i, NULL);
+
+	pthread_t threads[MAXTHREADS];
+	struct threadArgs args[MAXTHREADS];
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < nThreads; ++i) {
+		args[i] = (struct threadArgs) {&table, i + 1, 0};
+		pthread_create(&threads[i], NULL, threadfunc, &args[i]);
+	}
+
+	size_t hits = 0;
+	for (size_t i = 0; i < nThreads; ++i) {
+		pthread_join(threads[i], NULL);
+		hits += args[i].hits;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	freeShardedlruTable(&table);
+
+	const double elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) * 1E-9;
+
+	return hits / elapsed * 1E-6;
+}
+
+int main()
+{
+	const size_t shards[] = {1, 16, 64};
+
+	printf("%8s", "threads");
+	for (size_t s = 0; s < sizeof(shards) / sizeof(shards[0]); ++s)
+		printf("  %4zu shards(Mhit/s)", shards[s]);
+	printf("\n");
+
+	for (size_t nThreads = 1; nThreads <= MAXTHREADS; nThreads *= 2) {
+		printf("%8zu", nThreads);
+		for (size_t s = 0; s < sizeof(shards) / sizeof(shards[0]); ++s)
+			printf("  %20.2f", run(shards[s], nThreads));
+		printf("\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// The HashTable and BinaryTree with a malloc'ed 16 bytes value per entry vs
+// the type specialized ones from c-container-typed.h with the value inline.
+
+#include <stdio.h>
+#include <time.h>
+#include "c-container.h"
+#include "c-container-typed.h"
+
+#define NENTRIES (1 << 20)
+#define NLOOKUPS (1 << 23)
+#define NTREE (1 << 18)
+
+typedef struct Point {
+	double x, y;
+} Point;
+
+DEFINE_HASH_TABLE_TYPED(PointHashTable, int64_t, Point, hashIntegerTyped, EQUAL_SCALAR_TYPED)
+
+DEFINE_BINARY_TREE_TYPED(PointBinaryTree, int64_t, Point, COMPARE_SCALAR_TYPED)
+
+static int keys[NENTRIES];
+
+double elapsed(const struct timespec *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) * 1E-9;
+}
+
+Point *newPoint(int value)
+{
+	Point *ret = malloc(sizeof(Point));
+	ret->x = value;
+	ret->y = -value;
+	return ret;
+}
+
+void printRow(const char *name, size_t n, const double seconds[2])
+{
+	printf("%-16s %12.2f %12.2f %8.2fx\n", name,
+	       n / seconds[0] * 1E-6, n / seconds[1] * 1E-6, seconds[0] / seconds[1]);
+}
+
+void benchHashTable()
+{
+	double seconds[2];
+	struct timespec start;
+	double sum[2] = {0, 0};
+
+	HashTable table;
+	PointHashTable typed;
+
+	// Both start small and grow
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	allocInitHashTable(&table, 1024);
+	for (size_t i = 0; i < NENTRIES; ++i) {
+		insertKeyHashTable(&table, keys[i], newPoint(i));
+		if (table.entries > table.N && table.oldTable == NULL)
+			rehashHashTable(&table, 2 * table.N);
+	}
+	seconds[0] = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	allocInitPointHashTable(&typed, 1024);
+	for (size_t i = 0; i < NENTRIES; ++i)
+		insertKeyPointHashTable(&typed, keys[i], (Point) {i, -(double) i});
+	seconds[1] = elapsed(&start);
+	printRow("hash insert", NENTRIES, seconds);
+
+	unsigned int seed = 2;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (size_t i = 0; i < NLOOKUPS; ++i) {
+		HashTableNode *node = getKeyHashTable(&table, keys[rand_r(&seed) % NENTRIES]);
+		sum[0] += ((Point *) node->value)->x;
+	}
+	seconds[0] = elapsed(&start);
+
+	seed = 2;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (size_t i = 0; i < NLOOKUPS; ++i) {
+		PointHashTableNode *node = getKeyPointHashTable(&typed, keys[rand_r(&seed) % NENTRIES]);
+		sum[1] += node->value.x;
+	}
+	seconds[1] = elapsed(&start);
+	assert(sum[0] == sum[1]);
+	printRow("hash lookup", NLOOKUPS, seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	freeHashTable(&table);
+	seconds[0] = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	freePointHashTable(&typed);
+	seconds[1] = elapsed(&start);
+	printRow("hash free", NENTRIES, seconds);
+}
+
+void benchBinaryTree()
+{
+	double seconds[2];
+	struct timespec start;
+	double sum[2] = {0, 0};
+
+	BinaryTree tree;
+	PointBinaryTree typed;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	allocInitBinaryTree(&tree);
+	for (size_t i = 0; i < NTREE; ++i)
+		insertBinaryTree(&tree, keys[i], newPoint(i));
+	seconds[0] = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	allocInitPointBinaryTree(&typed);
+	for (size_t i = 0; i < NTREE; ++i)
+		insertKeyPointBinaryTree(&typed, keys[i], (Point) {i, -(double) i});
+	seconds[1] = elapsed(&start);
+	printRow("tree insert", NTREE, seconds);
+
+	unsigned int seed = 3;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (size_t i = 0; i < NLOOKUPS; ++i) {
+		BinaryTreeNode *node = getKeyBinaryTree(&tree, keys[rand_r(&seed) % NTREE]);
+		sum[0] += ((Point *) node->value)->x;
+	}
+	seconds[0] = elapsed(&start);
+
+	seed = 3;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (size_t i = 0; i < NLOOKUPS; ++i) {
+		PointBinaryTreeNode *node = getKeyPointBinaryTree(&typed, keys[rand_r(&seed) % NTREE]);
+		sum[1] += node->value.x;
+	}
+	seconds[1] = elapsed(&start);
+	assert(sum[0] == sum[1]);
+	printRow("tree lookup", NLOOKUPS, seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	freeBinaryTree(&tree);
+	seconds[0] = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	freePointBinaryTree(&typed);
+	seconds[1] = elapsed(&start);
+	printRow("tree free", NTREE, seconds);
+}
+
+int main()
+{
+	// Unique random keys
+	HashTable unique;
+	allocInitHashTable(&unique, NENTRIES);
+
+	unsigned int seed = 1;
+	for (size_t i = 0; i < NENTRIES; ) {
+		const int key = rand_r(&seed);
+		if (getKeyHashTable(&unique, key) != NULL)
+			continue;
+		insertKeyHashTable(&unique, key, NULL);
+		keys[i++] = key;
+	}
+	freeHashTable(&unique);
+
+	printf("%-16s %12s %12s %9s\n", "Mop/s", "void*", "typed", "speedup");
+	benchHashTable();
+	benchBinaryTree();
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Trace replay benchmark for the lruTable eviction policies. It reports the
+// hit ratio and throughput of every policy on two traces: keys following a
+// Zipf distribution, and the same trace mixed with periodic scans of one-off
+// keys. Every miss inserts the key like a cache does after reading from the
+// backing store.
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "c-container.h"
+
+#define NKEYS (1 << 17)
+#define NENTRIES (1 << 13)
+#define NOPS (1 << 21)
+#define ZIPF_S 0.99
+#define SCAN_PERIOD (1 << 16)
+#define SCAN_LENGTH (2 * NENTRIES)
+
+static int trace[NOPS];
+
+void fillZipfTrace(int *out, size_t n, size_t nKeys, double s)
+{
+	double *cdf = malloc(nKeys * sizeof(double));
+
+	double sum = 0;
+	for (size_t i = 0; i < nKeys; ++i)
+		cdf[i] = (sum += 1.0 / pow(i + 1, s));
+
+	for (size_t i = 0; i < n; ++i) {
+		const double u = (double) rand() / RAND_MAX * sum;
+
+		size_t lo = 0, hi = nKeys - 1;
+		while (lo < hi) {
+			const size_t mid = (lo + hi) / 2;
+			if (cdf[mid] < u)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		// Scatter the popular keys in the key space.
+		out[i] = (int)((lo * 2654435761u) % NKEYS);
+	}
+
+	free(cdf);
+}
+
+void addScans(int *out, size_t n)
+{
+	// Scans use keys out of the Zipf key space, so they are all one-off.
+	int scanKey = NKEYS;
+
+	for (size_t start = SCAN_PERIOD; start < n; start += SCAN_PERIOD) {
+		for (size_t i = start; i < start + SCAN_LENGTH && i < n; ++i)
+			out[i] = scanKey++;
+	}
+}
+
+void run(const char *name, lruTablePolicy policy)
+{
+	lruTable table;
+	allocInitPolicylruTable(&table, NENTRIES, policy);
+
+	size_t hits = 0;
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < NOPS; ++i) {
+		if (getKeylruTable(&table, trace[i]) != NULL)
+			++hits;
+		else
+			insertKeylruTable(&table, trace[i], NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	freelruTable(&table);
+
+	const double elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) * 1E-9;
+
+	printf("%10s %12.2f%% %14.2f\n",
+	       name, 100.0 * hits / NOPS, NOPS / elapsed * 1E-6);
+}
+
+void runAll(const char *traceName)
+{
+	printf("Trace: %s\n", traceName);
+	printf("%10s %13s %14s\n", "policy", "hit ratio", "Mops/s");
+	run("LRU", LRU_TABLE_POLICY_LRU);
+	run("CLOCK", LRU_TABLE_POLICY_CLOCK);
+	run("2Q", LRU_TABLE_POLICY_2Q);
+	run("ARC", LRU_TABLE_POLICY_ARC);
+	run("W-TinyLFU", LRU_TABLE_POLICY_TINYLFU);
+}
+
+int main()
+{
+	fillZipfTrace(trace, NOPS, NKEYS, ZIPF_S);
+	runAll("Zipf");
+
+	addScans(trace, NOPS);
+	runAll("Zipf + scans");
+
+	return 0;
+}
@@ -20,14 +20,38 @@
 #ifndef C_CONTAINER_INTERNAL_H
 #define C_CONTAINER_INTERNAL_H
 
+#include <stdint.h>
 #include "c-container.h"
+// Filter
+
+size_t _rebuildCapacityFilter(const Filter *in, size_t entries);
+
+// Byte String Keys
+
+//! Size of a node of type with an inline #BytesKey of length bytes.
+#define BYTES_KEY_NODE_SIZE(type, length) \
+	(sizeof(type) + sizeof(BytesKey) + (length))
+
+//! The #BytesKey stored after a node of type.
+#define BYTES_KEY_NODE(type, node) ((BytesKey *) ((type *) (node) + 1))
+
+void _initBytesKey(BytesKey *out, uint64_t hash, const void *bytes, size_t length);
+
+int _equalBytesKey(const BytesKey *in, uint64_t hash, const void *bytes, size_t length);
+
+// Value Ownership
+
+void *_cloneValue(const ValueOps *ops, void *value);
+
+void _destroyValue(const ValueOps *ops, void *value);
+
 // Linked List
 
 LinkedListNode *_allocInitLinkedListNode(
 	LinkedListNode *node, int key, void *value
 );
 
-void _freeLinkedListNode(LinkedListNode *node);
+void _freeLinkedListNode(LinkedListNode *node, const ValueOps *ops);
 
 LinkedListNode **_getRefKeyLinkedList(LinkedList *out, int key);
 
@@ -51,8 +75,184 @@ DoubleLinkedListNode *_extractNodeDoubleLinkedList(
 
 size_t _hashFunction(HashTable *in, size_t key);
 
+DoubleLinkedList *_getBucketHashTable(HashTable *in, int key);
+
+void _rehashStepHashTable(HashTable *out, size_t steps);
+
 HashTableNode *_extractNodeHashTable(HashTable *out, HashTableNode *node);
 
 HashTableNode *_insertNodeHashTable(HashTable *out, HashTableNode *node);
 
+HashTableNode *_linkNodeHashTable(HashTable *out, HashTableNode *node);
+
+HashTableNode *_getBytesKeyNodeHashTable(
+	HashTable *in, uint64_t hash, const void *key, size_t length, size_t nodeSize
+);
+
+void _setFilterHashTable(HashTable *out, FilterType type, size_t capacity);
+
+// LRU Table
+
+//! Access list with its own counter, used for the extra segments.
+typedef struct lruTableList {
+	lruTableNode *accesList;
+	lruTableNode *lastAccess;
+	size_t entries;
+} lruTableList;
+
+//! Values for lruTableNode#segment. Ghost segments are never 0.
+enum lruTableSegment {
+	LRU_TABLE_SEGMENT_MAIN = 0,       // lruTable#accesList (2Q Am, ARC T2, TinyLFU protected)
+	LRU_TABLE_SEGMENT_WINDOW,         // 2Q A1in, ARC T1, TinyLFU window
+	LRU_TABLE_SEGMENT_PROBATION,      // TinyLFU probation
+	LRU_TABLE_SEGMENT_GHOST_RECENT,   // 2Q A1out, ARC B1
+	LRU_TABLE_SEGMENT_GHOST_FREQUENT  // ARC B2
+};
+
+//! Count-min sketch with 4 bits counters packed in 64 bits words.
+typedef struct lruTableSketch {
+	uint64_t *table;     // 4 rows of width counters
+	size_t width;        // Counters per row (power of 2)
+	size_t additions;    // Increments since the last aging
+	size_t sampleSize;   // Increments between agings (halving all counters)
+} lruTableSketch;
+
+struct lruTablePolicyData {
+	lruTableList window;
+	lruTableList probation;
+	size_t windowMax;           // 2Q Kin, TinyLFU window size
+	size_t protectedMax;        // TinyLFU protected (main) size
+
+	HashTable ghosts;           // Ghost nodes have no value
+	lruTableList ghostRecent;
+	lruTableList ghostFrequent;
+	size_t ghostMax;            // 2Q Kout
+
+	size_t target;              // ARC p (target size for T1)
+	lruTableSketch sketch;
+};
+
+lruTableNode *_allocInitlruTableNode(lruTableNode *node, int key, void *value);
+
+void _disconnectlruTableList(
+	lruTableNode **first, lruTableNode **last, lruTableNode *node
+);
+
+void _registerlruTableList(
+	lruTableNode **first, lruTableNode **last, lruTableNode *node
+);
+
+void _disconnectlruTableNodeAccess(lruTable *in, lruTableNode *node);
+
+void _registerNodeAccess(lruTable *in, lruTableNode *node);
+
+lruTableNode *_evictOnelruTable(lruTable *out, int ghost);
+
+void _removeNodelruTable(
+	lruTable *out, lruTableNode *node, lruTableRemovalCause cause
+);
+
+//! Counters have a single writer (the table owner) and concurrent readers.
+static inline void _relaxedIncrement(size_t *counter)
+{
+	__atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1,
+	                 __ATOMIC_RELAXED);
+}
+
+// LRU Table policies
+
+void _allocInitPolicyDatalruTable(lruTable *out);
+
+void _resizePolicyDatalruTable(lruTable *out);
+
+void _freePolicyDatalruTable(lruTable *out);
+
+int _missPolicylruTable(lruTable *in, int key);
+
+lruTableNode *_getVictimPolicylruTable(lruTable *in, int ghost);
+
+void _disconnectPolicylruTable(lruTable *in, lruTableNode *node);
+
+void _reattachPolicylruTable(lruTable *in, lruTableNode *node, int segment);
+
+void _evictPolicylruTable(lruTable *in, lruTableNode *node);
+
+void _placePolicylruTable(lruTable *in, lruTableNode *node, int ghost);
+
+void _hitPolicylruTable(lruTable *in, lruTableNode *node);
+
+// LRU Table timer wheel
+
+#define LRU_TABLE_WHEEL_BITS 6
+#define LRU_TABLE_WHEEL_SLOTS (1 << LRU_TABLE_WHEEL_BITS)
+#define LRU_TABLE_WHEEL_LEVELS 4
+
+//! Expiration timer of a node, only allocated for the nodes with a TTL.
+struct lruTableTimer {
+	uint64_t deadline;           // Expiration time
+	lruTableNode *node;          // Node expired by this timer
+	struct lruTableTimer *next;  // Next timer in the same wheel slot
+	struct lruTableTimer **ref;  // Pointer to the reference to this timer in the slot
+	unsigned char level;         // Wheel level holding the timer
+};
+
+//! Hierarchical timer wheel, level l has slots of 64^l ticks.
+struct lruTableTimerWheel {
+	uint64_t current;   // Last processed tick
+	size_t timers;      // Number of scheduled nodes
+	size_t levelTimers[LRU_TABLE_WHEEL_LEVELS]; // Scheduled nodes per level
+	struct lruTableTimer *slots[LRU_TABLE_WHEEL_LEVELS][LRU_TABLE_WHEEL_SLOTS];
+};
+
+//! Expiration time of a node or 0 when it never expires.
+static inline uint64_t _getDeadlinelruTableNode(const lruTableNode *node)
+{
+	return node->timer != NULL ? node->timer->deadline : 0;
+}
+
+//! Set the expiration time of a node, 0 cancels the timer.
+void _scheduleTimerlruTable(lruTable *in, lruTableNode *node, uint64_t deadline);
+
+void _cancelTimerlruTable(lruTable *in, lruTableNode *node);
+
+void _freeTimerWheellruTable(lruTable *out);
+
+// Sharded LRU Table
+
+ShardedlruTableShard *_getShardShardedlruTable(ShardedlruTable *in, int key);
+
+void _wakeupMaintenanceShardedlruTable(ShardedlruTable *in);
+
+void _deferReplacedShardedlruTable(ShardedlruTableShard *shard, int key);
+
+//! Background eviction thread data.
+struct ShardedlruTableMaintenance {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wakeup;
+	int running;
+	int pending;        // Some shard crossed its high water mark.
+	size_t lowPercent;
+};
+
+//! Thread waiting for a load in flight, the async ones are in the heap.
+struct ShardedlruTableWaiter {
+	void (*func)(struct lruTableNode *, void *);
+	void *arg;
+	int async;
+	int done;
+	int found;
+	struct ShardedlruTableWaiter *next;
+};
+
+//! Load in flight, only the loader thread owns it.
+struct ShardedlruTableLoad {
+	int key;
+	void *(*loader)(int key, void *ctx);
+	void *ctx;
+	ShardedlruTableShard *shard;
+	struct ShardedlruTableWaiter *waiters;
+	struct ShardedlruTableLoad *next;
+};
+
 #endif // C_CONTAINER_H
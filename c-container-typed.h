@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+  \brief Type specialized containers for c-container library
+
+  Header only generators of containers for user types. Every macro here
+  defines the node and container types and static inline functions for a given
+  key and value type, so the values are stored inline in the nodes (no extra
+  allocation per entry) and the hash and comparison functions are inlined in
+  the callers.
+*/
+
+#ifndef C_CONTAINER_TYPED_H
+#define C_CONTAINER_TYPED_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+// Typed Helpers ===============================================================
+
+/*!
+  \defgroup typed Type specialized containers
+  \brief Header only containers generated for user key and value types.
+
+  The generated containers follow the same naming than the ones in
+  c-container.h with the user given Name as suffix (allocInitName, freeName,
+  insertKeyName, getKeyName, popKeyName). The values are copied in the nodes,
+  so the containers never free them; the user must release their content (if
+  any) before removing the node.
+  @{
+*/
+
+//! Hash for integer keys (64 bits finalizer of MurmurHash3)
+static inline uint64_t hashIntegerTyped(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+//! Equality for scalar keys
+#define EQUAL_SCALAR_TYPED(a, b) ((a) == (b))
+
+//! Three way comparison for scalar keys
+#define COMPARE_SCALAR_TYPED(a, b) (((a) > (b)) - ((a) < (b)))
+
+//!@}
+
+// Typed Hash Table ============================================================
+
+/*!
+  \ingroup typed
+  \brief Define a hash table for Key and Value types.
+
+  Defines the types NameNode and Name and the functions:
+
+  - void allocInitName(Name *out, size_t N): constructor with N buckets
+    (rounded up to a power of two).
+  - void freeName(Name *out): destructor, releases all the nodes.
+  - NameNode *insertKeyName(Name *out, Key key, Value value): insert or update
+    a key, returns the node with the key.
+  - NameNode *getKeyName(Name *in, Key key): the node with the key or NULL.
+  - int popKeyName(Name *out, Key key, Value *value): remove a key and copy its
+    value in value when it is not NULL, returns 1 when the key was removed.
+
+  The table is chained with one allocation per node and doubles the number of
+  buckets when the entries exceed it. The nodes are moved, not copied, so the
+  pointers to them remain valid.
+
+  \param Name Name of the container type.
+  \param Key Type of the keys.
+  \param Value Type of the values.
+  \param hash Function or macro hash(Key) returning an unsigned integer.
+  \param equal Function or macro equal(Key, Key) returning non zero when equal.
+*/
+#define DEFINE_HASH_TABLE_TYPED(Name, Key, Value, hash, equal)                  \
+                                                                                \
+typedef struct Name##Node {                                                     \
+	struct Name##Node *next;                                                    \
+	Key key;                                                                    \
+	Value value;                                                                \
+} Name##Node;                                                                   \
+                                                                                \
+typedef struct Name {                                                           \
+	size_t entries;                                                             \
+	size_t N;                                                                   \
+	Name##Node **table;                                                         \
+} Name;                                                                         \
+                                                                                \
+static inline void allocInit##Name(Name *out, size_t N)                         \
+{                                                                               \
+	size_t buckets = 1;                                                         \
+	while (buckets < N)                                                         \
+		buckets *= 2;                                                           \
+                                                                                \
+	out->entries = 0;                                                           \
+	out->N = buckets;                                                           \
+	out->table = calloc(buckets, sizeof(Name##Node *));                         \
+	assert(out->table != NULL);                                                 \
+}                                                                               \
+                                                                                \
+static inline void free##Name(Name *out)                                        \
+{                                                                               \
+	for (size_t i = 0; i < out->N; ++i) {                                       \
+		Name##Node *it = out->table[i];                                         \
+		while (it != NULL) {                                                    \
+			Name##Node *next = it->next;                                        \
+			free(it);                                                           \
+			it = next;                                                          \
+		}                                                                       \
+	}                                                                           \
+	free(out->table);                                                           \
+	out->table = NULL;                                                          \
+	out->N = 0;                                                                 \
+	out->entries = 0;                                                           \
+}                                                                               \
+                                                                                \
+static inline Name##Node **_getRefKey##Name(Name *in, Key key)                  \
+{                                                                               \
+	Name##Node **it = &in->table[(hash(key)) & (in->N - 1)];                    \
+	while (*it != NULL && !(equal((*it)->key, key)))                            \
+		it = &(*it)->next;                                                      \
+	return it;                                                                  \
+}                                                                               \
+                                                                                \
+static inline void _grow##Name(Name *out)                                       \
+{                                                                               \
+	const size_t N = 2 * out->N;                                                \
+	Name##Node **table = calloc(N, sizeof(Name##Node *));                       \
+	assert(table != NULL);                                                      \
+                                                                                \
+	for (size_t i = 0; i < out->N; ++i) {                                       \
+		Name##Node *it = out->table[i];                                         \
+		while (it != NULL) {                                                    \
+			Name##Node *next = it->next;                                        \
+			Name##Node **head = &table[(hash(it->key)) & (N - 1)];              \
+			it->next = *head;                                                   \
+			*head = it;                                                         \
+			it = next;                                                          \
+		}                                                                       \
+	}                                                                           \
+	free(out->table);                                                           \
+	out->table = table;                                                         \
+	out->N = N;                                                                 \
+}                                                                               \
+                                                                                \
+static inline Name##Node *insertKey##Name(Name *out, Key key, Value value)      \
+{                                                                               \
+	Name##Node **ref = _getRefKey##Name(out, key);                              \
+	if (*ref != NULL) {                                                         \
+		(*ref)->value = value;                                                  \
+		return *ref;                                                            \
+	}                                                                           \
+                                                                                \
+	Name##Node *node = malloc(sizeof(Name##Node));                              \
+	assert(node != NULL);                                                       \
+	node->next = NULL;                                                          \
+	node->key = key;                                                            \
+	node->value = value;                                                        \
+	*ref = node;                                                                \
+                                                                                \
+	if (++out->entries > out->N)                                                \
+		_grow##Name(out);                                                       \
+                                                                                \
+	return node;                                                                \
+}                                                                               \
+                                                                                \
+static inline Name##Node *getKey##Name(Name *in, Key key)                       \
+{                                                                               \
+	return *_getRefKey##Name(in, key);                                          \
+}                                                                               \
+                                                                                \
+static inline int popKey##Name(Name *out, Key key, Value *value)                \
+{                                                                               \
+	Name##Node **ref = _getRefKey##Name(out, key);                              \
+	Name##Node *node = *ref;                                                    \
+	if (node == NULL)                                                           \
+		return 0;                                                               \
+                                                                                \
+	if (value != NULL)                                                          \
+		*value = node->value;                                                   \
+                                                                                \
+	*ref = node->next;                                                          \
+	free(node);                                                                 \
+	out->entries--;                                                             \
+	return 1;                                                                   \
+}
+
+// Typed Binary Tree ===========================================================
+
+/*!
+  \ingroup typed
+  \brief Define a binary search tree for Key and Value types.
+
+  Defines the types NameNode and Name and the functions:
+
+  - void allocInitName(Name *out): constructor.
+  - void freeName(Name *out): destructor, releases all the nodes.
+  - NameNode *insertKeyName(Name *out, Key key, Value value): insert or update
+    a key, returns the node with the key.
+  - NameNode *getKeyName(Name *in, Key key): the node with the key or NULL.
+  - int popKeyName(Name *out, Key key, Value *value): remove a key and copy its
+    value in value when it is not NULL, returns 1 when the key was removed.
+  - void dsfName(Name *in, void (*func)(NameNode *, void *), void *arg): apply
+    func to all the nodes in key order.
+
+  Like #BinaryTree the tree is not balanced.
+
+  \param Name Name of the container type.
+  \param Key Type of the keys.
+  \param Value Type of the values.
+  \param compare Function or macro compare(Key, Key) returning a negative,
+  zero or positive value like strcmp.
+*/
+#define DEFINE_BINARY_TREE_TYPED(Name, Key, Value, compare)                     \
+                                                                                \
+typedef struct Name##Node {                                                     \
+	struct Name##Node *left;                                                    \
+	struct Name##Node *right;                                                   \
+	Key key;                                                                    \
+	Value value;                                                                \
+} Name##Node;                                                                   \
+                                                                                \
+typedef struct Name {                                                           \
+	size_t entries;                                                             \
+	Name##Node *tree;                                                           \
+} Name;                                                                         \
+                                                                                \
+static inline void allocInit##Name(Name *out)                                   \
+{                                                                               \
+	out->entries = 0;                                                           \
+	out->tree = NULL;                                                           \
+}                                                                               \
+                                                                                \
+static inline void _freeNode##Name(Name##Node *node)                            \
+{                                                                               \
+	while (node != NULL) {                                                      \
+		_freeNode##Name(node->left);                                            \
+		Name##Node *right = node->right;                                        \
+		free(node);                                                             \
+		node = right;                                                           \
+	}                                                                           \
+}                                                                               \
+                                                                                \
+static inline void free##Name(Name *out)                                        \
+{                                                                               \
+	_freeNode##Name(out->tree);                                                 \
+	out->tree = NULL;                                                           \
+	out->entries = 0;                                                           \
+}                                                                               \
+                                                                                \
+static inline Name##Node **_getRefKey##Name(Name *in, Key key)                  \
+{                                                                               \
+	Name##Node **it = &in->tree;                                                \
+	while (*it != NULL) {                                                       \
+		const int cmp = compare(key, (*it)->key);                               \
+		if (cmp > 0)                                                            \
+			it = &(*it)->right;                                                 \
+		else if (cmp < 0)                                                       \
+			it = &(*it)->left;                                                  \
+		else                                                                    \
+			break;                                                              \
+	}                                                                           \
+	return it;                                                                  \
+}                                                                               \
+                                                                                \
+static inline Name##Node *insertKey##Name(Name *out, Key key, Value value)      \
+{                                                                               \
+	Name##Node **ref = _getRefKey##Name(out, key);                              \
+	if (*ref != NULL) {                                                         \
+		(*ref)->value = value;                                                  \
+		return *ref;                                                            \
+	}                                                                           \
+                                                                                \
+	Name##Node *node = malloc(sizeof(Name##Node));                              \
+	assert(node != NULL);                                                       \
+	node->left = NULL;                                                          \
+	node->right = NULL;                                                         \
+	node->key = key;                                                            \
+	node->value = value;                                                        \
+	*ref = node;                                                                \
+	out->entries++;                                                             \
+	return node;                                                                \
+}                                                                               \
+                                                                                \
+static inline Name##Node *getKey##Name(Name *in, Key key)                       \
+{                                                                               \
+	return *_getRefKey##Name(in, key);                                          \
+}                                                                               \
+                                                                                \
+static inline int popKey##Name(Name *out, Key key, Value *value)                \
+{                                                                               \
+	Name##Node **ref = _getRefKey##Name(out, key);                              \
+	Name##Node *node = *ref;                                                    \
+	if (node == NULL)                                                           \
+		return 0;                                                               \
+                                                                                \
+	if (value != NULL)                                                          \
+		*value = node->value;                                                   \
+                                                                                \
+	if (node->left == NULL) {                                                   \
+		*ref = node->right;                                                     \
+	} else if (node->right == NULL) {                                           \
+		*ref = node->left;                                                      \
+	} else {                                                                    \
+		/* Replace with the lowest node of the right subtree. */                \
+		Name##Node **next = &node->right;                                       \
+		while ((*next)->left != NULL)                                           \
+			next = &(*next)->left;                                              \
+                                                                                \
+		Name##Node *successor = *next;                                          \
+		*next = successor->right;                                               \
+		successor->left = node->left;                                           \
+		successor->right = node->right;                                         \
+		*ref = successor;                                                       \
+	}                                                                           \
+                                                                                \
+	free(node);                                                                 \
+	out->entries--;                                                             \
+	return 1;                                                                   \
+}                                                                               \
+                                                                                \
+static inline void _dsfNode##Name(                                              \
+	Name##Node *node, void (*func)(Name##Node *, void *), void *arg             \
+) {                                                                             \
+	while (node != NULL) {                                                      \
+		_dsfNode##Name(node->left, func, arg);                                  \
+		Name##Node *right = node->right;                                        \
+		func(node, arg);                                                        \
+		node = right;                                                           \
+	}                                                                           \
+}                                                                               \
+                                                                                \
+static inline void dsf##Name(                                                   \
+	Name *in, void (*func)(Name##Node *, void *), void *arg                     \
+) {                                                                             \
+	_dsfNode##Name(in->tree, func, arg);                                        \
+}
+
+#endif // C_CONTAINER_TYPED_H
@@ -27,7 +27,39 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
+#include <pthread.h>
+
+// Value Ownership =============================================================
+
+/*!
+  \defgroup valueops Ownership of the values in the containers
+  \brief Functions used by the containers to copy and release the values.
+
+  By default the containers own the values: they are stored as given and
+  released with free when the node is released or the value replaced
+  (#ownedValueOps). Every container accepts a different #ValueOps before
+  inserting any element, for example to store values from pools or arenas or
+  references to buffers owned by the user (#borrowedValueOps). The lists also
+  serve as hash table buckets, so they don't keep ops: they receive them when
+  released (#freeWithOpsLinkedList).
+  @{
+*/
+
+//! Value ownership functions of a container
+typedef struct ValueOps {
+	void (*destroy)(void *value);       /*!< Release a value, NULL for values not owned. */
+	void *(*clone)(const void *value);  /*!< Copy a value on insertion, NULL stores the pointer. */
+} ValueOps;
+
+//! The container owns the values and releases them with free (default).
+extern const ValueOps ownedValueOps;
+
+//! The values are references, the container never copies nor releases them.
+extern const ValueOps borrowedValueOps;
+
+//!@}
 
 // Linked List ===================================================================
 
@@ -75,6 +107,15 @@ void allocInitLinkedList(LinkedList *out);
 */
 void freeLinkedList(LinkedList *out);
 
+//! Destructor for #LinkedList container with custom value ownership
+/*!
+  Like #freeLinkedList, but the values are released with ops instead of free.
+
+  \param[out] out Pointer to #LinkedList object to free.
+  \param[in] ops Value functions, NULL is #ownedValueOps.
+*/
+void freeWithOpsLinkedList(LinkedList *out, const ValueOps *ops);
+
 //! Insert node at the end of the #LinkedList O(1)
 /*!
   \param[out] out Pointer to #LinkedList object.
@@ -114,7 +155,8 @@ LinkedListNode *getIndexLinkedList(LinkedList *out, size_t index);
 
 //! Remove #LinkedListNode from #LinkedList given a key O(n)
 /*!
-  Remove a the first #LinkedListNode with a given key if exists
+  Remove a the first #LinkedListNode with a given key if exists. Only the node
+  is released, the value remains owned by the caller.
 
   \param[inout] out Pointer to #LinkedList object.
   \param[in] key Value for key of node to remove
@@ -124,7 +166,8 @@ int popKeyLinkedList(LinkedList *out, int key);
 
 //! Remove #LinkedListNode from #LinkedList given its index O(index)
 /*!
-  Remove the #LinkedListNode at index if such node exists
+  Remove the #LinkedListNode at index if such node exists. Only the node is
+  released, the value remains owned by the caller.
 
   \param[inout] out Pointer to #LinkedList object.
   \param[in] index Positional index of interest
@@ -175,6 +218,15 @@ void allocInitDoubleLinkedList(DoubleLinkedList *out);
 */
 void freeDoubleLinkedList(DoubleLinkedList *out);
 
+//! Destructor for #DoubleLinkedList container with custom value ownership
+/*!
+  Like #freeWithOpsLinkedList.
+
+  \param[out] out Pointer to #DoubleLinkedList object to free.
+  \param[in] ops Value functions, NULL is #ownedValueOps.
+*/
+void freeWithOpsDoubleLinkedList(DoubleLinkedList *out, const ValueOps *ops);
+
 //! Insert node at the end of the #DoubleLinkedList O(1)
 /*!
   \param[out] out Pointer to #DoubleLinkedList object.
@@ -217,7 +269,8 @@ DoubleLinkedListNode *getKeyDoubleLinkedList(DoubleLinkedList *out, int key);
 
 //! Remove #DoubleLinkedListNode from #DoubleLinkedList given a key O(n)
 /*!
-  Remove a the first #DoubleLinkedListNode with a given key if exists
+  Remove a the first #DoubleLinkedListNode with a given key if exists. Only
+  the node is released, the value remains owned by the caller.
 
   \param[inout] out Pointer to #DoubleLinkedList object.
   \param[in] key Value for key of #DoubleLinkedListNode to remove
@@ -227,7 +280,8 @@ int popKeyDoubleLinkedList(LinkedList *out, int key);
 
 //! Remove #DoubleLinkedListNode from #DoubleLinkedList given its index O(index)
 /*!
-  Remove the #DoubleLinkedListNode at index if such node exists
+  Remove the #DoubleLinkedListNode at index if such node exists. Only the
+  node is released, the value remains owned by the caller.
 
   \param[inout] out Pointer to #DoubleLinkedList object.
   \param[in] index Positional index of interest
@@ -237,6 +291,178 @@ int popIndexDoubleLinkedList(LinkedList *out, size_t index);
 
 //!@}
 
+// Filter ======================================================================
+
+/*!
+  \defgroup filter Approximate membership filters
+  \brief Filters to answer the negative lookups without touching the containers.
+
+  A #Filter never misses a key inserted in it, but it may report keys that
+  were never inserted (false positives). When attached to a #HashTable (also an
+  #lruTable) or a #BinaryTree with #setFilterHashTable or #setFilterBinaryTree
+  the container keeps it in sync in every insertion and removal, and the
+  lookups of absent keys return after probing the filter only.
+
+  There are two types of filter:
+
+  - #FILTER_BLOOM is a blocked Bloom filter: every key sets 8 bits in one cache
+  line (one per 64 bit word), so a lookup is a single cache line probe with
+  an 8-way independent test the compiler can vectorize. The filter takes 16
+  bits of memory per key of capacity. It can't remove keys, the removed keys
+  remain set as stale until the filter is rebuilt.
+
+  - #FILTER_CUCKOO is a cuckoo filter with 4 16 bit fingerprints per bucket.
+  It supports removals and has a lower false positive rate, but a lookup may
+  need to probe 2 buckets.
+  @{
+*/
+
+//! Type of the #Filter
+typedef enum FilterType {
+	FILTER_NONE = 0,  /*!< No filter. */
+	FILTER_BLOOM,     /*!< Blocked Bloom filter. */
+	FILTER_CUCKOO     /*!< Cuckoo filter. */
+} FilterType;
+
+//! Approximate membership filter
+typedef struct Filter {
+	FilterType type;      /*!< Type of filter. */
+	size_t capacity;      /*!< Number of keys the filter was sized for. */
+	size_t entries;       /*!< Number of keys set (including the stale ones). */
+	size_t stale;         /*!< Removed keys still set (only #FILTER_BLOOM). */
+	int saturated;        /*!< An insertion failed, all lookups are positive. */
+
+	size_t nBlocks;       /*!< Bloom blocks or cuckoo buckets (power of 2). */
+	void *blocks;         /*!< Array of blocks or buckets. */
+
+	uint16_t victim;      /*!< Cuckoo fingerprint that couldn't be placed. */
+	size_t victimBucket;  /*!< Bucket of Filter#victim. */
+
+	int counters;         /*!< Count the lookups (see #setCountersFilter). */
+	size_t lookups;       /*!< Number of lookups. */
+	size_t negatives;     /*!< Number of lookups answered as absent. */
+} Filter;
+
+//! Constructor for #Filter
+/*!
+  \param[out] out Pointer to #Filter object to construct.
+  \param[in] type Type of filter (not #FILTER_NONE).
+  \param[in] capacity Number of keys to size the filter for.
+*/
+void allocInitFilter(Filter *out, FilterType type, size_t capacity);
+
+//! Destructor for #Filter
+/*!
+  \param[out] out Pointer to #Filter object to free.
+*/
+void freeFilter(Filter *out);
+
+//! Remove all the keys from the #Filter and resize it
+/*!
+  \param[inout] out Pointer to #Filter object.
+  \param[in] capacity New number of keys to size the filter for.
+*/
+void clearFilter(Filter *out, size_t capacity);
+
+//! Enable or disable the lookup counters of the #Filter
+/*!
+  The counters are disabled by default, so the lookups don't write to the
+  filter and concurrent readers don't share a modified cache line.
+
+  \param[inout] out Pointer to #Filter object.
+  \param[in] enabled Update Filter#lookups and Filter#negatives when not 0.
+*/
+void setCountersFilter(Filter *out, int enabled);
+
+//! Add a key to the #Filter O(1)
+/*!
+  The keys must be inserted only once, the containers only insert the new
+  keys.
+
+  \param[inout] out Pointer to #Filter object.
+  \param[in] key Key to add.
+  \return 1 on success, 0 when the filter is full (#FILTER_CUCKOO) or over its
+  capacity (#FILTER_BLOOM) and needs to be cleared with a bigger capacity. Even
+  on failure there are no false negatives.
+*/
+int insertKeyFilter(Filter *out, int key);
+
+//! Check if a key may be in the #Filter O(1)
+/*!
+  \param[inout] in Pointer to #Filter object (to update the counters when
+  enabled with #setCountersFilter).
+  \param[in] key Key to search.
+  \return 0 when the key is definitely not in the filter and 1 otherwise.
+*/
+int containsKeyFilter(Filter *in, int key);
+
+//! Remove a key from the #Filter O(1)
+/*!
+  Only keys actually inserted can be removed, otherwise the fingerprint of
+  a different key may be removed. A #FILTER_BLOOM only counts the key as
+  stale.
+
+  \param[inout] out Pointer to #Filter object.
+  \param[in] key Key to remove.
+*/
+void removeKeyFilter(Filter *out, int key);
+
+//! Check if the #Filter needs to be rebuilt
+/*!
+  \param[in] in Pointer to #Filter object.
+  \return 1 when the filter is saturated, over its capacity or with too many
+  stale keys.
+*/
+int needsRebuildFilter(const Filter *in);
+
+//!@}
+
+// Byte String Keys ============================================================
+
+/*!
+  \defgroup byteskey Variable length byte string keys
+  \brief Keys like URLs or session ids for #HashTable, #lruTable and #BinaryTree.
+
+  The *BytesKey* functions of the containers store a copy of the key bytes
+  inline in the node, right after the node struct, together with the full 64
+  bit hash of the key computed once at insertion. The node key (LinkedListNode#key)
+  holds the lower 32 bits of the hash, so the buckets, the rehashing, the
+  filters and the policy history use it as any other key without hashing the
+  bytes again. The lookups compare that inline key first, then the full hash
+  and the bytes (memcmp) only when the hashes match.
+
+  The #BinaryTree nodes are ordered with the comparison set with
+  #setCompareBinaryTree (lexicographic by default).
+
+  A container must use only int keys or only byte string keys.
+  @{
+*/
+
+//! Byte string key stored after the node
+typedef struct BytesKey {
+	uint64_t hash;          /*!< 64 bit hash of the bytes. */
+	size_t length;          /*!< Number of bytes. */
+	unsigned char bytes[];  /*!< Key bytes. */
+} BytesKey;
+
+//! Hash function used for the #BytesKey
+/*!
+  \param[in] bytes Key bytes.
+  \param[in] length Number of bytes.
+  \return 64 bit hash of the bytes.
+*/
+uint64_t hashBytesKey(const void *bytes, size_t length);
+
+//! Default comparison of #BytesKey: lexicographic, shorter first on ties
+/*!
+  \param[in] a First key.
+  \param[in] b Second key.
+  \return Negative, zero or positive when a is lower, equal or bigger than b.
+*/
+int compareBytesKey(const BytesKey *a, const BytesKey *b);
+
+//!@}
+
 // Binary Tree =================================================================
 
 /*!
@@ -274,6 +500,15 @@ typedef struct BinaryTree {
 
 	BinaryTreeNode *start; /*!< Pointer to first (lower) node. */
 	BinaryTreeNode *end;   /*!< Pointer to last (higher) node. */
+
+	Filter *filter;        /*!< Optional filter for the keys (see #setFilterBinaryTree). */
+
+	//! Order of the #BytesKey nodes (see #setCompareBinaryTree).
+	int (*compare)(const BytesKey *a, const BytesKey *b);
+
+	const ValueOps *ops;   /*!< Ownership of the values (see #setValueOpsBinaryTree). */
+
+	int bytesKeys;         /*!< Non zero once a byte string key was inserted. */
 } BinaryTree;
 
 //! Constructor for #BinaryTree container
@@ -347,6 +582,73 @@ void bsfBinaryTree(
 	void *arg
 );
 
+//! Attach a #Filter to the #BinaryTree
+/*!
+  The filter is filled with the current keys and kept in sync in every
+  insertion and removal; so #getKeyBinaryTree and #popKeyBinaryTree of absent
+  keys return without walking the tree. The tree owns the filter and
+  releases it in #freeBinaryTree.
+
+  \param[inout] out Pointer to #BinaryTree object.
+  \param[in] type Type of filter, #FILTER_NONE removes the current one.
+*/
+void setFilterBinaryTree(BinaryTree *out, FilterType type);
+
+//! Set the ownership functions of the values in the #BinaryTree
+/*!
+  The ops are not copied, so they must live as long as the tree.
+
+  \param[inout] out Pointer to an empty #BinaryTree object.
+  \param[in] ops Value functions, NULL is #ownedValueOps.
+*/
+void setValueOpsBinaryTree(BinaryTree *out, const ValueOps *ops);
+
+//! Set the comparison for the #BytesKey nodes of the #BinaryTree
+/*!
+  \param[inout] out Pointer to an empty #BinaryTree object.
+  \param[in] compare Comparison function, NULL is #compareBytesKey.
+*/
+void setCompareBinaryTree(
+	BinaryTree *out, int (*compare)(const BytesKey *a, const BytesKey *b)
+);
+
+//! Insert or update a byte string key in the #BinaryTree O(log(n))
+/*!
+  \param[out] out Pointer to #BinaryTree object.
+  \param[in] key Key bytes (copied in the node).
+  \param[in] length Number of bytes of the key.
+  \param[in] value Pointer object associated with the key (node content).
+  \return A pointer to the node with the key.
+*/
+BinaryTreeNode *insertBytesKeyBinaryTree(
+	BinaryTree *out, const void *key, size_t length, void *value
+);
+
+//! Search for a byte string key in the #BinaryTree O(log(n))
+/*!
+  \param[in] in Pointer to #BinaryTree object.
+  \param[in] key Key bytes.
+  \param[in] length Number of bytes of the key.
+  \return A pointer to the node with the key or NULL.
+*/
+BinaryTreeNode *getBytesKeyBinaryTree(BinaryTree *in, const void *key, size_t length);
+
+//! Remove a byte string key from the #BinaryTree O(log(n))
+/*!
+  \param[inout] out Pointer to #BinaryTree object.
+  \param[in] key Key bytes.
+  \param[in] length Number of bytes of the key.
+  \return 1 when the key was removed or 0 when it was not found.
+*/
+int popBytesKeyBinaryTree(BinaryTree *out, const void *key, size_t length);
+
+//! Get the #BytesKey of a node inserted with #insertBytesKeyBinaryTree
+/*!
+  \param[in] node Pointer to the node.
+  \return The key stored in the node.
+*/
+const BytesKey *getBytesKeyBinaryTreeNode(const BinaryTreeNode *node);
+
 
 //!@}
 
@@ -377,6 +679,17 @@ typedef struct HashTable {
 
 	// This is the array for the hash table.
 	DoubleLinkedList *table;
+
+	// Incremental rehash, oldTable is NULL when not rehashing.
+	DoubleLinkedList *oldTable; /*!< Bucket array being migrated to HashTable#table. */
+	size_t oldN;                /*!< Number of buckets in HashTable#oldTable. */
+	size_t rehashIndex;         /*!< Next bucket of HashTable#oldTable to migrate. */
+
+	Filter *filter;             /*!< Optional filter for the keys (see #setFilterHashTable). */
+
+	const ValueOps *ops;        /*!< Ownership of the values (see #setValueOpsHashTable). */
+
+	int bytesKeys;              /*!< Non zero once a byte string key was inserted. */
 } HashTable;
 
 //! Constructor for #HashTable container
@@ -413,7 +726,8 @@ HashTableNode *getKeyHashTable(HashTable *out, int key);
 
 //! Remove #HashTableNode from #HashTable given a key O(1+m/n)
 /*!
-  Remove a the first #HashTableNode with a given key if exists
+  Remove a the first #HashTableNode with a given key if exists. The value is
+  released with the #ValueOps of the table.
 
   \param[inout] out Pointer to #HashTable object.
   \param[in] key Value for key of node to remove
@@ -421,6 +735,82 @@ HashTableNode *getKeyHashTable(HashTable *out, int key);
 */
 int popKeyHashTable(HashTable *out, int key);
 
+//! Change the number of buckets of the #HashTable incrementally
+/*!
+  This allocates the new bucket array, but the nodes are migrated a few buckets
+  at a time by the following insert, get and pop operations, so there is no
+  pause to move all the nodes at once. Meanwhile the lookups check the old
+  bucket of the key when it is not migrated yet. The nodes are moved, not
+  copied, so pointers to them remain valid.
+
+  When a previous rehash is still in progress it is completed first.
+
+  \param[inout] out Pointer to #HashTable object.
+  \param[in] N New number of hash entries in the hash table array.
+*/
+void rehashHashTable(HashTable *out, size_t N);
+
+//! Attach a #Filter to the #HashTable
+/*!
+  The filter is filled with the current keys and kept in sync in every
+  insertion and removal; so #getKeyHashTable and #popKeyHashTable of absent
+  keys return without walking the buckets. The filter is rebuilt from the
+  table keys when it is saturated, over its capacity or with too many stale
+  keys. The table owns the filter and releases it in #freeHashTable.
+
+  \param[inout] out Pointer to #HashTable object.
+  \param[in] type Type of filter, #FILTER_NONE removes the current one.
+*/
+void setFilterHashTable(HashTable *out, FilterType type);
+
+//! Set the ownership functions of the values in the #HashTable
+/*!
+  The ops are not copied, so they must live as long as the table. The values
+  are released when replaced by #insertKeyHashTable, when removed and in
+  #freeHashTable.
+
+  \param[inout] out Pointer to an empty #HashTable object.
+  \param[in] ops Value functions, NULL is #ownedValueOps.
+*/
+void setValueOpsHashTable(HashTable *out, const ValueOps *ops);
+
+//! Insert or update a byte string key in the #HashTable O(1 + n/m)
+/*!
+  \param[out] out Pointer to #HashTable object.
+  \param[in] key Key bytes (copied in the node).
+  \param[in] length Number of bytes of the key.
+  \param[in] value Pointer object associated with the key (node content).
+  \return A pointer to the node with the key.
+*/
+HashTableNode *insertBytesKeyHashTable(
+	HashTable *out, const void *key, size_t length, void *value
+);
+
+//! Search for a byte string key in the #HashTable O(1 + n/m)
+/*!
+  \param[in] in Pointer to #HashTable object.
+  \param[in] key Key bytes.
+  \param[in] length Number of bytes of the key.
+  \return A pointer to the node with the key or NULL.
+*/
+HashTableNode *getBytesKeyHashTable(HashTable *in, const void *key, size_t length);
+
+//! Remove a byte string key from the #HashTable O(1 + n/m)
+/*!
+  \param[inout] out Pointer to #HashTable object.
+  \param[in] key Key bytes.
+  \param[in] length Number of bytes of the key.
+  \return 1 when the key was removed or 0 when it was not found.
+*/
+int popBytesKeyHashTable(HashTable *out, const void *key, size_t length);
+
+//! Get the #BytesKey of a node inserted with #insertBytesKeyHashTable
+/*!
+  \param[in] node Pointer to the node.
+  \return The key stored in the node.
+*/
+const BytesKey *getBytesKeyHashTableNode(const HashTableNode *node);
+
 //!@}
 
 // LRU Table =================================================================
@@ -455,8 +845,61 @@ typedef struct lruTableNode {
 	// Extend with the double linked list nodes
 	struct lruTableNode *left;  /*!< Pointer to the immediate left element in use cache. */
 	struct lruTableNode *right; /*!< Pointer to the immediate right element in use cache. */
+
+	unsigned char referenced;   /*!< Reference bit used by #LRU_TABLE_POLICY_CLOCK. */
+	unsigned char segment;      /*!< Access list holding the node for the segmented policies. */
+	size_t weight;              /*!< Cost of the node in weighted tables (1 otherwise). */
+
+	struct lruTableTimer *timer; /*!< Expiration timer, NULL when the node never expires. */
 } lruTableNode;
 
+//! Eviction policies for #lruTable
+/*!
+  The policy decides which node is removed when a new key is inserted in a full
+  #lruTable.
+*/
+typedef enum lruTablePolicy {
+	LRU_TABLE_POLICY_LRU = 0, /*!< Exact LRU, every hit relinks the node in the access list. */
+	LRU_TABLE_POLICY_CLOCK,   /*!< CLOCK (second chance), hits only set lruTableNode#referenced. */
+	LRU_TABLE_POLICY_2Q,      /*!< 2Q, new keys enter a FIFO and only keys seen again get in the LRU. */
+	LRU_TABLE_POLICY_ARC,     /*!< Adaptive Replacement Cache, balances recency and frequency. */
+	LRU_TABLE_POLICY_TINYLFU  /*!< W-TinyLFU, a frequency sketch decides admission into the main LRU. */
+} lruTablePolicy;
+
+struct lruTablePolicyData;
+
+//! Reason why a node was removed by the #lruTable itself
+typedef enum lruTableRemovalCause {
+	LRU_TABLE_EVICTED = 0,  /*!< Removed to make room for other nodes. */
+	LRU_TABLE_EXPIRED,      /*!< Its TTL expired. */
+	LRU_TABLE_REJECTED,     /*!< Stale node of a key whose update was too large to admit. */
+	LRU_TABLE_REMOVED       /*!< Removed with #popKeylruTable or #purgelruTable. */
+} lruTableRemovalCause;
+
+//! Removed node delivered to the batched eviction callback
+typedef struct lruTableVictim {
+	int key;                     /*!< Key of the removed node. */
+	void *value;                 /*!< Value of the removed node, owned by the callback. */
+	lruTableRemovalCause cause;  /*!< Reason of the removal. */
+} lruTableVictim;
+
+//! Counters of #lruTable operations
+/*!
+  The counters are written with relaxed atomic stores by the thread owning the
+  table (no locked instructions in the hot path) so other threads can read
+  them with #getStatslruTable at any time.
+*/
+typedef struct lruTableStats {
+	size_t hits;         /*!< #getKeylruTable calls that found the key. */
+	size_t misses;       /*!< #getKeylruTable calls that didn't find the key. */
+	size_t inserts;      /*!< Insertions of new keys. */
+	size_t updates;      /*!< Insertions of existing keys. */
+	size_t evictions;    /*!< Nodes removed to make room for others. */
+	size_t expirations;  /*!< Nodes removed because their TTL expired. */
+	size_t rejections;   /*!< Insertions too large to admit. */
+	size_t removals;     /*!< Nodes removed explicitly. */
+} lruTableStats;
+
 
 //! LRU Hash Table container
 /*!
@@ -473,16 +916,118 @@ typedef struct lruTable {
 	// Access list cache. needs two pointers to the first and last element.
 	struct lruTableNode *accesList;   /*!< Pointer to the Least Recently Used access element. */
 	struct lruTableNode *lastAccess;  /*!< Pointer to the Most Recently Used element. */
+
+	lruTablePolicy policy;      /*!< Eviction policy. */
+	struct lruTablePolicyData *policyData; /*!< Extra lists for the segmented policies. */
+
+	// Weighted capacity
+	size_t weight;              /*!< Sum of the weights of all the nodes. */
+	size_t maxWeight;           /*!< Maximum total weight (SIZE_MAX when not weighted). */
+	size_t (*weigher)(int key, void *value); /*!< Computes the weight in #insertKeylruTable. */
+
+	// Expiration
+	uint64_t now;               /*!< Current time, updated by #expirelruTable. */
+	uint64_t defaultTTL;        /*!< TTL for insertions without explicit one (0 = never expire). */
+	struct lruTableTimerWheel *timers; /*!< Timer wheel, allocated with the first TTL. */
+
+	// Statistics and eviction callbacks
+	lruTableStats stats;        /*!< Operation counters. */
+	void (*evictFunc)(int key, void *value, lruTableRemovalCause cause, void *arg); /*!< Eviction callback. */
+	void (*evictBatchFunc)(const lruTableVictim *victims, size_t n, void *arg); /*!< Batched eviction callback. */
+	void *evictArg;             /*!< Argument for the eviction callbacks. */
+	lruTableVictim *victims;    /*!< Victims pending to deliver to lruTable#evictBatchFunc. */
+	size_t nVictims;            /*!< Number of pending victims. */
+	size_t maxVictims;          /*!< Size of the victims batch. */
+
+	// Buffered accesses
+	struct lruTableNode **readBuffer; /*!< Hits not applied to the access list yet. */
+	size_t readBufferEntries;   /*!< Number of pending hits. */
+	size_t readBufferSize;      /*!< Size of lruTable#readBuffer (0 = disabled). */
+
+	struct lruTableNode *freeNodes; /*!< Removed nodes ready to reuse. */
 } lruTable;
 
 //! Constructor for #lruTable container
 /*!
+  This uses the exact LRU policy (#LRU_TABLE_POLICY_LRU).
+
   \param[out] out Pointer to #HashTable object to construct.
   \param[in] N Number of hash entries in the hash table array. This is also the
   max number of entries the #lruTable can hold before removing the older ones.
 */
 void allocInitlruTable(lruTable *out, size_t N);
 
+//! Constructor for #lruTable container with a given eviction policy
+/*!
+  With #LRU_TABLE_POLICY_CLOCK the access list works as a circular buffer where
+  lruTable#accesList is the clock hand. A hit only sets the
+  lruTableNode#referenced bit, and the insertion in a full table sweeps the hand
+  giving a second chance to every referenced node until it finds one that is
+  not referenced. This approximates LRU without writing the access list on
+  every hit.
+
+  The other policies are scan resistant, so a sequence of one-off keys does not
+  flush the frequently used ones. They split the nodes in several access lists
+  (segments), and lruTable#accesList only holds the main (frequent) segment:
+
+  - #LRU_TABLE_POLICY_2Q: New keys enter a FIFO with 25% of the capacity. The
+    keys evicted from the FIFO are remembered (ghosts, without value) and
+    only when a ghost key is inserted again it goes to the main LRU.
+  - #LRU_TABLE_POLICY_ARC: Keys seen once and keys seen at least twice live
+    in two LRU lists, and the ghosts of both lists adapt the target size of
+    each one to the workload.
+  - #LRU_TABLE_POLICY_TINYLFU: New keys enter a small LRU window (1% of the
+    capacity). The keys leaving the window only replace the victim of the
+    main segmented LRU when a count-min sketch (4 bits per counter)
+    estimates they are accessed more frequently.
+
+  All the operations remain O(1).
+
+  \param[out] out Pointer to #HashTable object to construct.
+  \param[in] N Number of hash entries in the hash table array and max number of
+  entries.
+  \param[in] policy Eviction policy.
+*/
+void allocInitPolicylruTable(lruTable *out, size_t N, lruTablePolicy policy);
+
+//! Constructor for #lruTable container with independent capacity
+/*!
+  This is like #allocInitPolicylruTable, but the number of buckets and the
+  maximum number of entries are independent, so big caches can use a smaller
+  bucket array (higher load factor) and the capacity can be changed later with
+  #resizelruTable.
+
+  \param[out] out Pointer to #lruTable object to construct.
+  \param[in] N Number of hash entries in the hash table array.
+  \param[in] maxEntries Max number of entries the #lruTable can hold.
+  \param[in] policy Eviction policy.
+*/
+void allocInitCapacitylruTable(
+	lruTable *out, size_t N, size_t maxEntries, lruTablePolicy policy
+);
+
+//! Constructor for #lruTable container with weighted capacity
+/*!
+  In a weighted #lruTable every node has a cost (for example the size in bytes
+  of its value) and the insertions evict nodes until the sum of the weights
+  fits in lruTable#maxWeight. So a single insertion may evict several nodes.
+  N still limits the number of entries.
+
+  The segmented policies size their segments in number of entries, so this
+  uses the exact LRU policy.
+
+  \param[out] out Pointer to #lruTable object to construct.
+  \param[in] N Number of hash entries in the hash table array and max number of
+  entries.
+  \param[in] maxWeight Maximum total weight of the nodes.
+  \param[in] weigher Function to compute the weight of a value in
+  #insertKeylruTable. When NULL every node weights 1.
+*/
+void allocInitWeightedlruTable(
+	lruTable *out, size_t N, size_t maxWeight,
+	size_t (*weigher)(int key, void *value)
+);
+
 //! Destructor for #lruTable container
 /*!
   \param[out] out Pointer to #lruTable object to free. This also releases all
@@ -496,6 +1041,9 @@ void freelruTable(lruTable *out);
   the last accessed one. When the #lruTable already has lruTable#maxEntries
   elements this operation also removes the Least Recent Used node before
   inserting the new one.
+
+  In weighted tables the weight is computed with lruTable#weigher and this
+  behaves like #insertWeightlruTable.
   \param[out] out Pointer to #lruTable object.
   \param[in] key Value for key of new #lruTableNode
   \param[in] value Pointer object associated with the key (node content).
@@ -503,17 +1051,1397 @@ void freelruTable(lruTable *out);
 */
 lruTableNode *insertKeylruTable(lruTable *out, int key, void *value);
 
-//! Search for a node in the #lruTable given a key with complexity O(1 + n/m)
+//! Create a #lruTableNode with a given weight into the #lruTable
 /*!
-  When no #lruTableNode with this key is present, then return NULL. This
-  function registers all accesses to existing #lruTableNode into the access
-  cache (implemented as a double linked list).
+  Like #insertKeylruTable, but evicts nodes until the new weight fits in
+  lruTable#maxWeight. When the weight is bigger than lruTable#maxWeight the
+  node is too large to admit: nothing is inserted, the caller keeps the
+  ownership of value and any previous (stale) node with the same key is
+  removed.
 
-  \param[in] out Pointer to #lruTable object.
+  \param[out] out Pointer to #lruTable object.
+  \param[in] key Value for key of new #lruTableNode
+  \param[in] value Pointer object associated with the key (node content).
+  \param[in] weight Cost of the new node.
+  \return A pointer to the new #lruTableNode inserted or NULL when rejected.
+*/
+lruTableNode *insertWeightlruTable(
+	lruTable *out, int key, void *value, size_t weight
+);
+
+//! Create a #lruTableNode that expires after a given time O(1)
+/*!
+  Like #insertKeylruTable, but the node expires ttl time units after
+  lruTable#now instead of after lruTable#defaultTTL. The time units are defined
+  by the caller with the values passed to #expirelruTable (seconds,
+  milliseconds...). Updating a key also resets its expiration time.
+
+  \param[out] out Pointer to #lruTable object.
+  \param[in] key Value for key of new #lruTableNode
+  \param[in] value Pointer object associated with the key (node content).
+  \param[in] ttl Time to live of the node, 0 means it never expires.
+  \return A pointer to the new #lruTableNode inserted.
+*/
+lruTableNode *insertTTLlruTable(lruTable *out, int key, void *value, uint64_t ttl);
+
+//! Advance the #lruTable clock and remove the expired nodes
+/*!
+  The nodes with a TTL are tracked in a hierarchical timer wheel (4 levels of
+  64 slots), so the expiration is amortized O(1) per node and the expired nodes
+  release their capacity without waiting to be evicted. The caller drives the
+  clock calling this function periodically. Expired nodes are also treated as
+  misses by #getKeylruTable even before this removes them.
+
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] now Current time. Time never goes backwards, so older values
+  are ignored.
+  \return Number of removed nodes.
+*/
+size_t expirelruTable(lruTable *out, uint64_t now);
+
+//! Change the capacity of a #lruTable keeping the warm entries
+/*!
+  Shrinking evicts the extra nodes in a batch, following the eviction policy.
+  Growing beyond the number of buckets also starts an incremental rehash
+  (#rehashHashTable) to keep the load factor under 1, so there is no pause.
+
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] maxEntries New max number of entries.
+*/
+void resizelruTable(lruTable *out, size_t maxEntries);
+
+//! Get a snapshot of the #lruTable counters
+/*!
+  This is safe to call from any thread while the table is in use.
+
+  \param[in] in Pointer to #lruTable object.
+  \param[out] out Pointer to #lruTableStats to fill.
+*/
+void getStatslruTable(lruTable *in, lruTableStats *out);
+
+//! Evict up to n nodes from the #lruTable following its policy
+/*!
+  This makes room in advance, so the following insertions don't need to
+  evict. The values are released like in any eviction and the nodes are kept
+  to be reused by future insertions.
+
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] n Maximum number of nodes to evict.
+  \return Number of evicted nodes.
+*/
+size_t evictlruTable(lruTable *out, size_t n);
+
+//! Remove a key from the #lruTable O(1)
+/*!
+  The value is released like in the evictions (with cause
+  #LRU_TABLE_REMOVED when there are eviction callbacks) and the node is kept
+  to be reused by future insertions.
+
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] key Key to remove.
+  \return 1 if the key was removed, 0 if it was not in the table.
+*/
+int popKeylruTable(lruTable *out, int key);
+
+//! Remove all the #lruTable nodes matching a predicate
+/*!
+  This walks all the access lists once, from the least to the most recently
+  used node, and removes the nodes for which predicate returns non zero. The
+  nodes are kept to be reused by future insertions.
+
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] predicate Function to check every node.
+  \param[inout] ctx Argument to pass to the predicate.
+  \return Number of removed nodes.
+*/
+size_t purgelruTable(
+	lruTable *out,
+	int (*predicate)(const struct lruTableNode *node, void *ctx),
+	void *ctx
+);
+
+//! Search for a node in the #lruTable without registering the access
+/*!
+  This is like #getKeylruTable, but the access list is not modified and the
+  access is not counted in the statistics, so it is useful to check the
+  presence of a key (admission checks, metrics, prefetch...) without distorting
+  the recency order. Expired nodes are not returned, but neither removed.
+
+  \param[in] in Pointer to #lruTable object.
   \param[in] key Value for key of node to search
   \return A #lruTableNode pointer to the node or NULL.
 */
-lruTableNode *getKeylruTable(lruTable *out, int key);
+lruTableNode *peeklruTable(lruTable *in, int key);
+
+//! Enable the buffering of the accesses in #getKeylruTable
+/*!
+  With a read buffer the hits of #getKeylruTable only append the node to a
+  small ring, which is applied to the access list in a batch when it is full.
+  That takes the pointer relinking out of the read path and improves its
+  locality. The buffer is also drained before any insertion, eviction, removal
+  or expiration, so it never holds removed nodes and the victims are chosen
+  with all the accesses applied.
+
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] size Number of pending accesses in the buffer, 0 disables it.
+*/
+void setReadBufferlruTable(lruTable *out, size_t size);
+
+//! Attach a #Filter to the #lruTable
+/*!
+  Same than #setFilterHashTable, sized for lruTable#maxEntries keys. The
+  misses of #getKeylruTable are the ones that benefit.
+
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] type Type of filter, #FILTER_NONE removes the current one.
+*/
+void setFilterlruTable(lruTable *out, FilterType type);
+
+//! Set the ownership functions of the values in the #lruTable
+/*!
+  Like #setValueOpsHashTable. The evicted values are released with the ops
+  only when there are no eviction callbacks (that receive their ownership).
+
+  \param[inout] out Pointer to an empty #lruTable object.
+  \param[in] ops Value functions, NULL is #ownedValueOps.
+*/
+void setValueOpslruTable(lruTable *out, const ValueOps *ops);
+
+//! Insert or update a byte string key in the #lruTable
+/*!
+  Like #insertKeylruTable, the weigher and the eviction callbacks receive the
+  inline int key of the node. The policy history (ghosts and frequency
+  sketch) only uses that inline key, so it may confuse two byte string keys
+  with the same lower 32 bits of the hash; that only affects the admission and
+  eviction decisions.
+
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] key Key bytes (copied in the node).
+  \param[in] length Number of bytes of the key.
+  \param[in] value Pointer object associated with the key (node content).
+  \return A pointer to the node with the key or NULL if it was rejected.
+*/
+lruTableNode *insertBytesKeylruTable(
+	lruTable *out, const void *key, size_t length, void *value
+);
+
+//! Search for a byte string key in the #lruTable, like #getKeylruTable
+/*!
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] key Key bytes.
+  \param[in] length Number of bytes of the key.
+  \return A pointer to the node with the key or NULL.
+*/
+lruTableNode *getBytesKeylruTable(lruTable *out, const void *key, size_t length);
+
+//! Remove a byte string key from the #lruTable, like #popKeylruTable
+/*!
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] key Key bytes.
+  \param[in] length Number of bytes of the key.
+  \return 1 when the key was removed or 0 when it was not found.
+*/
+int popBytesKeylruTable(lruTable *out, const void *key, size_t length);
+
+//! Get the #BytesKey of a node inserted with #insertBytesKeylruTable
+/*!
+  \param[in] node Pointer to the node.
+  \return The key stored in the node.
+*/
+const BytesKey *getBytesKeylruTableNode(const lruTableNode *node);
+
+//! Apply all the pending accesses in the read buffer to the access list
+/*!
+  \param[inout] out Pointer to #lruTable object.
+*/
+void drainReadBufferlruTable(lruTable *out);
+
+//! Write all the #lruTable entries to a snapshot file in recency order
+/*!
+  The entries are written from the least to the most recently used, in a
+  compact binary format with the key, the policy segment, the expiration
+  deadline and the serialized value. The value serialization is delegated to
+  the serialize function, which works like snprintf: it writes at most size
+  bytes in buffer and returns the number of bytes needed for the value; when
+  that is larger than size it is called again with a bigger buffer.
+
+  The snapshot uses the native endianness, so it is intended for warm
+  restarts in the same machine or architecture. Tables with byte string keys
+  (see #insertBytesKeylruTable) also store the key bytes.
+
+  \param[in] in Pointer to #lruTable object.
+  \param[in] filename Path of the snapshot file to create.
+  \param[in] serialize Value serializer.
+  \param[inout] arg Argument to pass to the serializer.
+  \return 0 on success, -1 on I/O error.
+*/
+int dumplruTable(
+	lruTable *in, const char *filename,
+	size_t (*serialize)(const void *value, void *buffer, size_t size, void *arg),
+	void *arg
+);
+
+//! Fill an empty #lruTable with the entries in a snapshot file
+/*!
+  The file created by #dumplruTable is mapped in memory and streamed
+  sequentially, and the nodes are appended directly to the hash table and the
+  access lists, without the overhead of #insertKeylruTable, so the table
+  recovers the same recency order. When the snapshot has more entries than
+  lruTable#maxEntries only the most recent ones are loaded, expired entries are
+  skipped and the segments are ignored if the policy is different.
+
+  \param[inout] out Pointer to an empty #lruTable object.
+  \param[in] filename Path of the snapshot file.
+  \param[in] deserialize Function creating a value (owned by the table) from
+  its serialized bytes, it may return NULL to skip the entry.
+  \param[inout] arg Argument to pass to the deserializer.
+  \return 0 on success, -1 if the file can't be read or is not valid. A
+  truncated or corrupt file loads the valid entries before the first bad one.
+*/
+int loadlruTable(
+	lruTable *out, const char *filename,
+	void *(*deserialize)(const void *buffer, size_t size, void *arg),
+	void *arg
+);
+
+//! Set a function to call for every node removed by the #lruTable
+/*!
+  The function receives the key and value of the evicted or expired nodes
+  before the node is reused or released, so it can write back dirty values or
+  update external indexes. The callback takes the ownership of the value, so
+  the table doesn't free it. Nodes removed by #freelruTable are not notified.
+  The function is called in the middle of the table operations, so it must
+  not access the table.
+
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] func Function to call or NULL to free the values again.
+  \param[in] arg Argument to pass to the function.
+*/
+void setEvictionCallbacklruTable(
+	lruTable *out,
+	void (*func)(int key, void *value, lruTableRemovalCause cause, void *arg),
+	void *arg
+);
+
+//! Set a function to receive the removed nodes in batches
+/*!
+  Like #setEvictionCallbacklruTable, but the victims are accumulated and
+  delivered in groups of batchSize. The pending victims are also delivered at
+  the end of #resizelruTable and #expirelruTable, by #flushEvictionslruTable and
+  before #freelruTable. This replaces the non batched callback.
+
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] func Function to call or NULL to free the values again.
+  \param[in] batchSize Max number of victims per call.
+  \param[in] arg Argument to pass to the function.
+*/
+void setBatchEvictionCallbacklruTable(
+	lruTable *out,
+	void (*func)(const lruTableVictim *victims, size_t n, void *arg),
+	size_t batchSize,
+	void *arg
+);
+
+//! Deliver the pending victims to the batched eviction callback
+/*!
+  \param[inout] out Pointer to #lruTable object.
+*/
+void flushEvictionslruTable(lruTable *out);
+
+//! Search for a node in the #lruTable given a key with complexity O(1 + n/m)
+/*!
+  When no #lruTableNode with this key is present (or it is expired), then
+  return NULL. This function registers all accesses to existing
+  #lruTableNode into the access cache (implemented as a double linked list).
+
+  \param[in] out Pointer to #lruTable object.
+  \param[in] key Value for key of node to search
+  \return A #lruTableNode pointer to the node or NULL.
+*/
+lruTableNode *getKeylruTable(lruTable *out, int key);
+
+//! Search for a key in the #lruTable and load it on miss
+/*!
+  This is #getKeylruTable followed by a call to the loader and
+  #insertKeylruTable when the key is not present. The #lruTable is not thread
+  safe, so the loader is trivially called once per miss; use
+  #getOrLoadShardedlruTable to share a single load between concurrent threads.
+
+  \param[inout] out Pointer to #lruTable object.
+  \param[in] key Value for key of node to search.
+  \param[in] loader Function returning the value for a missing key (to be
+  owned by the table) or NULL when it can't be loaded.
+  \param[inout] ctx Argument to pass to the loader.
+  \return A #lruTableNode pointer to the node or NULL when the load failed.
+*/
+lruTableNode *getOrLoadlruTable(
+	lruTable *out, int key,
+	void *(*loader)(int key, void *ctx),
+	void *ctx
+);
+
+//!@}
+
+// Sharded LRU Table ===========================================================
+
+/*!
+  \defgroup shardedlrutable Thread safe sharded LRU Hash table
+  \brief This is a set of independent #lruTable protected by one lock each.
+
+  Every #getKeylruTable call modifies the access list, so a single #lruTable
+  needs an exclusive lock even for read-only workloads. This container
+  partitions the key space in ShardedlruTable#nShards independent #lruTable
+  (shards), each one with its own lock, hash buckets and access list. So
+  threads only contend when they access keys in the same shard.
+
+  The total capacity is split across the shards, so the LRU order is only
+  exact inside every shard.
+  @{
+*/
+
+//! Shard type for #ShardedlruTable
+/*!
+  This is an #lruTable with its own lock. The shards are cache line aligned to
+  avoid false sharing between the locks of different shards.
+*/
+typedef struct ShardedlruTableShard {
+	lruTable;                   /*!< Parent class as first element. */
+	pthread_mutex_t lock;       /*!< Lock protecting all the shard accesses. */
+	pthread_cond_t loaded;      /*!< Signaled every time a load completes. */
+	struct ShardedlruTableLoad *loads; /*!< Loads in flight in this shard. */
+	size_t asyncLoads;          /*!< Loads running in their own threads. */
+	size_t highWater;           /*!< Entries that wake up the maintenance thread. */
+	void **garbage;             /*!< Evicted values pending to release. */
+	size_t nGarbage;            /*!< Number of values in ShardedlruTableShard#garbage. */
+	size_t maxGarbage;          /*!< Size of ShardedlruTableShard#garbage. */
+} __attribute__((aligned(64))) ShardedlruTableShard;
+
+//! Sharded LRU Hash Table container
+/*!
+  Container with ShardedlruTable#nShards independent #ShardedlruTableShard.
+*/
+typedef struct ShardedlruTable {
+	size_t maxEntries;            /*!< Total capacity of the container. */
+	size_t nShards;               /*!< Number of shards. */
+	ShardedlruTableShard *shards; /*!< Array of shards. */
+	struct ShardedlruTableMaintenance *maintenance; /*!< Background thread data or NULL. */
+} ShardedlruTable;
+
+//! Constructor for #ShardedlruTable container
+/*!
+  The capacity is distributed as evenly as possible between the shards.
+
+  \param[out] out Pointer to #ShardedlruTable object to construct.
+  \param[in] nShards Number of independent shards (and locks).
+  \param[in] N Total number of entries the container can hold.
+*/
+void allocInitShardedlruTable(ShardedlruTable *out, size_t nShards, size_t N);
+
+//! Destructor for #ShardedlruTable container
+/*!
+  \param[out] out Pointer to #ShardedlruTable object to free. This also
+  releases all the elements contained and stops the maintenance thread. It
+  waits for the asynchronous loads in flight, so their complete callbacks
+  still run.
+*/
+void freeShardedlruTable(ShardedlruTable *out);
+
+//! Insert or update a key in the #ShardedlruTable O(1)
+/*!
+  This is a thread safe version of #insertKeylruTable that only locks the
+  shard containing the key. No node is returned because other threads may
+  evict it as soon as the shard lock is released.
+
+  \param[out] out Pointer to #ShardedlruTable object.
+  \param[in] key Value for key of new #lruTableNode
+  \param[in] value Pointer object associated with the key (node content).
+*/
+void insertKeyShardedlruTable(ShardedlruTable *out, int key, void *value);
+
+//! Set the ownership functions of the values in all the shards
+/*!
+  Like #setValueOpslruTable, also for the values released by the maintenance
+  thread. The table must be empty and not shared yet.
+
+  \param[inout] out Pointer to #ShardedlruTable object.
+  \param[in] ops Value functions, NULL is #ownedValueOps.
+*/
+void setValueOpsShardedlruTable(ShardedlruTable *out, const ValueOps *ops);
+
+//! Search for a key in the #ShardedlruTable and register the access O(1)
+/*!
+  This is a thread safe version of #getKeylruTable. When the key is found the
+  function func is called with the node while the shard lock is still held,
+  so it is the only safe place to read or copy the node content.
+
+  \param[inout] in Pointer to #ShardedlruTable object.
+  \param[in] key Value for key of node to search
+  \param[in] func Function to apply on the node when found. May be NULL.
+  \param[inout] arg argument to pass to the function.
+  \return 1 when the key was found or 0 otherwise.
+*/
+int getKeyShardedlruTable(
+	ShardedlruTable *in, int key,
+	void (*func)(struct lruTableNode *, void *),
+	void *arg
+);
+
+//! Get the sum of the counters of all the shards
+/*!
+  This doesn't take the shard locks.
+
+  \param[in] in Pointer to #ShardedlruTable object.
+  \param[out] out Pointer to #lruTableStats to fill.
+*/
+void getStatsShardedlruTable(ShardedlruTable *in, lruTableStats *out);
+
+//! Search for a key in the #ShardedlruTable and load it on miss (single-flight)
+/*!
+  On a miss the loader is called without holding the shard lock and its value
+  inserted in the table. Concurrent misses on the same key don't call the
+  loader again, but park until the load in flight completes; so the loader
+  runs exactly once per missing key even under a thundering herd. The func is
+  called with the node while the shard lock is still held, the same than in
+  #getKeyShardedlruTable.
+
+  \param[inout] in Pointer to #ShardedlruTable object.
+  \param[in] key Value for key of node to search.
+  \param[in] loader Function returning the value for a missing key (to be
+  owned by the table) or NULL when it can't be loaded. When a load fails all
+  the threads waiting for it fail as well.
+  \param[inout] ctx Argument to pass to the loader.
+  \param[in] func Function to apply on the node when found. May be NULL.
+  \param[inout] arg argument to pass to the function.
+  \return 1 if the key was found or loaded, 0 otherwise.
+*/
+int getOrLoadShardedlruTable(
+	ShardedlruTable *in, int key,
+	void *(*loader)(int key, void *ctx),
+	void *ctx,
+	void (*func)(struct lruTableNode *, void *),
+	void *arg
+);
+
+//! Start a background thread for the evictions of the #ShardedlruTable
+/*!
+  Without maintenance every insertion in a full shard evicts a node and
+  releases its value inline, which adds to the caller latency. With
+  maintenance, when a shard grows above highPercent of its capacity the
+  thread evicts nodes in small batches until it is below lowPercent, so the
+  insertions seldom need to evict. The values evicted, expired or replaced in
+  the callers threads are also released by the maintenance thread, out of the
+  shard locks.
+
+  The shards are configured under their locks, so this may be called while
+  other threads use the table, but not concurrently with
+  #stopMaintenanceShardedlruTable or #freeShardedlruTable.
+
+  \param[inout] out Pointer to #ShardedlruTable object.
+  \param[in] highPercent Percent of the shard capacity to start evicting.
+  \param[in] lowPercent Percent of the shard capacity to evict down to.
+*/
+void startMaintenanceShardedlruTable(
+	ShardedlruTable *out, size_t highPercent, size_t lowPercent
+);
+
+//! Stop the maintenance thread of the #ShardedlruTable
+/*!
+  The pending values are released and the evictions happen inline again.
+  The insertions may wake the thread up until they return, so this must not be
+  called concurrently with other operations on the table.
+
+  \param[inout] out Pointer to #ShardedlruTable object.
+*/
+void stopMaintenanceShardedlruTable(ShardedlruTable *out);
+
+//! Asynchronous version of #getOrLoadShardedlruTable
+/*!
+  This function never blocks on the loader. On a hit the completion is called
+  immediately; otherwise it is queued in the load in flight for the key or a
+  new detached thread is created to run the loader. The completion is called
+  exactly once, with the shard lock held, and receives the node or NULL when
+  the load failed.
+
+  \param[inout] in Pointer to #ShardedlruTable object.
+  \param[in] key Value for key of node to search.
+  \param[in] loader Function returning the value for a missing key.
+  \param[inout] ctx Argument to pass to the loader.
+  \param[in] complete Completion function.
+  \param[inout] arg argument to pass to the completion function.
+*/
+void getOrLoadAsyncShardedlruTable(
+	ShardedlruTable *in, int key,
+	void *(*loader)(int key, void *ctx),
+	void *ctx,
+	void (*complete)(struct lruTableNode *, void *),
+	void *arg
+);
+
+//!@}
+
+// Compact LRU Table ===========================================================
+
+/*!
+  \defgroup compactlrutable Compact LRU Hash table with inline values
+  \brief This is an LRU hash table with all the nodes in a preallocated array.
+
+  Every #lruTableNode needs its own allocation with four pointers plus the
+  allocation of the value. For very large caches that metadata is most of the
+  memory, so this container stores the nodes contiguously in one array, links
+  them with 32-bit indices instead of pointers and copies the values (of a
+  fixed size) inline in the nodes. With 4 bytes values a node takes 24 bytes
+  instead of the ~48 bytes of an #lruTableNode plus the value and the malloc
+  overheads.
+
+  The hash collisions are handled with a single linked list (removing a node
+  needs to walk its bucket) and the access list is double linked like in the
+  #lruTable. The values are plain bytes, so they are simply overwritten when a
+  node is evicted.
+
+  The nodes and the buckets are carved from a single memory block, which can
+  also be provided by the caller (see #initStaticCompactlruTable), so a
+  #CompactlruTable never calls the allocator after the construction.
+  @{
+*/
+
+//! Null index for the #CompactlruTable links
+#define COMPACT_LRU_TABLE_NIL UINT32_MAX
+
+//! Size of a #CompactlruTableNode with valueSize bytes inline (8 bytes aligned)
+#define COMPACT_LRU_TABLE_NODE_SIZE(valueSize)                          \
+	((sizeof(CompactlruTableNode) + (valueSize) + 7) / 8 * 8)
+
+//! Memory block size needed by a #CompactlruTable
+/*!
+  This is a constant expression when the arguments are, so it can be used to
+  declare static buffers for #initStaticCompactlruTable.
+*/
+#define COMPACT_LRU_TABLE_BUFFER_SIZE(N, maxEntries, valueSize)         \
+	((maxEntries) * COMPACT_LRU_TABLE_NODE_SIZE(valueSize) + (N) * sizeof(uint32_t))
+
+//! Compact LRU Table node type
+/*!
+  The value is stored inline just after the links, its size is
+  CompactlruTable#valueSize.
+*/
+typedef struct CompactlruTableNode {
+	int key;                    /*!< Node key. */
+	uint32_t next;              /*!< Next node index in the bucket. */
+	uint32_t left;              /*!< Previous (older) node index in the access list. */
+	uint32_t right;             /*!< Next (newer) node index in the access list. */
+	unsigned char value[];      /*!< Inline value. */
+} CompactlruTableNode;
+
+//! Compact LRU Hash Table container
+typedef struct CompactlruTable {
+	size_t N;                   /*!< Number of buckets. */
+	size_t entries;             /*!< Number of entries in use. */
+	size_t maxEntries;          /*!< Capacity (size of the nodes array). */
+	size_t valueSize;           /*!< Size of the inline values. */
+	size_t nodeSize;            /*!< Size of every node including the value. */
+	uint32_t *buckets;          /*!< Index of the first node in every bucket. */
+	unsigned char *nodes;       /*!< Array of maxEntries nodes. */
+	uint32_t accesList;         /*!< Index of the Least Recently Used node. */
+	uint32_t lastAccess;        /*!< Index of the Most Recently Used node. */
+	int owner;                  /*!< The memory block was allocated by the table. */
+} CompactlruTable;
+
+//! Constructor for #CompactlruTable container
+/*!
+  All the memory is allocated here, so no other function allocates.
+
+  \param[out] out Pointer to #CompactlruTable object to construct.
+  \param[in] N Number of buckets.
+  \param[in] maxEntries Maximum number of entries (< COMPACT_LRU_TABLE_NIL).
+  \param[in] valueSize Size in bytes of the values.
+*/
+void allocInitCompactlruTable(
+	CompactlruTable *out, size_t N, size_t maxEntries, size_t valueSize
+);
+
+//! Constructor for #CompactlruTable container using a caller memory block
+/*!
+  This never calls the allocator: the nodes and the buckets are placed in the
+  buffer, which must be at least #COMPACT_LRU_TABLE_BUFFER_SIZE bytes, 8 bytes
+  aligned and outlive the table. It can be a static array for real time or
+  embedded code.
+
+  \param[out] out Pointer to #CompactlruTable object to construct.
+  \param[in] buffer Memory block for the table.
+  \param[in] size Size of the buffer.
+  \param[in] N Number of buckets.
+  \param[in] maxEntries Maximum number of entries (< COMPACT_LRU_TABLE_NIL).
+  \param[in] valueSize Size in bytes of the values.
+*/
+void initStaticCompactlruTable(
+	CompactlruTable *out, void *buffer, size_t size,
+	size_t N, size_t maxEntries, size_t valueSize
+);
+
+//! Destructor for #CompactlruTable container
+/*!
+  The memory block is only released when it was allocated by
+  #allocInitCompactlruTable.
+
+  \param[out] out Pointer to #CompactlruTable object to free.
+*/
+void freeCompactlruTable(CompactlruTable *out);
+
+//! Insert or update a key in the #CompactlruTable O(1 + n/m)
+/*!
+  The value is copied in the node. When the table is full the Least Recently
+  Used node is reused for the new key.
+
+  \param[inout] out Pointer to #CompactlruTable object.
+  \param[in] key Key to insert.
+  \param[in] value Pointer to the CompactlruTable#valueSize bytes to copy.
+  \return Pointer to the value stored in the table.
+*/
+void *insertKeyCompactlruTable(CompactlruTable *out, int key, const void *value);
+
+//! Search for a key in the #CompactlruTable and register the access O(1 + n/m)
+/*!
+  \param[inout] in Pointer to #CompactlruTable object.
+  \param[in] key Key to search.
+  \return Pointer to the value stored in the table or NULL. The pointer is
+  valid until the node is evicted.
+*/
+void *getKeyCompactlruTable(CompactlruTable *in, int key);
+
+//!@}
+
+// Epoch-based reclamation =====================================================
+
+/*!
+  \defgroup epoch Epoch-based memory reclamation
+  \brief Deferred release of nodes removed while lock-free readers may use them.
+
+  The readers access the shared nodes inside critical sections
+  (#enterEpochDomain and #exitEpochDomain), where they publish the global
+  epoch they observed. The writers retire the removed nodes instead of
+  releasing them, and every retired node is released after the global epoch
+  advanced twice, because then no reader can still hold it. The global epoch
+  only advances when all the readers in a critical section observed the
+  current one.
+
+  Every thread uses its own #EpochThread record, where it keeps its retired
+  nodes, so the retirement needs no locks; the nodes are released in batches
+  of EPOCH_RETIRE_BATCH.
+
+  A thread may also keep a reference out of a critical section publishing it
+  in one of its EPOCH_HAZARD_POINTERS hazard pointers (#protectEpochThread).
+  The protected nodes are not released even when their epoch is old enough.
+  @{
+*/
+
+//! Number of hazard pointers per thread
+#define EPOCH_HAZARD_POINTERS 2
+
+//! Number of retired nodes accumulated before trying to release them
+#define EPOCH_RETIRE_BATCH 64
+
+//! Retired node pending to release
+typedef struct EpochRetired {
+	void *ptr;                  /*!< Retired node. */
+	void (*freeFunc)(void *);   /*!< Function to release the node. */
+	uint64_t epoch;             /*!< Global epoch when it was retired. */
+} EpochRetired;
+
+//! Per thread record of an #EpochDomain
+typedef struct EpochThread {
+	uint64_t epoch;             /*!< Observed epoch, 0 out of critical sections. */
+	void *hazards[EPOCH_HAZARD_POINTERS]; /*!< Protected nodes. */
+	int active;                 /*!< The record belongs to a registered thread. */
+	uint64_t owner;             /*!< Id of the registered thread. */
+	EpochRetired *retired;      /*!< Nodes retired by this thread. */
+	size_t nRetired;            /*!< Number of retired nodes. */
+	size_t maxRetired;          /*!< Size of EpochThread#retired. */
+	struct EpochDomain *domain; /*!< Domain of the record. */
+	struct EpochThread *next;   /*!< Next record in the domain. */
+} __attribute__((aligned(64))) EpochThread;
+
+//! Epoch-based reclamation domain
+/*!
+  A domain is usually shared by all the nodes of a container.
+*/
+typedef struct EpochDomain {
+	uint64_t id;                /*!< Unique id of the domain. */
+	uint64_t global;            /*!< Global epoch. */
+	EpochThread *threads;       /*!< List of thread records, never shrinks. */
+	pthread_mutex_t lock;       /*!< Protects the registration and the orphans. */
+	EpochRetired *orphans;      /*!< Nodes retired by unregistered threads. */
+	size_t nOrphans;            /*!< Number of orphan nodes. */
+	size_t maxOrphans;          /*!< Size of EpochDomain#orphans. */
+} EpochDomain;
+
+//! Constructor for #EpochDomain
+/*!
+  \param[out] out Pointer to #EpochDomain object to construct.
+*/
+void allocInitEpochDomain(EpochDomain *out);
+
+//! Destructor for #EpochDomain
+/*!
+  This drains the domain: all the retired nodes are released, so no thread
+  can be in a critical section or use the domain any more.
+
+  \param[out] out Pointer to #EpochDomain object to free.
+*/
+void freeEpochDomain(EpochDomain *out);
+
+//! Register the calling thread in the #EpochDomain
+/*!
+  The record of a previously unregistered thread is reused when possible.
+
+  \param[inout] in Pointer to #EpochDomain object.
+  \return The #EpochThread of the calling thread.
+*/
+EpochThread *registerThreadEpochDomain(EpochDomain *in);
+
+//! Unregister a thread from its #EpochDomain
+/*!
+  The thread can't be in a critical section. Its pending retired nodes are
+  handed to the domain, which releases them later.
+
+  \param[inout] thread Pointer to the record of the calling thread.
+*/
+void unregisterThreadEpochDomain(EpochThread *thread);
+
+//! Get the #EpochThread of the calling thread, registering it if needed
+/*!
+  This allows to use a domain without explicit registrations, the last
+  record used by every thread is cached so this is usually cheap.
+
+  \param[inout] in Pointer to #EpochDomain object.
+  \return The #EpochThread of the calling thread.
+*/
+EpochThread *getThreadEpochDomain(EpochDomain *in);
+
+//! Enter a reader critical section
+/*!
+  \param[inout] thread Pointer to the record of the calling thread.
+*/
+void enterEpochDomain(EpochThread *thread);
+
+//! Exit a reader critical section
+/*!
+  \param[inout] thread Pointer to the record of the calling thread.
+*/
+void exitEpochDomain(EpochThread *thread);
+
+//! Retire a node that is not reachable for new readers any more
+/*!
+  \param[inout] thread Pointer to the record of the calling thread.
+  \param[in] ptr Node to release when no reader can access it.
+  \param[in] freeFunc Function to release the node.
+*/
+void retireEpochDomain(EpochThread *thread, void *ptr, void (*freeFunc)(void *));
+
+//! Try to advance the epoch and release the retired nodes of a thread
+/*!
+  \param[inout] thread Pointer to the record of the calling thread.
+  \return Number of nodes still pending.
+*/
+size_t collectEpochThread(EpochThread *thread);
+
+//! Protect a node with a hazard pointer
+/*!
+  This must be called inside a critical section where ptr was reachable,
+  then the node can be used after #exitEpochDomain until
+  #releaseEpochThread.
+
+  \param[inout] thread Pointer to the record of the calling thread.
+  \param[in] index Hazard pointer index (< EPOCH_HAZARD_POINTERS).
+  \param[in] ptr Node to protect.
+*/
+void protectEpochThread(EpochThread *thread, size_t index, void *ptr);
+
+//! Clear a hazard pointer
+/*!
+  \param[inout] thread Pointer to the record of the calling thread.
+  \param[in] index Hazard pointer index (< EPOCH_HAZARD_POINTERS).
+*/
+void releaseEpochThread(EpochThread *thread, size_t index);
+
+//!@}
+
+// Inline Hash Table ===========================================================
+
+/*!
+  \defgroup inlinehashtable Chained hash table with cache line buckets
+  \brief This is a #HashTable with the first keys inline in the buckets.
+
+  Every #HashTable bucket is a #DoubleLinkedList and every key comparison
+  needs to dereference a node. In this container every bucket is a cache line
+  header holding the first INLINE_HASH_TABLE_SLOTS keys together with their
+  node pointers; so the lookups usually resolve (hits and misses) reading only
+  the bucket, and the node is only touched to access the value. The keys that
+  don't fit in the header go to an overflow chain.
+  @{
+*/
+
+//! Number of inline keys in every #InlineHashTableBucket
+#define INLINE_HASH_TABLE_SLOTS 4
+
+//! Bucket header of the #InlineHashTable, one cache line
+typedef struct InlineHashTableBucket {
+	int keys[INLINE_HASH_TABLE_SLOTS];              /*!< Inline keys. */
+	HashTableNode *nodes[INLINE_HASH_TABLE_SLOTS];  /*!< Nodes of the inline keys. */
+	HashTableNode *overflow;    /*!< Chain of the other nodes (using next). */
+	unsigned char used;         /*!< Bitmask of the used inline slots. */
+} __attribute__((aligned(64))) InlineHashTableBucket;
+
+//! Inline Hash Table container
+typedef struct InlineHashTable {
+	size_t entries;                 /*!< Number of entries. */
+	size_t N;                       /*!< Number of buckets. */
+	InlineHashTableBucket *table;   /*!< Array of buckets. */
+} InlineHashTable;
+
+//! Constructor for #InlineHashTable container
+/*!
+  \param[out] out Pointer to #InlineHashTable object to construct.
+  \param[in] N Number of buckets.
+*/
+void allocInitInlineHashTable(InlineHashTable *out, size_t N);
+
+//! Destructor for #InlineHashTable container
+/*!
+  \param[out] out Pointer to #InlineHashTable object to free. This also
+  releases all the elements contained.
+*/
+void freeInlineHashTable(InlineHashTable *out);
+
+//! Insert or update a key in the #InlineHashTable O(1 + n/m)
+/*!
+  \param[out] out Pointer to #InlineHashTable object.
+  \param[in] key Value for key of new #HashTableNode
+  \param[in] value Pointer object associated with the key (node content).
+  \return A pointer to the #HashTableNode with the key.
+*/
+HashTableNode *insertKeyInlineHashTable(InlineHashTable *out, int key, void *value);
+
+//! Search for a node in the #InlineHashTable given a key O(1 + n/m)
+/*!
+  \param[in] in Pointer to #InlineHashTable object.
+  \param[in] key Value for key of node to search
+  \return A #HashTableNode pointer to the node or NULL.
+*/
+HashTableNode *getKeyInlineHashTable(InlineHashTable *in, int key);
+
+//! Remove a key from the #InlineHashTable O(1 + n/m)
+/*!
+  When an inline key is removed the first overflow node takes its place.
+
+  \param[inout] out Pointer to #InlineHashTable object.
+  \param[in] key Value for key of #HashTableNode to remove
+  \return 1 when a #HashTableNode was removed or 0 when no such node was found.
+*/
+int popKeyInlineHashTable(InlineHashTable *out, int key);
+
+//!@}
+
+// Cuckoo Hash Table ===========================================================
+
+/*!
+  \defgroup cuckoohashtable Bucketized cuckoo hash table
+  \brief This is an open addressing hash table with bounded lookups.
+
+  Every key can only be in two buckets given by two hash functions, and every
+  bucket holds 4 keys and values inline in a single cache line. So a lookup
+  reads at most two cache lines, even for adversarial keys or high load
+  factors. When both buckets of a new key are full, a breadth first search
+  finds the shortest chain of keys to move to their alternative buckets to
+  make room; if there is no such chain the table doubles its size.
+  @{
+*/
+
+//! Number of slots in every #CuckooHashTableBucket
+#define CUCKOO_HASH_TABLE_SLOTS 4
+
+//! Bucket of the #CuckooHashTable, one cache line
+typedef struct CuckooHashTableBucket {
+	int keys[CUCKOO_HASH_TABLE_SLOTS];     /*!< Keys of the slots. */
+	unsigned char used;                    /*!< Bitmask of the used slots. */
+	void *values[CUCKOO_HASH_TABLE_SLOTS]; /*!< Values of the slots. */
+} __attribute__((aligned(64))) CuckooHashTableBucket;
+
+//! Cuckoo Hash Table container
+typedef struct CuckooHashTable {
+	size_t entries;                  /*!< Number of entries. */
+	size_t nBuckets;                 /*!< Number of buckets (power of 2). */
+	CuckooHashTableBucket *buckets;  /*!< Array of buckets. */
+} CuckooHashTable;
+
+//! Constructor for #CuckooHashTable container
+/*!
+  \param[out] out Pointer to #CuckooHashTable object to construct.
+  \param[in] N Expected number of entries, the table grows when needed.
+*/
+void allocInitCuckooHashTable(CuckooHashTable *out, size_t N);
+
+//! Destructor for #CuckooHashTable container
+/*!
+  \param[out] out Pointer to #CuckooHashTable object to free. This also
+  releases all the values contained.
+*/
+void freeCuckooHashTable(CuckooHashTable *out);
+
+//! Insert or update a key in the #CuckooHashTable
+/*!
+  Amortized O(1), the displacements and the resize are bounded but may move
+  other values.
+
+  \param[inout] out Pointer to #CuckooHashTable object.
+  \param[in] key Key to insert.
+  \param[in] value Pointer object associated with the key (owned by the table).
+  \return Pointer to the slot holding the value, valid until the next
+  insertion or removal.
+*/
+void **insertKeyCuckooHashTable(CuckooHashTable *out, int key, void *value);
+
+//! Search for a key in the #CuckooHashTable O(1) worst case
+/*!
+  \param[in] in Pointer to #CuckooHashTable object.
+  \param[in] key Key to search.
+  \return Pointer to the slot holding the value or NULL, valid until the next
+  insertion or removal.
+*/
+void **getKeyCuckooHashTable(CuckooHashTable *in, int key);
+
+//! Remove a key from the #CuckooHashTable O(1) worst case
+/*!
+  \param[inout] out Pointer to #CuckooHashTable object.
+  \param[in] key Key to remove.
+  \return 1 when the key was removed or 0 when it was not found.
+*/
+int popKeyCuckooHashTable(CuckooHashTable *out, int key);
+
+//!@}
+
+// Robin Hood Hash Table =======================================================
+
+/*!
+  \defgroup robinhoodhashtable Robin Hood linear probing hash table
+  \brief This is an open addressing hash table for delete heavy workloads.
+
+  The keys are in a flat array of slots with linear probing. Every slot stores
+  the distance to the key home slot and an insertion takes the slot of any key
+  closer to its home (rich) than the new one (poor), so the probe lengths stay
+  short and similar for all the keys. A search can also stop as soon as it
+  finds a key closer to its home than the searched one would be.
+
+  The deletions shift back the following keys instead of leaving tombstones,
+  so the table doesn't degrade after long insert/delete churn.
+  @{
+*/
+
+//! Slot of the #RobinHoodHashTable
+typedef struct RobinHoodHashTableSlot {
+	int key;                    /*!< Key of the slot. */
+	uint32_t distance;          /*!< Probe distance + 1, 0 for empty slots. */
+	void *value;                /*!< Value of the slot. */
+} RobinHoodHashTableSlot;
+
+//! Robin Hood Hash Table container
+typedef struct RobinHoodHashTable {
+	size_t entries;                 /*!< Number of entries. */
+	size_t N;                       /*!< Number of slots (power of 2). */
+	RobinHoodHashTableSlot *table;  /*!< Array of slots. */
+} RobinHoodHashTable;
+
+//! Constructor for #RobinHoodHashTable container
+/*!
+  \param[out] out Pointer to #RobinHoodHashTable object to construct.
+  \param[in] N Expected number of entries, the table grows when needed.
+*/
+void allocInitRobinHoodHashTable(RobinHoodHashTable *out, size_t N);
+
+//! Destructor for #RobinHoodHashTable container
+/*!
+  \param[out] out Pointer to #RobinHoodHashTable object to free. This also
+  releases all the values contained.
+*/
+void freeRobinHoodHashTable(RobinHoodHashTable *out);
+
+//! Insert or update a key in the #RobinHoodHashTable amortized O(1)
+/*!
+  The table doubles when the load factor would exceed 90%.
+
+  \param[inout] out Pointer to #RobinHoodHashTable object.
+  \param[in] key Key to insert.
+  \param[in] value Pointer object associated with the key (owned by the table).
+  \return Pointer to the slot holding the value, valid until the next
+  insertion or removal.
+*/
+void **insertKeyRobinHoodHashTable(RobinHoodHashTable *out, int key, void *value);
+
+//! Search for a key in the #RobinHoodHashTable O(1) expected
+/*!
+  \param[in] in Pointer to #RobinHoodHashTable object.
+  \param[in] key Key to search.
+  \return Pointer to the slot holding the value or NULL, valid until the next
+  insertion or removal.
+*/
+void **getKeyRobinHoodHashTable(RobinHoodHashTable *in, int key);
+
+//! Remove a key from the #RobinHoodHashTable with backward shift O(1) expected
+/*!
+  \param[inout] out Pointer to #RobinHoodHashTable object.
+  \param[in] key Key to remove.
+  \return 1 when the key was removed or 0 when it was not found.
+*/
+int popKeyRobinHoodHashTable(RobinHoodHashTable *out, int key);
+
+//!@}
+
+// Frozen Hash Table ===========================================================
+
+/*!
+  \defgroup frozenhashtable Read-only hash table with a minimal perfect hash
+  \brief This is an immutable map built from a #HashTable with #freezeHashTable.
+
+  The keys are placed with a minimal perfect hash function (PTHash style): the
+  keys are distributed in small buckets and every bucket stores a 16 bit pilot
+  that moves its keys to free positions. So every key has its own position in
+  flat arrays of keys and values, and a lookup is a single probe with no
+  collisions to resolve. The hash function needs about 3.3 bits per key.
+
+  All the arrays are in a single position independent buffer, so the table
+  can be written with #dumpFrozenHashTable and used directly from a mmap with
+  #openFrozenHashTable.
+  @{
+*/
+
+//! Frozen Hash Table container
+typedef struct FrozenHashTable {
+	size_t entries;         /*!< Number of entries (and positions). */
+	size_t nBuckets;        /*!< Number of pilot buckets. */
+	size_t nSlots;          /*!< Size of the hash range (>= entries). */
+	size_t valueSize;       /*!< Size of the values. */
+	uint64_t seed;          /*!< Seed of the hash function. */
+
+	const uint16_t *pilots; /*!< Pilot of every bucket. */
+	const uint32_t *remap;  /*!< Final positions of the hashes >= entries. */
+	const int *keys;        /*!< Key of every position. */
+	const unsigned char *values; /*!< Value of every position. */
+
+	void *buffer;           /*!< Memory with all the arrays. */
+	size_t bufferSize;      /*!< Size of FrozenHashTable#buffer. */
+	int mapped;             /*!< The buffer is a file mapping. */
+} FrozenHashTable;
+
+//! Build a #FrozenHashTable with the current keys of a #HashTable O(n)
+/*!
+  The values are copied, so the #HashTable remains valid and independent.
+  The keys are the int keys of the nodes, so tables with byte string keys (see
+  #insertBytesKeyHashTable) whose inline keys collide can't be frozen.
+
+  \param[in] in Pointer to #HashTable object.
+  \param[out] out Pointer to #FrozenHashTable object to construct.
+  \param[in] valueSize Bytes to copy from every value (NULL values are zeros).
+  \return 0 on success, -1 when there are repeated keys or no hash function
+  was found (out is left empty).
+*/
+int freezeHashTable(HashTable *in, FrozenHashTable *out, size_t valueSize);
+
+//! Destructor for #FrozenHashTable container
+/*!
+  \param[out] out Pointer to #FrozenHashTable object to free (or unmap).
+*/
+void freeFrozenHashTable(FrozenHashTable *out);
+
+//! Search for a key in the #FrozenHashTable O(1)
+/*!
+  \param[in] in Pointer to #FrozenHashTable object.
+  \param[in] key Key to search.
+  \return A pointer to the value of the key or NULL.
+*/
+const void *getKeyFrozenHashTable(const FrozenHashTable *in, int key);
+
+//! Search for several keys in the #FrozenHashTable O(n)
+/*!
+  The lookups are done in two passes: the first one computes the positions
+  and prefetches them and the second one compares the keys. So the memory
+  accesses of the keys overlap.
+
+  \param[in] in Pointer to #FrozenHashTable object.
+  \param[in] keys Array of keys to search.
+  \param[in] n Number of keys.
+  \param[out] values Array of n pointers to the values, NULL when the key is
+  absent.
+  \return Number of keys found.
+*/
+size_t getKeysFrozenHashTable(
+	const FrozenHashTable *in, const int *keys, size_t n, const void **values
+);
+
+//! Write a #FrozenHashTable into a file
+/*!
+  The file is replaced atomically (written aside and renamed), so the
+  processes using the previous version with #openFrozenHashTable are not
+  affected.
+
+  \param[in] in Pointer to #FrozenHashTable object.
+  \param[in] filename Path of the file to create.
+  \return 0 on success or -1 on error.
+*/
+int dumpFrozenHashTable(const FrozenHashTable *in, const char *filename);
+
+//! Open a #FrozenHashTable file with mmap
+/*!
+  Nothing is copied or parsed, the lookups read the file mapping directly.
+
+  \param[out] out Pointer to #FrozenHashTable object to construct.
+  \param[in] filename Path of a file created with #dumpFrozenHashTable.
+  \return 0 on success or -1 on error (missing, invalid or truncated file).
+*/
+int openFrozenHashTable(FrozenHashTable *out, const char *filename);
+
+//!@}
+
+// Mapped Table ================================================================
+
+/*!
+  \defgroup mappedtable Memory mapped read-only tables
+  \brief On-disk image of a #HashTable or a #BinaryTree queried in place.
+
+  #dumpMappedHashTable and #dumpMappedBinaryTree write a versioned, position
+  independent image of the table: a header, the bucket index (hash tables),
+  an array of fixed size records and the serialized values; every section
+  aligned to 64 bytes and all the references are offsets. #openMappedTable maps
+  the file read-only and shared, so there is no deserialization, the pages are
+  only read when the lookups touch them and all the processes opening the same
+  file share the page cache.
+
+  The hash images keep the records grouped by bucket (same hash function
+  than #HashTable), so a lookup scans a contiguous range of records. The tree
+  images keep the records sorted by key, so a lookup is a binary search.
+
+  The mapping is immutable; #thawMappedHashTable and #thawMappedBinaryTree
+  are the copy-on-write upgrade: they create a mutable container from the image
+  when the first modification is needed, and the mapping can be closed then.
+
+  The image uses the native endianness and includes a checksum of all its
+  content, verified on demand with #verifyMappedTable.
+  @{
+*/
+
+//! Type of image in a #MappedTable
+typedef enum MappedTableType {
+	MAPPED_TABLE_HASH = 1,  /*!< Image of a #HashTable. */
+	MAPPED_TABLE_TREE       /*!< Image of a #BinaryTree. */
+} MappedTableType;
+
+//! Entry record in a #MappedTable image
+typedef struct MappedTableRecord {
+	int32_t key;      /*!< Key of the entry. */
+	uint32_t size;    /*!< Size of the serialized value. */
+	uint64_t offset;  /*!< Offset of the value in MappedTable#data. */
+} MappedTableRecord;
+
+//! Memory mapped read-only table
+typedef struct MappedTable {
+	MappedTableType type;     /*!< Type of image. */
+	size_t entries;           /*!< Number of entries. */
+	size_t nBuckets;          /*!< Number of buckets (only #MAPPED_TABLE_HASH). */
+	const uint64_t *buckets;  /*!< First record of every bucket (nBuckets + 1). */
+	const MappedTableRecord *records; /*!< Array of records. */
+	const unsigned char *data;        /*!< Serialized values. */
+	size_t dataSize;          /*!< Size of MappedTable#data. */
+
+	void *map;                /*!< File mapping. */
+	size_t mapSize;           /*!< Size of MappedTable#map. */
+} MappedTable;
+
+//! Write the image of a #HashTable into a file
+/*!
+  The serialize function works like in #dumplruTable. The file is replaced
+  atomically, so the processes with the previous version mapped are not
+  affected. The images only have int keys, so the tables with byte string keys
+  (see #insertBytesKeyHashTable) are rejected.
+
+  \param[in] in Pointer to #HashTable object.
+  \param[in] filename Path of the file to create.
+  \param[in] serialize Value serializer.
+  \param[inout] arg Argument to pass to the serializer.
+  \return 0 on success, -1 on I/O error or with byte string keys.
+*/
+int dumpMappedHashTable(
+	HashTable *in, const char *filename,
+	size_t (*serialize)(const void *value, void *buffer, size_t size, void *arg),
+	void *arg
+);
+
+//! Write the image of a #BinaryTree into a file
+/*!
+  Same than #dumpMappedHashTable.
+
+  \param[in] in Pointer to #BinaryTree object.
+  \param[in] filename Path of the file to create.
+  \param[in] serialize Value serializer.
+  \param[inout] arg Argument to pass to the serializer.
+  \return 0 on success, -1 on I/O error or with byte string keys.
+*/
+int dumpMappedBinaryTree(
+	BinaryTree *in, const char *filename,
+	size_t (*serialize)(const void *value, void *buffer, size_t size, void *arg),
+	void *arg
+);
+
+//! Map an image file in a #MappedTable
+/*!
+  Only the header is read and validated, the checksum is not verified unless
+  requested because that reads the whole file. Without verification the
+  lookups and the thaw functions still check the range of every bucket and
+  record they use, and ignore the records out of range.
+
+  \param[out] out Pointer to #MappedTable object to construct.
+  \param[in] filename Path of a file created by #dumpMappedHashTable or
+  #dumpMappedBinaryTree.
+  \param[in] verify When not zero also call #verifyMappedTable.
+  \return 0 on success, -1 when the file can't be mapped or is not valid.
+*/
+int openMappedTable(MappedTable *out, const char *filename, int verify);
+
+//! Unmap a #MappedTable
+/*!
+  \param[out] out Pointer to #MappedTable object to free.
+*/
+void freeMappedTable(MappedTable *out);
+
+//! Verify the checksum and the records of a #MappedTable O(n)
+/*!
+  \param[in] in Pointer to #MappedTable object.
+  \return 1 when the image is valid and 0 otherwise.
+*/
+int verifyMappedTable(const MappedTable *in);
+
+//! Search for a key in the #MappedTable
+/*!
+  O(1 + n/m) for #MAPPED_TABLE_HASH and O(log(n)) for #MAPPED_TABLE_TREE.
+
+  \param[in] in Pointer to #MappedTable object.
+  \param[in] key Key to search.
+  \param[out] size If not NULL it is set to the size of the value.
+  \return A pointer to the serialized value in the mapping or NULL.
+*/
+const void *getKeyMappedTable(const MappedTable *in, int key, size_t *size);
+
+//! Create a mutable #HashTable from a #MappedTable
+/*!
+  \param[in] in Pointer to #MappedTable object (of any type).
+  \param[inout] out Pointer to an initialized #HashTable to fill.
+  \param[in] deserialize Function creating a value (owned by the table) from
+  its serialized bytes. When NULL the values are copies of the bytes.
+  \param[inout] arg Argument to pass to the deserializer.
+*/
+void thawMappedHashTable(
+	const MappedTable *in, HashTable *out,
+	void *(*deserialize)(const void *buffer, size_t size, void *arg),
+	void *arg
+);
+
+//! Create a mutable #BinaryTree from a #MappedTable
+/*!
+  The nodes are inserted in an order that keeps the tree balanced.
+
+  \param[in] in Pointer to #MappedTable object (of any type).
+  \param[inout] out Pointer to an initialized #BinaryTree to fill.
+  \param[in] deserialize Like in #thawMappedHashTable.
+  \param[inout] arg Argument to pass to the deserializer.
+*/
+void thawMappedBinaryTree(
+	const MappedTable *in, BinaryTree *out,
+	void *(*deserialize)(const void *buffer, size_t size, void *arg),
+	void *arg
+);
+
+//!@}
+
+// Concurrent Hash Table =======================================================
+
+/*!
+  \defgroup concurrenthashtable Thread safe Hash table with lock-free readers
+  \brief This is a chained hash table for concurrent accesses.
+
+  The writers (insertions and removals) take a lock from a striped array
+  protecting a set of buckets, while the readers traverse the bucket lists
+  without any lock. The nodes are never modified after they are reachable
+  (updates replace the node) and removed nodes are released with epoch-based
+  reclamation (#EpochDomain): they are freed only when all the readers that
+  could see them have finished. The threads are registered in the domain
+  automatically on their first access.
+  @{
+*/
+
+//! Lock of a set of buckets of the #ConcurrentHashTable
+typedef struct ConcurrentHashTableLock {
+	pthread_mutex_t lock;       /*!< Writers lock. */
+} __attribute__((aligned(64))) ConcurrentHashTableLock;
+
+//! Concurrent Hash Table container
+typedef struct ConcurrentHashTable {
+	size_t N;                   /*!< Number of buckets. */
+	size_t entries;             /*!< Number of entries (updated atomically). */
+	DoubleLinkedList *table;    /*!< Array of buckets. */
+	size_t nLocks;              /*!< Number of locks (stripes). */
+	ConcurrentHashTableLock *locks; /*!< Bucket b is protected by locks[b % nLocks]. */
+	EpochDomain epoch;          /*!< Reclamation domain for the nodes. */
+} ConcurrentHashTable;
+
+//! Constructor for #ConcurrentHashTable container
+/*!
+  \param[out] out Pointer to #ConcurrentHashTable object to construct.
+  \param[in] N Number of buckets.
+  \param[in] nLocks Number of writer locks (stripes).
+*/
+void allocInitConcurrentHashTable(ConcurrentHashTable *out, size_t N, size_t nLocks);
+
+//! Destructor for #ConcurrentHashTable container
+/*!
+  No other thread can access the table during or after this call.
+
+  \param[out] out Pointer to #ConcurrentHashTable object to free. This also
+  releases all the elements contained and the retired ones.
+*/
+void freeConcurrentHashTable(ConcurrentHashTable *out);
+
+//! Insert or update a key in the #ConcurrentHashTable O(1 + n/m)
+/*!
+  An update replaces the node, so the readers see either the old or the new
+  value, the old value is released when no reader can access it.
+
+  \param[inout] out Pointer to #ConcurrentHashTable object.
+  \param[in] key Key to insert.
+  \param[in] value Pointer object associated with the key (owned by the table).
+*/
+void insertKeyConcurrentHashTable(ConcurrentHashTable *out, int key, void *value);
+
+//! Search for a key in the #ConcurrentHashTable without locks O(1 + n/m)
+/*!
+  The func is called with the node inside the reader critical section, the
+  node must not be accessed after func returns.
+
+  \param[in] in Pointer to #ConcurrentHashTable object.
+  \param[in] key Key to search.
+  \param[in] func Function to apply on the node when found. May be NULL.
+  \param[inout] arg argument to pass to the function.
+  \return 1 if the key was found, 0 otherwise.
+*/
+int getKeyConcurrentHashTable(
+	ConcurrentHashTable *in, int key,
+	void (*func)(const HashTableNode *, void *),
+	void *arg
+);
+
+//! Remove a key from the #ConcurrentHashTable O(1 + n/m)
+/*!
+  \param[inout] out Pointer to #ConcurrentHashTable object.
+  \param[in] key Key to remove.
+  \return 1 when the key was removed or 0 when it was not found.
+*/
+int popKeyConcurrentHashTable(ConcurrentHashTable *out, int key);
 
 //!@}
 #endif // C_CONTAINER_H
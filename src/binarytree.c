@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "c-container.h"
+#include "c-container-internal.h"
 
 static BinaryTreeNode *_allocInitBinaryTreeNode(int key, void *value)
 {
@@ -33,17 +34,17 @@ static BinaryTreeNode *_allocInitBinaryTreeNode(int key, void *value)
 	return node;
 }
 
-static void _freeBinaryTreeNode(BinaryTreeNode *node)
+static void _freeBinaryTreeNode(BinaryTreeNode *node, const ValueOps *ops)
 {
 	assert(node != NULL);
 
 	if (node->left != NULL)
-		_freeBinaryTreeNode(node->left);
+		_freeBinaryTreeNode(node->left, ops);
 
 	if (node->right != NULL)
-		_freeBinaryTreeNode(node->right);
+		_freeBinaryTreeNode(node->right, ops);
 
-	free(node->value);
+	_destroyValue(ops, node->value);
 	free(node);
 }
 
@@ -53,12 +54,60 @@ void allocInitBinaryTree(BinaryTree *out)
 	out->tree = NULL;
 	out->start = NULL;
 	out->end = NULL;
+	out->filter = NULL;
+	out->compare = compareBytesKey;
+	out->ops = &ownedValueOps;
+	out->bytesKeys = 0;
 }
 
 void freeBinaryTree(BinaryTree *out)
 {
 	if (out->tree != NULL)
-		_freeBinaryTreeNode(out->tree);
+		_freeBinaryTreeNode(out->tree, out->ops);
+
+	setFilterBinaryTree(out, FILTER_NONE);
+}
+
+static void _insertFilterBinaryTreeNode(BinaryTreeNode *node, void *filter)
+{
+	insertKeyFilter((Filter *) filter, node->key);
+}
+
+static void _fillFilterBinaryTree(BinaryTree *out, size_t capacity)
+{
+	clearFilter(out->filter, capacity);
+	dsfBinaryTree(out, _insertFilterBinaryTreeNode, out->filter);
+}
+
+// Rebuild the filter when the insertions and removals degraded it.
+static void _syncFilterBinaryTree(BinaryTree *out)
+{
+	if (out->filter != NULL && needsRebuildFilter(out->filter))
+		_fillFilterBinaryTree(out, _rebuildCapacityFilter(out->filter, out->entries));
+}
+
+void setFilterBinaryTree(BinaryTree *out, FilterType type)
+{
+	if (out->filter != NULL) {
+		freeFilter(out->filter);
+		free(out->filter);
+		out->filter = NULL;
+	}
+
+	if (type == FILTER_NONE)
+		return;
+
+	out->filter = malloc(sizeof(Filter));
+	assert(out->filter != NULL);
+
+	allocInitFilter(out->filter, type, out->entries);
+	_fillFilterBinaryTree(out, out->entries);
+}
+
+void setValueOpsBinaryTree(BinaryTree *out, const ValueOps *ops)
+{
+	assert(out->entries == 0);
+	out->ops = ops != NULL ? ops : &ownedValueOps;
 }
 
 BinaryTreeNode **_getSlotBinaryTree(BinaryTreeNode **root, int key)
@@ -81,12 +130,16 @@ BinaryTreeNode **_getSlotBinaryTree(BinaryTreeNode **root, int key)
 BinaryTreeNode *insertBinaryTree(BinaryTree *out, int key, void *value)
 {
 	BinaryTreeNode **it = _getSlotBinaryTree(&out->tree, key);
+	value = _cloneValue(out->ops, value);
 
 	if (*it == NULL) {
 		*it = _allocInitBinaryTreeNode(key, value);
 		out->entries++;
+
+		if (out->filter != NULL && !insertKeyFilter(out->filter, key))
+			_syncFilterBinaryTree(out);
 	} else {
-		free((*it)->value);
+		_destroyValue(out->ops, (*it)->value);
 		(*it)->value = value;
 	}
 
@@ -95,13 +148,17 @@ BinaryTreeNode *insertBinaryTree(BinaryTree *out, int key, void *value)
 
 BinaryTreeNode *getKeyBinaryTree(BinaryTree *out, int key)
 {
+	if (out->filter != NULL && !containsKeyFilter(out->filter, key))
+		return NULL;
+
 	BinaryTreeNode **it = _getSlotBinaryTree(&out->tree, key);
 	return *it;
 }
 
 
-static int _removeKeyBinaryTree(BinaryTreeNode **root, int key)
-{
+static int _removeKeyBinaryTree(
+	BinaryTreeNode **root, int key, const ValueOps *ops
+) {
 	assert(root != NULL);
 	assert(*root != NULL);
 
@@ -110,7 +167,7 @@ static int _removeKeyBinaryTree(BinaryTreeNode **root, int key)
 	if (*it == NULL)
 		return 0;
 
-	free((*it)->value);
+	_destroyValue(ops, (*it)->value);
 
 	if ((*it)->left == NULL && (*it)->right == NULL) {
 		// No siblings
@@ -132,10 +189,10 @@ static int _removeKeyBinaryTree(BinaryTreeNode **root, int key)
 		// Then switch the nodes
 		(*it)->key = tmp->key;
 		(*it)->value = tmp->value;
-		tmp->value = NULL;   // free on NULL is save.
+		tmp->value = NULL;   // NULL values are not destroyed.
 
 		// Call recursively to remove the tmp node applying the same methodology
-		int removed = _removeKeyBinaryTree(&(*it)->right, tmp->key);
+		int removed = _removeKeyBinaryTree(&(*it)->right, tmp->key, ops);
 		assert(removed == 1);
 	}
 	return 1;
@@ -143,8 +200,17 @@ static int _removeKeyBinaryTree(BinaryTreeNode **root, int key)
 
 int popKeyBinaryTree(BinaryTree *out, int key)
 {
-	int removed = _removeKeyBinaryTree(&(out->tree), key);
+	if (out->filter != NULL && !containsKeyFilter(out->filter, key))
+		return 0;
+
+	int removed = _removeKeyBinaryTree(&(out->tree), key, out->ops);
 	out->entries -= removed;
+
+	if (removed && out->filter != NULL) {
+		removeKeyFilter(out->filter, key);
+		_syncFilterBinaryTree(out);
+	}
+
 	return removed;
 }
 
@@ -203,3 +269,156 @@ void dsfBinaryTree(
 	if (inout->tree != NULL)
 		_dsfBinaryTreeNode(inout->tree, func, arg);
 }
+
+// Byte string keys ============================================================
+
+void setCompareBinaryTree(
+	BinaryTree *out, int (*compare)(const BytesKey *a, const BytesKey *b)
+) {
+	assert(out->entries == 0);
+	out->compare = compare != NULL ? compare : compareBytesKey;
+}
+
+static BinaryTreeNode **_getBytesKeySlotBinaryTree(
+	BinaryTree *in, const BytesKey *key
+) {
+	BinaryTreeNode **it = &in->tree;
+
+	while (*it != NULL) {
+		const BytesKey *nodeKey = BYTES_KEY_NODE(BinaryTreeNode, *it);
+
+		// Equal keys have equal hashes, so compare only when they match or to
+		// choose the direction.
+		const int cmp = (nodeKey->hash == key->hash
+		                 && _equalBytesKey(nodeKey, key->hash, key->bytes, key->length))
+			? 0
+			: in->compare(key, nodeKey);
+
+		if (cmp > 0) {
+			it = &((*it)->right);
+		} else if (cmp < 0) {
+			it = &((*it)->left);
+		} else {
+			break;
+		}
+	}
+	return it;
+}
+
+// The lookups need a BytesKey to compare, this is a temporary copy of the
+// key in the stack when it is small.
+#define BINARY_TREE_STACK_KEY 256
+
+static BinaryTreeNode **_getBytesKeyRefBinaryTree(
+	BinaryTree *in, const void *key, size_t length, uint64_t hash
+) {
+	union {
+		BytesKey key;
+		unsigned char buffer[sizeof(BytesKey) + BINARY_TREE_STACK_KEY];
+	} stack;
+
+	BytesKey *tmp = (length <= BINARY_TREE_STACK_KEY)
+		? &stack.key
+		: malloc(sizeof(BytesKey) + length);
+	assert(tmp != NULL);
+
+	_initBytesKey(tmp, hash, key, length);
+	BinaryTreeNode **it = _getBytesKeySlotBinaryTree(in, tmp);
+
+	if (tmp != &stack.key)
+		free(tmp);
+
+	return it;
+}
+
+BinaryTreeNode *insertBytesKeyBinaryTree(
+	BinaryTree *out, const void *key, size_t length, void *value
+) {
+	const uint64_t hash = hashBytesKey(key, length);
+	BinaryTreeNode **it = _getBytesKeyRefBinaryTree(out, key, length, hash);
+
+	value = _cloneValue(out->ops, value);
+
+	if (*it != NULL) {
+		_destroyValue(out->ops, (*it)->value);
+		(*it)->value = value;
+		return *it;
+	}
+
+	BinaryTreeNode *node = malloc(BYTES_KEY_NODE_SIZE(BinaryTreeNode, length));
+	assert(node != NULL);
+
+	node->key = (int) hash;
+	node->value = value;
+	node->left = NULL;
+	node->right = NULL;
+	_initBytesKey(BYTES_KEY_NODE(BinaryTreeNode, node), hash, key, length);
+	out->bytesKeys = 1;
+
+	*it = node;
+	out->entries++;
+
+	if (out->filter != NULL && !insertKeyFilter(out->filter, node->key))
+		_syncFilterBinaryTree(out);
+
+	return node;
+}
+
+BinaryTreeNode *getBytesKeyBinaryTree(BinaryTree *in, const void *key, size_t length)
+{
+	const uint64_t hash = hashBytesKey(key, length);
+
+	if (in->filter != NULL && !containsKeyFilter(in->filter, (int) hash))
+		return NULL;
+
+	return *_getBytesKeyRefBinaryTree(in, key, length, hash);
+}
+
+int popBytesKeyBinaryTree(BinaryTree *out, const void *key, size_t length)
+{
+	const uint64_t hash = hashBytesKey(key, length);
+
+	if (out->filter != NULL && !containsKeyFilter(out->filter, (int) hash))
+		return 0;
+
+	BinaryTreeNode **it = _getBytesKeyRefBinaryTree(out, key, length, hash);
+	BinaryTreeNode *node = *it;
+
+	if (node == NULL)
+		return 0;
+
+	// The keys are inline, so relink the nodes instead of swapping contents.
+	if (node->left == NULL) {
+		*it = node->right;
+	} else if (node->right == NULL) {
+		*it = node->left;
+	} else {
+		// Replace the node with the lowest one of the right subtree.
+		BinaryTreeNode **next = &node->right;
+		while ((*next)->left != NULL)
+			next = &(*next)->left;
+
+		BinaryTreeNode *successor = *next;
+		*next = successor->right;
+
+		successor->left = node->left;
+		successor->right = node->right;
+		*it = successor;
+	}
+
+	_destroyValue(out->ops, node->value);
+	free(node);
+	out->entries--;
+
+	if (out->filter != NULL) {
+		removeKeyFilter(out->filter, (int) hash);
+		_syncFilterBinaryTree(out);
+	}
+
+	return 1;
+}
+
+const BytesKey *getBytesKeyBinaryTreeNode(const BinaryTreeNode *node)
+{
+	return BYTES_KEY_NODE(BinaryTreeNode, node);
+}
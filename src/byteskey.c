@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Byte string keys ============================================================
+
+static inline uint64_t _mixBytesKey(uint64_t hash)
+{
+	// MurmurHash3 finalizer
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+uint64_t hashBytesKey(const void *bytes, size_t length)
+{
+	const unsigned char *it = bytes;
+	uint64_t hash = 0x9e3779b97f4a7c15ULL ^ length;
+
+	// 8 bytes per step
+	for (; length >= sizeof(uint64_t); length -= sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, it, sizeof(word));
+		it += sizeof(word);
+
+		hash ^= word * 0x87c37b91114253d5ULL;
+		hash = ((hash << 31) | (hash >> 33)) * 0x4cf5ad432745937fULL;
+	}
+
+	uint64_t tail = 0;
+	memcpy(&tail, it, length);
+	hash ^= tail * 0x87c37b91114253d5ULL;
+
+	return _mixBytesKey(hash);
+}
+
+int compareBytesKey(const BytesKey *a, const BytesKey *b)
+{
+	const size_t length = a->length < b->length ? a->length : b->length;
+
+	const int cmp = memcmp(a->bytes, b->bytes, length);
+	if (cmp != 0)
+		return cmp;
+
+	return (a->length > b->length) - (a->length < b->length);
+}
+
+void _initBytesKey(BytesKey *out, uint64_t hash, const void *bytes, size_t length)
+{
+	out->hash = hash;
+	out->length = length;
+	memcpy(out->bytes, bytes, length);
+}
+
+int _equalBytesKey(const BytesKey *in, uint64_t hash, const void *bytes, size_t length)
+{
+	// The bytes are only compared when the hash matches.
+	return in->hash == hash
+		&& in->length == length
+		&& memcmp(in->bytes, bytes, length) == 0;
+}
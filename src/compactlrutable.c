@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Nodes =======================================================================
+
+static inline CompactlruTableNode *_getNodeCompactlruTable(
+	CompactlruTable *in, uint32_t index
+) {
+	assert(index < in->maxEntries);
+	return (CompactlruTableNode *) (in->nodes + (size_t) index * in->nodeSize);
+}
+
+static inline uint32_t *_getBucketCompactlruTable(CompactlruTable *in, int key)
+{
+	return &in->buckets[(size_t) key % in->N];
+}
+
+// Returns the pointer to the link pointing to the key node (or to NIL).
+static uint32_t *_findCompactlruTable(CompactlruTable *in, int key)
+{
+	uint32_t *link = _getBucketCompactlruTable(in, key);
+
+	while (*link != COMPACT_LRU_TABLE_NIL) {
+		CompactlruTableNode *node = _getNodeCompactlruTable(in, *link);
+		if (node->key == key)
+			break;
+		link = &node->next;
+	}
+
+	return link;
+}
+
+// Access list =================================================================
+
+static void _disconnectAccessCompactlruTable(CompactlruTable *in, uint32_t index)
+{
+	CompactlruTableNode *node = _getNodeCompactlruTable(in, index);
+
+	if (node->left != COMPACT_LRU_TABLE_NIL)
+		_getNodeCompactlruTable(in, node->left)->right = node->right;
+	else
+		in->accesList = node->right;
+
+	if (node->right != COMPACT_LRU_TABLE_NIL)
+		_getNodeCompactlruTable(in, node->right)->left = node->left;
+	else
+		in->lastAccess = node->left;
+
+	node->left = COMPACT_LRU_TABLE_NIL;
+	node->right = COMPACT_LRU_TABLE_NIL;
+}
+
+static void _registerAccessCompactlruTable(CompactlruTable *in, uint32_t index)
+{
+	CompactlruTableNode *node = _getNodeCompactlruTable(in, index);
+
+	node->left = in->lastAccess;
+	node->right = COMPACT_LRU_TABLE_NIL;
+
+	if (in->lastAccess != COMPACT_LRU_TABLE_NIL)
+		_getNodeCompactlruTable(in, in->lastAccess)->right = index;
+	else
+		in->accesList = index;
+
+	in->lastAccess = index;
+}
+
+// Compact LRU Table ===========================================================
+
+void initStaticCompactlruTable(
+	CompactlruTable *out, void *buffer, size_t size,
+	size_t N, size_t maxEntries, size_t valueSize
+) {
+	assert(N > 0);
+	assert(maxEntries > 0);
+	assert(maxEntries < COMPACT_LRU_TABLE_NIL);
+	assert(buffer != NULL);
+	assert((uintptr_t) buffer % 8 == 0);
+	assert(size >= COMPACT_LRU_TABLE_BUFFER_SIZE(N, maxEntries, valueSize));
+	(void) size;
+
+	out->N = N;
+	out->entries = 0;
+	out->maxEntries = maxEntries;
+	out->valueSize = valueSize;
+
+	// Keep the inline values aligned for 64-bit types.
+	out->nodeSize = COMPACT_LRU_TABLE_NODE_SIZE(valueSize);
+
+	// The nodes go first to keep their alignment.
+	out->nodes = buffer;
+	out->buckets = (uint32_t *) (out->nodes + maxEntries * out->nodeSize);
+
+	// All bits set is COMPACT_LRU_TABLE_NIL
+	memset(out->buckets, 0xff, N * sizeof(uint32_t));
+
+	out->accesList = COMPACT_LRU_TABLE_NIL;
+	out->lastAccess = COMPACT_LRU_TABLE_NIL;
+	out->owner = 0;
+}
+
+void allocInitCompactlruTable(
+	CompactlruTable *out, size_t N, size_t maxEntries, size_t valueSize
+) {
+	const size_t size = COMPACT_LRU_TABLE_BUFFER_SIZE(N, maxEntries, valueSize);
+
+	void *buffer = malloc(size);
+	assert(buffer != NULL);
+
+	initStaticCompactlruTable(out, buffer, size, N, maxEntries, valueSize);
+	out->owner = 1;
+}
+
+void freeCompactlruTable(CompactlruTable *out)
+{
+	if (out->owner)
+		free(out->nodes);
+
+	out->buckets = NULL;
+	out->nodes = NULL;
+	out->N = 0;
+	out->entries = 0;
+	out->maxEntries = 0;
+	out->accesList = COMPACT_LRU_TABLE_NIL;
+	out->lastAccess = COMPACT_LRU_TABLE_NIL;
+}
+
+void *insertKeyCompactlruTable(CompactlruTable *out, int key, const void *value)
+{
+	uint32_t *link = _findCompactlruTable(out, key);
+	uint32_t index = *link;
+
+	if (index != COMPACT_LRU_TABLE_NIL) {
+		// Node exist, so update value only
+		_disconnectAccessCompactlruTable(out, index);
+	} else {
+		if (out->entries < out->maxEntries) {
+			// The nodes are used in order while filling the table.
+			index = out->entries++;
+		} else {
+			// Reuse the Least Recently Used node.
+			index = out->accesList;
+			_disconnectAccessCompactlruTable(out, index);
+
+			CompactlruTableNode *victim = _getNodeCompactlruTable(out, index);
+			uint32_t *victimLink = _findCompactlruTable(out, victim->key);
+			assert(*victimLink == index);
+			*victimLink = victim->next;
+		}
+
+		uint32_t *bucket = _getBucketCompactlruTable(out, key);
+		CompactlruTableNode *node = _getNodeCompactlruTable(out, index);
+		node->key = key;
+		node->next = *bucket;
+		*bucket = index;
+	}
+
+	CompactlruTableNode *node = _getNodeCompactlruTable(out, index);
+	memcpy(node->value, value, out->valueSize);
+	_registerAccessCompactlruTable(out, index);
+
+	return node->value;
+}
+
+void *getKeyCompactlruTable(CompactlruTable *in, int key)
+{
+	const uint32_t index = *_findCompactlruTable(in, key);
+
+	if (index == COMPACT_LRU_TABLE_NIL)
+		return NULL;
+
+	if (index != in->lastAccess) {
+		_disconnectAccessCompactlruTable(in, index);
+		_registerAccessCompactlruTable(in, index);
+	}
+
+	return _getNodeCompactlruTable(in, index)->value;
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Epoch-based reclamation =====================================================
+
+static void _freeNodeConcurrentHashTable(void *node)
+{
+	_freeLinkedListNode(node, &ownedValueOps);
+}
+
+// Buckets =====================================================================
+
+static inline DoubleLinkedList *_getBucketConcurrentHashTable(
+	ConcurrentHashTable *in, int key, pthread_mutex_t **lock
+) {
+	const size_t hash = (size_t) key % in->N;
+
+	if (lock != NULL)
+		*lock = &in->locks[hash % in->nLocks].lock;
+
+	return &in->table[hash];
+}
+
+// Writers only, they hold the bucket lock.
+static HashTableNode *_findConcurrentHashTable(DoubleLinkedList *bucket, int key)
+{
+	LinkedListNode *it = bucket->list;
+
+	while (it != NULL && it->key != key)
+		it = it->next;
+
+	return (HashTableNode *) it;
+}
+
+// Make node reachable where old was (or at the end of the bucket).
+static void _linkConcurrentHashTable(
+	DoubleLinkedList *bucket, HashTableNode *node, HashTableNode *old
+) {
+	HashTableNode *prev = old != NULL ? old->last : (HashTableNode *) bucket->last;
+	HashTableNode *next = old != NULL ? (HashTableNode *) old->next : NULL;
+
+	node->last = prev;
+	node->next = (LinkedListNode *) next;
+
+	// The release store publishes the node content to the readers.
+	LinkedListNode **link = prev != NULL ? &prev->next : &bucket->list;
+	__atomic_store_n(link, (LinkedListNode *) node, __ATOMIC_RELEASE);
+
+	if (next != NULL)
+		next->last = node;
+	else
+		bucket->last = (LinkedListNode *) node;
+}
+
+// The node keeps its next pointer, so the readers on it can continue.
+static void _unlinkConcurrentHashTable(DoubleLinkedList *bucket, HashTableNode *node)
+{
+	HashTableNode *prev = node->last;
+	HashTableNode *next = (HashTableNode *) node->next;
+
+	LinkedListNode **link = prev != NULL ? &prev->next : &bucket->list;
+	__atomic_store_n(link, (LinkedListNode *) next, __ATOMIC_RELEASE);
+
+	if (next != NULL)
+		next->last = prev;
+	else
+		bucket->last = (LinkedListNode *) prev;
+}
+
+// Concurrent Hash Table =======================================================
+
+void allocInitConcurrentHashTable(ConcurrentHashTable *out, size_t N, size_t nLocks)
+{
+	assert(N > 0);
+	assert(nLocks > 0);
+
+	out->N = N;
+	out->entries = 0;
+	out->nLocks = nLocks;
+
+	out->table = malloc(N * sizeof(DoubleLinkedList));
+	assert(out->table != NULL);
+	for (size_t i = 0; i < N; ++i)
+		allocInitDoubleLinkedList(&out->table[i]);
+
+	void *locks = NULL;
+	int ret = posix_memalign(&locks, 64, nLocks * sizeof(ConcurrentHashTableLock));
+	assert(ret == 0);
+	(void) ret;
+
+	out->locks = locks;
+	for (size_t i = 0; i < nLocks; ++i)
+		pthread_mutex_init(&out->locks[i].lock, NULL);
+
+	allocInitEpochDomain(&out->epoch);
+}
+
+void freeConcurrentHashTable(ConcurrentHashTable *out)
+{
+	freeEpochDomain(&out->epoch);
+
+	for (size_t i = 0; i < out->N; ++i)
+		freeDoubleLinkedList(&out->table[i]);
+	free(out->table);
+	out->table = NULL;
+
+	for (size_t i = 0; i < out->nLocks; ++i)
+		pthread_mutex_destroy(&out->locks[i].lock);
+	free(out->locks);
+	out->locks = NULL;
+
+	out->N = 0;
+	out->nLocks = 0;
+	out->entries = 0;
+}
+
+void insertKeyConcurrentHashTable(ConcurrentHashTable *out, int key, void *value)
+{
+	HashTableNode *node = _allocInitDoubleLinkedListNode(NULL, key, value);
+
+	pthread_mutex_t *lock;
+	DoubleLinkedList *bucket = _getBucketConcurrentHashTable(out, key, &lock);
+
+	pthread_mutex_lock(lock);
+
+	HashTableNode *old = _findConcurrentHashTable(bucket, key);
+	_linkConcurrentHashTable(bucket, node, old);
+
+	if (old == NULL) {
+		bucket->entries++;
+		__atomic_fetch_add(&out->entries, 1, __ATOMIC_RELAXED);
+	}
+
+	pthread_mutex_unlock(lock);
+
+	if (old != NULL) {
+		EpochThread *thread = getThreadEpochDomain(&out->epoch);
+		retireEpochDomain(thread, old, _freeNodeConcurrentHashTable);
+	}
+}
+
+int getKeyConcurrentHashTable(
+	ConcurrentHashTable *in, int key,
+	void (*func)(const HashTableNode *, void *),
+	void *arg
+) {
+	DoubleLinkedList *bucket = _getBucketConcurrentHashTable(in, key, NULL);
+
+	EpochThread *thread = getThreadEpochDomain(&in->epoch);
+	enterEpochDomain(thread);
+
+	LinkedListNode *it = __atomic_load_n(&bucket->list, __ATOMIC_ACQUIRE);
+	while (it != NULL && it->key != key)
+		it = __atomic_load_n(&it->next, __ATOMIC_ACQUIRE);
+
+	if (it != NULL && func != NULL)
+		func((const HashTableNode *) it, arg);
+
+	exitEpochDomain(thread);
+
+	return it != NULL;
+}
+
+int popKeyConcurrentHashTable(ConcurrentHashTable *out, int key)
+{
+	pthread_mutex_t *lock;
+	DoubleLinkedList *bucket = _getBucketConcurrentHashTable(out, key, &lock);
+
+	pthread_mutex_lock(lock);
+
+	HashTableNode *node = _findConcurrentHashTable(bucket, key);
+	if (node != NULL) {
+		_unlinkConcurrentHashTable(bucket, node);
+		bucket->entries--;
+		__atomic_fetch_sub(&out->entries, 1, __ATOMIC_RELAXED);
+	}
+
+	pthread_mutex_unlock(lock);
+
+	if (node == NULL)
+		return 0;
+
+	EpochThread *thread = getThreadEpochDomain(&out->epoch);
+	retireEpochDomain(thread, node, _freeNodeConcurrentHashTable);
+	return 1;
+}
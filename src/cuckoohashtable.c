@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Maximum number of buckets visited by the displacement search.
+#define CUCKOO_HASH_TABLE_MAX_SEARCH 512
+
+// Buckets =====================================================================
+
+static inline size_t _hash1CuckooHashTable(const CuckooHashTable *in, int key)
+{
+	const uint64_t mixed = (uint64_t)(uint32_t) key * 0x9E3779B97F4A7C15ull;
+	return (size_t)(mixed >> 32) & (in->nBuckets - 1);
+}
+
+static inline size_t _hash2CuckooHashTable(const CuckooHashTable *in, int key)
+{
+	const uint64_t mixed = ((uint64_t)(uint32_t) key ^ 0x5bd1e995u) * 0xC2B2AE3D27D4EB4Full;
+	size_t hash = (size_t)(mixed >> 32) & (in->nBuckets - 1);
+
+	// The two buckets must be different to have somewhere to move the key.
+	if (hash == _hash1CuckooHashTable(in, key))
+		hash = (hash + 1) & (in->nBuckets - 1);
+
+	return hash;
+}
+
+static inline size_t _alternativeCuckooHashTable(
+	const CuckooHashTable *in, int key, size_t bucket
+) {
+	const size_t hash1 = _hash1CuckooHashTable(in, key);
+	return bucket == hash1 ? _hash2CuckooHashTable(in, key) : hash1;
+}
+
+static inline int _findSlotCuckooHashTable(const CuckooHashTableBucket *bucket, int key)
+{
+	for (int i = 0; i < CUCKOO_HASH_TABLE_SLOTS; ++i)
+		if ((bucket->used & (1 << i)) && bucket->keys[i] == key)
+			return i;
+	return -1;
+}
+
+static inline int _freeSlotCuckooHashTable(const CuckooHashTableBucket *bucket)
+{
+	for (int i = 0; i < CUCKOO_HASH_TABLE_SLOTS; ++i)
+		if (!(bucket->used & (1 << i)))
+			return i;
+	return -1;
+}
+
+static CuckooHashTableBucket *_allocBucketsCuckooHashTable(size_t nBuckets)
+{
+	void *buckets = NULL;
+	int ret = posix_memalign(&buckets, 64, nBuckets * sizeof(CuckooHashTableBucket));
+	assert(ret == 0);
+	(void) ret;
+
+	memset(buckets, 0, nBuckets * sizeof(CuckooHashTableBucket));
+	return buckets;
+}
+
+// Displacement ================================================================
+
+struct CuckooHashTableStep {
+	size_t bucket;
+	int parent;     // Index of the previous step, -1 for the two roots.
+	int slot;       // Slot of the parent moved to this bucket.
+};
+
+// Breadth first search of the shortest displacement path to a free slot, it
+// moves the keys and returns the free slot in one of the key buckets.
+static void **_displaceCuckooHashTable(CuckooHashTable *out, int key, size_t *bucket)
+{
+	struct CuckooHashTableStep queue[CUCKOO_HASH_TABLE_MAX_SEARCH];
+	int head = 0, tail = 0;
+
+	queue[tail++] = (struct CuckooHashTableStep) {_hash1CuckooHashTable(out, key), -1, -1};
+	queue[tail++] = (struct CuckooHashTableStep) {_hash2CuckooHashTable(out, key), -1, -1};
+
+	while (head < tail) {
+		const int current = head++;
+		const size_t index = queue[current].bucket;
+		CuckooHashTableBucket *it = &out->buckets[index];
+
+		int slot = _freeSlotCuckooHashTable(it);
+		if (slot >= 0) {
+			// Move the keys backward along the path.
+			for (int step = current; queue[step].parent >= 0; step = queue[step].parent) {
+				const struct CuckooHashTableStep *from = &queue[queue[step].parent];
+				CuckooHashTableBucket *src = &out->buckets[from->bucket];
+				CuckooHashTableBucket *dst = &out->buckets[queue[step].bucket];
+
+				dst->keys[slot] = src->keys[queue[step].slot];
+				dst->values[slot] = src->values[queue[step].slot];
+				dst->used |= 1 << slot;
+
+				slot = queue[step].slot;
+				src->used &= ~(1 << slot);
+			}
+
+			// The root of the path is one of the key buckets
+			struct CuckooHashTableStep *root = &queue[current];
+			while (root->parent >= 0)
+				root = &queue[root->parent];
+
+			*bucket = root->bucket;
+			return &out->buckets[root->bucket].values[slot];
+		}
+
+		for (int i = 0; i < CUCKOO_HASH_TABLE_SLOTS && tail < CUCKOO_HASH_TABLE_MAX_SEARCH; ++i)
+			queue[tail++] = (struct CuckooHashTableStep) {
+				_alternativeCuckooHashTable(out, it->keys[i], index), current, i
+			};
+	}
+
+	return NULL;
+}
+
+// Insert a key known to be missing, NULL when there is no room.
+static void **_insertNewCuckooHashTable(CuckooHashTable *out, int key, void *value)
+{
+	size_t bucket;
+	void **slot = _displaceCuckooHashTable(out, key, &bucket);
+
+	if (slot == NULL)
+		return NULL;
+
+	CuckooHashTableBucket *it = &out->buckets[bucket];
+	const int index = slot - it->values;
+
+	it->keys[index] = key;
+	it->values[index] = value;
+	it->used |= 1 << index;
+	out->entries++;
+
+	return slot;
+}
+
+static void _resizeCuckooHashTable(CuckooHashTable *out, size_t nBuckets)
+{
+	CuckooHashTableBucket *old = out->buckets;
+	const size_t oldBuckets = out->nBuckets;
+
+	for (;;) {
+		out->buckets = _allocBucketsCuckooHashTable(nBuckets);
+		out->nBuckets = nBuckets;
+		out->entries = 0;
+
+		int failed = 0;
+		for (size_t b = 0; b < oldBuckets && !failed; ++b)
+			for (int i = 0; i < CUCKOO_HASH_TABLE_SLOTS && !failed; ++i)
+				if (old[b].used & (1 << i))
+					failed = _insertNewCuckooHashTable(out, old[b].keys[i], old[b].values[i]) == NULL;
+
+		if (!failed)
+			break;
+
+		free(out->buckets);
+		nBuckets *= 2;
+	}
+
+	free(old);
+}
+
+// Cuckoo Hash Table ===========================================================
+
+void allocInitCuckooHashTable(CuckooHashTable *out, size_t N)
+{
+	// Start around 50% of load factor.
+	size_t nBuckets = 2;
+	while (nBuckets * CUCKOO_HASH_TABLE_SLOTS < 2 * N)
+		nBuckets *= 2;
+
+	out->entries = 0;
+	out->nBuckets = nBuckets;
+	out->buckets = _allocBucketsCuckooHashTable(nBuckets);
+}
+
+void freeCuckooHashTable(CuckooHashTable *out)
+{
+	for (size_t b = 0; b < out->nBuckets; ++b)
+		for (int i = 0; i < CUCKOO_HASH_TABLE_SLOTS; ++i)
+			if (out->buckets[b].used & (1 << i))
+				free(out->buckets[b].values[i]);
+
+	free(out->buckets);
+	out->buckets = NULL;
+	out->nBuckets = 0;
+	out->entries = 0;
+}
+
+void **getKeyCuckooHashTable(CuckooHashTable *in, int key)
+{
+	CuckooHashTableBucket *bucket = &in->buckets[_hash1CuckooHashTable(in, key)];
+	int slot = _findSlotCuckooHashTable(bucket, key);
+
+	if (slot < 0) {
+		bucket = &in->buckets[_hash2CuckooHashTable(in, key)];
+		slot = _findSlotCuckooHashTable(bucket, key);
+	}
+
+	return slot >= 0 ? &bucket->values[slot] : NULL;
+}
+
+void **insertKeyCuckooHashTable(CuckooHashTable *out, int key, void *value)
+{
+	void **slot = getKeyCuckooHashTable(out, key);
+
+	if (slot != NULL) {
+		// Key exist, so update value only
+		free(*slot);
+		*slot = value;
+		return slot;
+	}
+
+	while ((slot = _insertNewCuckooHashTable(out, key, value)) == NULL)
+		_resizeCuckooHashTable(out, 2 * out->nBuckets);
+
+	return slot;
+}
+
+int popKeyCuckooHashTable(CuckooHashTable *out, int key)
+{
+	const size_t buckets[2] = {_hash1CuckooHashTable(out, key), _hash2CuckooHashTable(out, key)};
+
+	for (int b = 0; b < 2; ++b) {
+		CuckooHashTableBucket *bucket = &out->buckets[buckets[b]];
+		const int slot = _findSlotCuckooHashTable(bucket, key);
+
+		if (slot >= 0) {
+			free(bucket->values[slot]);
+			bucket->used &= ~(1 << slot);
+			out->entries--;
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -48,6 +48,11 @@ void freeDoubleLinkedList(DoubleLinkedList *out)
 	freeLinkedList(out);
 }
 
+void freeWithOpsDoubleLinkedList(DoubleLinkedList *out, const ValueOps *ops)
+{
+	freeWithOpsLinkedList(out, ops);
+}
+
 DoubleLinkedListNode *insertNodeDoubleLinkedList(
 	DoubleLinkedList *out, DoubleLinkedListNode *node
 ) {
@@ -136,7 +141,7 @@ int popKeyDoubleLinkedList(DoubleLinkedList *out, int key)
 	DoubleLinkedListNode *tmp = _extractNodeDoubleLinkedList(out, node);
 	assert(tmp != NULL);
 
-	free(node);
+	free(node);  // The value remains owned by the caller.
 
 	return 1;
 }
@@ -152,7 +157,7 @@ int popIndexDoubleLinkedList(DoubleLinkedList *out, size_t index)
 	DoubleLinkedListNode *tmp = _extractNodeDoubleLinkedList(out, node);
 	assert(tmp != NULL);
 
-	free(node);
+	free(node);  // The value remains owned by the caller.
 
 	return 1;
 }
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Unique ids for the threads and the domains.
+static uint64_t _lastIdEpoch = 0;
+
+static __thread uint64_t _threadIdEpoch = 0;
+
+// Record of the calling thread in the last used domain.
+static __thread struct {
+	uint64_t id;
+	EpochThread *thread;
+} _cachedEpochThread;
+
+static uint64_t _getThreadIdEpoch()
+{
+	if (_threadIdEpoch == 0)
+		_threadIdEpoch = __atomic_add_fetch(&_lastIdEpoch, 1, __ATOMIC_RELAXED);
+
+	return _threadIdEpoch;
+}
+
+// Retired lists ===============================================================
+
+static void _pushRetiredEpoch(
+	EpochRetired **list, size_t *n, size_t *max, EpochRetired retired
+) {
+	if (*n == *max) {
+		*max = 2 * *max + EPOCH_RETIRE_BATCH;
+		*list = realloc(*list, *max * sizeof(EpochRetired));
+		assert(*list != NULL);
+	}
+
+	(*list)[(*n)++] = retired;
+}
+
+static int _isProtectedEpoch(EpochDomain *in, void *ptr)
+{
+	EpochThread *it = __atomic_load_n(&in->threads, __ATOMIC_ACQUIRE);
+
+	for (; it != NULL; it = it->next) {
+		for (size_t i = 0; i < EPOCH_HAZARD_POINTERS; ++i)
+			if (__atomic_load_n(&it->hazards[i], __ATOMIC_SEQ_CST) == ptr)
+				return 1;
+	}
+
+	return 0;
+}
+
+// Release the nodes retired two epochs ago (or all), returns the pending ones.
+static size_t _releaseRetiredEpoch(
+	EpochDomain *in, EpochRetired *list, size_t n, int force
+) {
+	const uint64_t global = __atomic_load_n(&in->global, __ATOMIC_ACQUIRE);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < n; ++i) {
+		if (force || (list[i].epoch + 2 <= global && !_isProtectedEpoch(in, list[i].ptr)))
+			list[i].freeFunc(list[i].ptr);
+		else
+			list[kept++] = list[i];
+	}
+
+	return kept;
+}
+
+static void _tryAdvanceEpoch(EpochDomain *in)
+{
+	uint64_t global = __atomic_load_n(&in->global, __ATOMIC_SEQ_CST);
+
+	EpochThread *it = __atomic_load_n(&in->threads, __ATOMIC_ACQUIRE);
+
+	for (; it != NULL; it = it->next) {
+		const uint64_t local = __atomic_load_n(&it->epoch, __ATOMIC_SEQ_CST);
+		if (local != 0 && local != global)
+			return;
+	}
+
+	// Other thread may have advanced it already, that's fine too.
+	__atomic_compare_exchange_n(&in->global, &global, global + 1, 0,
+	                            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+// Domain ======================================================================
+
+void allocInitEpochDomain(EpochDomain *out)
+{
+	out->id = __atomic_add_fetch(&_lastIdEpoch, 1, __ATOMIC_RELAXED);
+	out->global = 1;
+	out->threads = NULL;
+	pthread_mutex_init(&out->lock, NULL);
+
+	out->orphans = NULL;
+	out->nOrphans = 0;
+	out->maxOrphans = 0;
+}
+
+void freeEpochDomain(EpochDomain *out)
+{
+	EpochThread *it = out->threads;
+
+	while (it != NULL) {
+		EpochThread *next = it->next;
+
+		assert(it->epoch == 0);
+		_releaseRetiredEpoch(out, it->retired, it->nRetired, 1);
+		free(it->retired);
+		free(it);
+
+		it = next;
+	}
+	out->threads = NULL;
+
+	_releaseRetiredEpoch(out, out->orphans, out->nOrphans, 1);
+	free(out->orphans);
+	out->orphans = NULL;
+	out->nOrphans = 0;
+	out->maxOrphans = 0;
+
+	pthread_mutex_destroy(&out->lock);
+}
+
+EpochThread *registerThreadEpochDomain(EpochDomain *in)
+{
+	const uint64_t owner = _getThreadIdEpoch();
+
+	pthread_mutex_lock(&in->lock);
+
+	EpochThread *thread = in->threads;
+	while (thread != NULL && thread->active)
+		thread = thread->next;
+
+	if (thread == NULL) {
+		void *ptr = NULL;
+		int ret = posix_memalign(&ptr, 64, sizeof(EpochThread));
+		assert(ret == 0);
+		(void) ret;
+
+		thread = ptr;
+		thread->epoch = 0;
+		for (size_t i = 0; i < EPOCH_HAZARD_POINTERS; ++i)
+			thread->hazards[i] = NULL;
+		thread->retired = NULL;
+		thread->nRetired = 0;
+		thread->maxRetired = 0;
+		thread->domain = in;
+		thread->next = in->threads;
+		thread->active = 1;
+		thread->owner = owner;
+
+		// The readers of the list don't take the lock.
+		__atomic_store_n(&in->threads, thread, __ATOMIC_RELEASE);
+	} else {
+		thread->active = 1;
+		__atomic_store_n(&thread->owner, owner, __ATOMIC_RELAXED);
+	}
+
+	pthread_mutex_unlock(&in->lock);
+
+	_cachedEpochThread.id = in->id;
+	_cachedEpochThread.thread = thread;
+
+	return thread;
+}
+
+void unregisterThreadEpochDomain(EpochThread *thread)
+{
+	assert(thread->epoch == 0);
+	EpochDomain *domain = thread->domain;
+
+	for (size_t i = 0; i < EPOCH_HAZARD_POINTERS; ++i)
+		releaseEpochThread(thread, i);
+
+	thread->nRetired = _releaseRetiredEpoch(domain, thread->retired, thread->nRetired, 0);
+
+	pthread_mutex_lock(&domain->lock);
+
+	for (size_t i = 0; i < thread->nRetired; ++i)
+		_pushRetiredEpoch(&domain->orphans, &domain->nOrphans, &domain->maxOrphans,
+		                  thread->retired[i]);
+	thread->nRetired = 0;
+
+	__atomic_store_n(&thread->owner, 0, __ATOMIC_RELAXED);
+	thread->active = 0;
+
+	pthread_mutex_unlock(&domain->lock);
+
+	if (_cachedEpochThread.thread == thread)
+		_cachedEpochThread.id = 0;
+}
+
+EpochThread *getThreadEpochDomain(EpochDomain *in)
+{
+	if (_cachedEpochThread.id == in->id)
+		return _cachedEpochThread.thread;
+
+	// The thread may be registered but not cached if it used other domains.
+	const uint64_t owner = _getThreadIdEpoch();
+
+	EpochThread *it = __atomic_load_n(&in->threads, __ATOMIC_ACQUIRE);
+	for (; it != NULL; it = it->next) {
+		if (__atomic_load_n(&it->owner, __ATOMIC_RELAXED) == owner) {
+			_cachedEpochThread.id = in->id;
+			_cachedEpochThread.thread = it;
+			return it;
+		}
+	}
+
+	return registerThreadEpochDomain(in);
+}
+
+// Critical sections ===========================================================
+
+void enterEpochDomain(EpochThread *thread)
+{
+	assert(thread->epoch == 0);
+
+	const uint64_t global = __atomic_load_n(&thread->domain->global, __ATOMIC_ACQUIRE);
+	__atomic_store_n(&thread->epoch, global, __ATOMIC_RELAXED);
+
+	// The epoch must be visible before reading any node.
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void exitEpochDomain(EpochThread *thread)
+{
+	__atomic_store_n(&thread->epoch, 0, __ATOMIC_RELEASE);
+}
+
+void retireEpochDomain(EpochThread *thread, void *ptr, void (*freeFunc)(void *))
+{
+	EpochDomain *domain = thread->domain;
+
+	_pushRetiredEpoch(&thread->retired, &thread->nRetired, &thread->maxRetired,
+	                  (EpochRetired) {
+		                  ptr, freeFunc, __atomic_load_n(&domain->global, __ATOMIC_SEQ_CST)
+	                  });
+
+	if (thread->nRetired % EPOCH_RETIRE_BATCH == 0)
+		collectEpochThread(thread);
+}
+
+size_t collectEpochThread(EpochThread *thread)
+{
+	EpochDomain *domain = thread->domain;
+
+	_tryAdvanceEpoch(domain);
+	thread->nRetired = _releaseRetiredEpoch(domain, thread->retired, thread->nRetired, 0);
+
+	// Somebody must release the orphans, don't wait for the lock for that.
+	if (__atomic_load_n(&domain->nOrphans, __ATOMIC_RELAXED) > 0
+	    && pthread_mutex_trylock(&domain->lock) == 0) {
+		domain->nOrphans = _releaseRetiredEpoch(domain, domain->orphans, domain->nOrphans, 0);
+		pthread_mutex_unlock(&domain->lock);
+	}
+
+	return thread->nRetired;
+}
+
+// Hazard pointers =============================================================
+
+void protectEpochThread(EpochThread *thread, size_t index, void *ptr)
+{
+	assert(index < EPOCH_HAZARD_POINTERS);
+	assert(thread->epoch != 0);
+	__atomic_store_n(&thread->hazards[index], ptr, __ATOMIC_SEQ_CST);
+}
+
+void releaseEpochThread(EpochThread *thread, size_t index)
+{
+	assert(index < EPOCH_HAZARD_POINTERS);
+	__atomic_store_n(&thread->hazards[index], NULL, __ATOMIC_RELEASE);
+}
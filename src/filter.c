@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Bloom blocks are one cache line of 64 bit words, every key sets one bit per
+// word (8 bits) and the filter is sized with 16 bits of memory per key.
+#define FILTER_BLOOM_WORDS 8
+#define FILTER_BLOOM_BITS_PER_KEY 16
+
+// Cuckoo buckets hold 4 fingerprints and are filled up to 95%.
+#define FILTER_CUCKOO_SLOTS 4
+#define FILTER_CUCKOO_LOAD 0.95
+#define FILTER_CUCKOO_KICKS 500
+
+static const uint32_t _bloomSalts[FILTER_BLOOM_WORDS] = {
+	0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+	0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+static inline uint64_t _hashFilter(uint64_t key)
+{
+	// MurmurHash3 finalizer
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+// Bloom =======================================================================
+
+static inline uint64_t *_getBlockBloomFilter(const Filter *in, uint64_t hash)
+{
+	const size_t block = ((hash >> 32) * (uint64_t) in->nBlocks) >> 32;
+	return &((uint64_t *) in->blocks)[block * FILTER_BLOOM_WORDS];
+}
+
+static inline uint64_t _getBitBloomFilter(uint64_t hash, int word)
+{
+	return (uint64_t) 1 << (((uint32_t) hash * _bloomSalts[word]) >> 26);
+}
+
+static void _insertBloomFilter(Filter *out, uint64_t hash)
+{
+	uint64_t *block = _getBlockBloomFilter(out, hash);
+
+	for (int i = 0; i < FILTER_BLOOM_WORDS; ++i)
+		block[i] |= _getBitBloomFilter(hash, i);
+}
+
+static int _containsBloomFilter(const Filter *in, uint64_t hash)
+{
+	const uint64_t *block = _getBlockBloomFilter(in, hash);
+
+	// No early exit, so the 8 words are tested at once.
+	uint64_t missing = 0;
+	for (int i = 0; i < FILTER_BLOOM_WORDS; ++i)
+		missing |= ~block[i] & _getBitBloomFilter(hash, i);
+
+	return missing == 0;
+}
+
+// Cuckoo ======================================================================
+
+static inline uint16_t _getFingerprintCuckooFilter(uint64_t hash)
+{
+	// 0 means empty slot
+	const uint16_t fingerprint = hash >> 48;
+	return fingerprint != 0 ? fingerprint : 1;
+}
+
+static inline size_t _getAltBucketCuckooFilter(
+	const Filter *in, size_t bucket, uint16_t fingerprint
+) {
+	return (bucket ^ _hashFilter(fingerprint)) & (in->nBlocks - 1);
+}
+
+static inline uint16_t *_getBucketCuckooFilter(const Filter *in, size_t bucket)
+{
+	return &((uint16_t *) in->blocks)[bucket * FILTER_CUCKOO_SLOTS];
+}
+
+static int _placeCuckooFilter(Filter *out, size_t bucket, uint16_t fingerprint)
+{
+	uint16_t *slots = _getBucketCuckooFilter(out, bucket);
+
+	for (int i = 0; i < FILTER_CUCKOO_SLOTS; ++i) {
+		if (slots[i] == 0) {
+			slots[i] = fingerprint;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int _findCuckooFilter(const Filter *in, size_t bucket, uint16_t fingerprint)
+{
+	const uint16_t *slots = _getBucketCuckooFilter(in, bucket);
+
+	for (int i = 0; i < FILTER_CUCKOO_SLOTS; ++i)
+		if (slots[i] == fingerprint)
+			return i;
+	return -1;
+}
+
+static int _insertCuckooFilter(Filter *out, uint64_t hash)
+{
+	uint16_t fingerprint = _getFingerprintCuckooFilter(hash);
+	size_t bucket = hash & (out->nBlocks - 1);
+
+	if (_placeCuckooFilter(out, bucket, fingerprint))
+		return 1;
+
+	bucket = _getAltBucketCuckooFilter(out, bucket, fingerprint);
+	if (_placeCuckooFilter(out, bucket, fingerprint))
+		return 1;
+
+	// With a victim the filter is full already.
+	if (out->victim != 0) {
+		out->saturated = 1;
+		return 0;
+	}
+
+	for (int kick = 0; kick < FILTER_CUCKOO_KICKS; ++kick) {
+		uint16_t *slots = _getBucketCuckooFilter(out, bucket);
+		const int slot = (fingerprint + kick) % FILTER_CUCKOO_SLOTS;
+
+		const uint16_t tmp = slots[slot];
+		slots[slot] = fingerprint;
+		fingerprint = tmp;
+
+		bucket = _getAltBucketCuckooFilter(out, bucket, fingerprint);
+		if (_placeCuckooFilter(out, bucket, fingerprint))
+			return 1;
+	}
+
+	// Keep the last displaced fingerprint aside, so nothing is lost.
+	out->victim = fingerprint;
+	out->victimBucket = bucket;
+	return 0;
+}
+
+static int _containsCuckooFilter(const Filter *in, uint64_t hash)
+{
+	const uint16_t fingerprint = _getFingerprintCuckooFilter(hash);
+	const size_t bucket = hash & (in->nBlocks - 1);
+	const size_t alt = _getAltBucketCuckooFilter(in, bucket, fingerprint);
+
+	if (in->victim == fingerprint
+	    && (in->victimBucket == bucket || in->victimBucket == alt))
+		return 1;
+
+	return _findCuckooFilter(in, bucket, fingerprint) >= 0
+		|| _findCuckooFilter(in, alt, fingerprint) >= 0;
+}
+
+static void _removeCuckooFilter(Filter *out, uint64_t hash)
+{
+	const uint16_t fingerprint = _getFingerprintCuckooFilter(hash);
+	const size_t bucket = hash & (out->nBlocks - 1);
+	const size_t alt = _getAltBucketCuckooFilter(out, bucket, fingerprint);
+
+	int slot;
+	if ((slot = _findCuckooFilter(out, bucket, fingerprint)) >= 0) {
+		_getBucketCuckooFilter(out, bucket)[slot] = 0;
+	} else if ((slot = _findCuckooFilter(out, alt, fingerprint)) >= 0) {
+		_getBucketCuckooFilter(out, alt)[slot] = 0;
+	} else {
+		assert(out->victim == fingerprint);
+		out->victim = 0;
+		return;
+	}
+
+	// There is space now, try to place the victim again.
+	if (out->victim != 0) {
+		const size_t victimAlt = _getAltBucketCuckooFilter(out, out->victimBucket, out->victim);
+
+		if (_placeCuckooFilter(out, out->victimBucket, out->victim)
+		    || _placeCuckooFilter(out, victimAlt, out->victim))
+			out->victim = 0;
+	}
+}
+
+// Filter ======================================================================
+
+void allocInitFilter(Filter *out, FilterType type, size_t capacity)
+{
+	assert(type == FILTER_BLOOM || type == FILTER_CUCKOO);
+
+	out->type = type;
+	out->blocks = NULL;
+	out->nBlocks = 0;
+	out->counters = 0;
+	out->lookups = 0;
+	out->negatives = 0;
+
+	clearFilter(out, capacity);
+}
+
+void freeFilter(Filter *out)
+{
+	free(out->blocks);
+	out->blocks = NULL;
+	out->nBlocks = 0;
+	out->entries = 0;
+}
+
+void clearFilter(Filter *out, size_t capacity)
+{
+	capacity = capacity > 0 ? capacity : 1;
+
+	size_t nBlocks, blockSize;
+
+	if (out->type == FILTER_BLOOM) {
+		const size_t bits = 8 * sizeof(uint64_t) * FILTER_BLOOM_WORDS;
+		nBlocks = (capacity * FILTER_BLOOM_BITS_PER_KEY + bits - 1) / bits;
+		blockSize = FILTER_BLOOM_WORDS * sizeof(uint64_t);
+	} else {
+		const size_t needed = capacity / (FILTER_CUCKOO_SLOTS * FILTER_CUCKOO_LOAD) + 1;
+		nBlocks = 2;
+		while (nBlocks < needed)
+			nBlocks *= 2;
+		blockSize = FILTER_CUCKOO_SLOTS * sizeof(uint16_t);
+	}
+
+	if (nBlocks != out->nBlocks) {
+		free(out->blocks);
+
+		int ret = posix_memalign(&out->blocks, 64, nBlocks * blockSize);
+		assert(ret == 0);
+		(void) ret;
+
+		out->nBlocks = nBlocks;
+	}
+
+	memset(out->blocks, 0, nBlocks * blockSize);
+
+	out->capacity = capacity;
+	out->entries = 0;
+	out->stale = 0;
+	out->saturated = 0;
+	out->victim = 0;
+	out->victimBucket = 0;
+}
+
+void setCountersFilter(Filter *out, int enabled)
+{
+	out->counters = enabled;
+}
+
+int insertKeyFilter(Filter *out, int key)
+{
+	const uint64_t hash = _hashFilter((uint32_t) key);
+	out->entries++;
+
+	if (out->saturated)
+		return 0;
+
+	if (out->type == FILTER_BLOOM) {
+		_insertBloomFilter(out, hash);
+		return out->entries <= out->capacity;
+	}
+
+	return _insertCuckooFilter(out, hash);
+}
+
+int containsKeyFilter(Filter *in, int key)
+{
+	const uint64_t hash = _hashFilter((uint32_t) key);
+
+	const int found = in->saturated
+		|| ((in->type == FILTER_BLOOM)
+		    ? _containsBloomFilter(in, hash)
+		    : _containsCuckooFilter(in, hash));
+
+	if (in->counters) {
+		in->lookups++;
+		in->negatives += !found;
+	}
+
+	return found;
+}
+
+void removeKeyFilter(Filter *out, int key)
+{
+	assert(out->entries > 0);
+
+	// A saturated filter may not contain the key, don't remove a fingerprint
+	// from a different one.
+	if (out->type == FILTER_BLOOM || out->saturated) {
+		out->stale++;
+		return;
+	}
+
+	out->entries--;
+	_removeCuckooFilter(out, _hashFilter((uint32_t) key));
+}
+
+int needsRebuildFilter(const Filter *in)
+{
+	return in->saturated
+		|| in->victim != 0
+		|| in->entries > in->capacity
+		|| in->stale > in->capacity / 2;
+}
+
+size_t _rebuildCapacityFilter(const Filter *in, size_t entries)
+{
+	// Grow when the live keys are the problem, otherwise the stale ones are.
+	if (in->saturated || in->victim != 0 || 2 * entries > in->capacity)
+		return 2 * (entries > in->capacity ? entries : in->capacity);
+
+	return in->capacity;
+}
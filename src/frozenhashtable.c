@@ -0,0 +1,591 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Average number of keys per pilot bucket (16 / 6 = 2.7 bits per key).
+#define FROZEN_HASH_TABLE_BUCKET_KEYS 6
+
+// Skewed bucket distribution (PTHash): 60% of the keys go to the first 30% of
+// the buckets. The big buckets are placed first, when the table is empty.
+#define FROZEN_HASH_TABLE_DENSE_KEYS 2576980377ULL   // 0.6 * 2^32
+#define FROZEN_HASH_TABLE_DENSE_BUCKETS 30           // %
+
+// The hash range has 2% extra positions (remapped with 32 bits each, 0.6 bits
+// per key), so the last buckets find free positions fast.
+#define FROZEN_HASH_TABLE_EXTRA_SLOTS 50
+
+// Keys in flight in getKeysFrozenHashTable.
+#define FROZEN_HASH_TABLE_BATCH 32
+
+// Seeds to try before giving up (the first one usually works).
+#define FROZEN_HASH_TABLE_MAX_SEEDS 64
+
+// File format =================================================================
+//
+// Header followed by the buffer with the arrays: pilots, remap, keys and
+// values, every one aligned to 64 bytes relative to the buffer start. All the
+// numbers are in native endianness.
+
+#define FROZEN_HASH_TABLE_MAGIC "FRHT"
+#define FROZEN_HASH_TABLE_VERSION 1
+
+struct FrozenHashTableHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t entries;
+	uint64_t nBuckets;
+	uint64_t nSlots;
+	uint64_t valueSize;
+	uint64_t seed;
+	uint64_t bufferSize;
+	uint64_t reserved;
+};
+
+// Hash ========================================================================
+
+static inline uint64_t _mixFrozenHashTable(uint64_t key)
+{
+	// MurmurHash3 finalizer
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+static inline uint64_t _hashFrozenHashTable(const FrozenHashTable *in, int key)
+{
+	// Bijective, so different keys never have the same hash.
+	return _mixFrozenHashTable((uint32_t) key ^ in->seed);
+}
+
+static inline size_t _getBucketFrozenHashTable(const FrozenHashTable *in, uint64_t hash)
+{
+	const uint64_t high = hash >> 32;
+	const size_t dense = in->nBuckets * FROZEN_HASH_TABLE_DENSE_BUCKETS / 100;
+
+	// Scale the two ranges of hashes to [0, 2^32) before mapping them.
+	if (high < FROZEN_HASH_TABLE_DENSE_KEYS)
+		return ((high * 5 / 3) * dense) >> 32;
+
+	return dense
+		+ ((((high - FROZEN_HASH_TABLE_DENSE_KEYS) * 5 / 2) * (in->nBuckets - dense)) >> 32);
+}
+
+static inline size_t _getSlotFrozenHashTable(
+	const FrozenHashTable *in, uint64_t hash, uint16_t pilot
+) {
+	return (hash ^ _mixFrozenHashTable(pilot ^ in->seed)) % in->nSlots;
+}
+
+static inline size_t _getPositionFrozenHashTable(
+	const FrozenHashTable *in, uint64_t hash, uint16_t pilot
+) {
+	const size_t slot = _getSlotFrozenHashTable(in, hash, pilot);
+	return slot < in->entries ? slot : in->remap[slot - in->entries];
+}
+
+// Layout ======================================================================
+
+static inline size_t _alignFrozenHashTable(size_t size)
+{
+	return (size + 63) & ~(size_t) 63;
+}
+
+// Set the array pointers inside base (if not NULL) and return the buffer size.
+static size_t _layoutFrozenHashTable(FrozenHashTable *out, unsigned char *base)
+{
+	const size_t pilots = 0;
+	const size_t remap = pilots + _alignFrozenHashTable(out->nBuckets * sizeof(uint16_t));
+	const size_t keys = remap
+		+ _alignFrozenHashTable((out->nSlots - out->entries) * sizeof(uint32_t));
+	const size_t values = keys + _alignFrozenHashTable(out->entries * sizeof(int));
+
+	if (base != NULL) {
+		out->pilots = (const uint16_t *) (base + pilots);
+		out->remap = (const uint32_t *) (base + remap);
+		out->keys = (const int *) (base + keys);
+		out->values = base + values;
+	}
+
+	return values + out->entries * out->valueSize;
+}
+
+// Build =======================================================================
+
+struct FrozenHashTableBuild {
+	size_t n;
+	uint64_t *hashes;       // hash of every key
+	size_t *bucketStart;    // keys of bucket b: order[bucketStart[b]..bucketStart[b + 1]]
+	size_t *cursor;         // insertion point of every bucket while sorting
+	size_t *order;          // key indices sorted by bucket
+	size_t *buckets;        // buckets sorted by size (decreasing)
+	unsigned char *taken;   // used slots
+	size_t *slots;          // slots of every key
+};
+
+static void _sortBucketsFrozenHashTable(
+	FrozenHashTable *out, struct FrozenHashTableBuild *build
+) {
+	const size_t n = build->n;
+	const size_t nBuckets = out->nBuckets;
+
+	// Sort the keys by bucket (counting sort).
+	memset(build->bucketStart, 0, (nBuckets + 1) * sizeof(size_t));
+
+	size_t maxSize = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const size_t bucket = _getBucketFrozenHashTable(out, build->hashes[i]);
+		const size_t size = ++build->bucketStart[bucket + 1];
+		maxSize = size > maxSize ? size : maxSize;
+	}
+
+	for (size_t b = 0; b < nBuckets; ++b) {
+		build->bucketStart[b + 1] += build->bucketStart[b];
+		build->cursor[b] = build->bucketStart[b];
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		const size_t bucket = _getBucketFrozenHashTable(out, build->hashes[i]);
+		build->order[build->cursor[bucket]++] = i;
+	}
+
+	// Sort the buckets by decreasing size (counting sort reusing the cursors),
+	// the big buckets are easier to place when the table is empty.
+	size_t *count = build->cursor;
+	memset(count, 0, (maxSize + 1) * sizeof(size_t));
+
+	for (size_t b = 0; b < nBuckets; ++b)
+		count[build->bucketStart[b + 1] - build->bucketStart[b]]++;
+
+	size_t start = 0;
+	for (size_t size = maxSize + 1; size-- > 0; ) {
+		const size_t tmp = count[size];
+		count[size] = start;
+		start += tmp;
+	}
+
+	for (size_t b = 0; b < nBuckets; ++b)
+		build->buckets[count[build->bucketStart[b + 1] - build->bucketStart[b]]++] = b;
+}
+
+// Find a pilot for every bucket, returns 0 when some bucket has no valid pilot.
+static int _buildPilotsFrozenHashTable(
+	FrozenHashTable *out, uint16_t *pilots, struct FrozenHashTableBuild *build
+) {
+	_sortBucketsFrozenHashTable(out, build);
+
+	memset(build->taken, 0, out->nSlots);
+	memset(pilots, 0, out->nBuckets * sizeof(uint16_t));
+
+	for (size_t i = 0; i < out->nBuckets; ++i) {
+		const size_t bucket = build->buckets[i];
+		const size_t first = build->bucketStart[bucket];
+		const size_t last = build->bucketStart[bucket + 1];
+
+		// Sorted by size, so the rest are empty.
+		if (first == last)
+			break;
+
+		size_t pilot = 0;
+		for (; pilot <= UINT16_MAX; ++pilot) {
+			size_t j = first;
+
+			for (; j < last; ++j) {
+				const size_t key = build->order[j];
+				const size_t slot = _getSlotFrozenHashTable(out, build->hashes[key], pilot);
+
+				if (build->taken[slot])
+					break;
+
+				build->taken[slot] = 1;
+				build->slots[key] = slot;
+			}
+
+			if (j == last)
+				break;
+
+			// Collision, release the slots of this try.
+			while (j-- > first)
+				build->taken[build->slots[build->order[j]]] = 0;
+		}
+
+		if (pilot > UINT16_MAX)
+			return 0;
+
+		pilots[bucket] = pilot;
+	}
+
+	return 1;
+}
+
+static size_t _collectBucketsFrozenHashTable(
+	HashTableNode **nodes, size_t count, DoubleLinkedList *table, size_t N
+) {
+	for (size_t i = 0; i < N; ++i)
+		for (LinkedListNode *it = table[i].list; it != NULL; it = it->next)
+			nodes[count++] = (HashTableNode *) it;
+
+	return count;
+}
+
+static int _compareKeysFrozenHashTable(const void *a, const void *b)
+{
+	const int ka = *(const int *) a, kb = *(const int *) b;
+	return (ka > kb) - (ka < kb);
+}
+
+// The byte string keys may repeat the inline key, no pilot separates them.
+static int _hasDuplicatesFrozenHashTable(HashTableNode **nodes, size_t n)
+{
+	int *keys = malloc(n * sizeof(int));
+	assert(keys != NULL);
+
+	for (size_t i = 0; i < n; ++i)
+		keys[i] = nodes[i]->key;
+
+	qsort(keys, n, sizeof(int), _compareKeysFrozenHashTable);
+
+	size_t i = 1;
+	while (i < n && keys[i - 1] != keys[i])
+		++i;
+
+	free(keys);
+	return i < n;
+}
+
+int freezeHashTable(HashTable *in, FrozenHashTable *out, size_t valueSize)
+{
+	const size_t n = in->entries;
+
+	out->entries = n;
+	out->nBuckets = n / FROZEN_HASH_TABLE_BUCKET_KEYS + 1;
+	out->nSlots = n + n / FROZEN_HASH_TABLE_EXTRA_SLOTS + 1;
+	out->valueSize = valueSize;
+	out->mapped = 0;
+
+	// An empty table only needs the arrays of the single bucket and slot.
+	if (n == 0) {
+		out->seed = 0;
+		out->bufferSize = _layoutFrozenHashTable(out, NULL);
+
+		int ret = posix_memalign(&out->buffer, 64, out->bufferSize);
+		assert(ret == 0);
+		(void) ret;
+
+		memset(out->buffer, 0, out->bufferSize);
+		_layoutFrozenHashTable(out, out->buffer);
+		return 0;
+	}
+
+	// Collect the nodes, also the ones still in the old table while rehashing.
+	HashTableNode **nodes = malloc(n * sizeof(HashTableNode *));
+	assert(nodes != NULL);
+
+	size_t count = _collectBucketsFrozenHashTable(nodes, 0, in->table, in->N);
+	if (in->oldTable != NULL)
+		count = _collectBucketsFrozenHashTable(nodes, count, in->oldTable, in->oldN);
+	assert(count == n);
+
+	if (_hasDuplicatesFrozenHashTable(nodes, n)) {
+		free(nodes);
+		out->buffer = NULL;
+		out->bufferSize = 0;
+		out->entries = 0;
+		return -1;
+	}
+
+	out->bufferSize = _layoutFrozenHashTable(out, NULL);
+
+	int ret = posix_memalign(&out->buffer, 64, out->bufferSize);
+	assert(ret == 0);
+	(void) ret;
+
+	unsigned char *buffer = out->buffer;
+	memset(buffer, 0, out->bufferSize);
+	_layoutFrozenHashTable(out, buffer);
+
+	struct FrozenHashTableBuild build = {
+		.n = n,
+		.hashes = malloc(n * sizeof(uint64_t)),
+		.bucketStart = malloc((out->nBuckets + 1) * sizeof(size_t)),
+		// Also used to count the bucket sizes, from 0 to n.
+		.cursor = malloc((out->nBuckets > n ? out->nBuckets : n + 1) * sizeof(size_t)),
+		.order = malloc(n * sizeof(size_t)),
+		.buckets = malloc(out->nBuckets * sizeof(size_t)),
+		.taken = malloc(out->nSlots),
+		.slots = malloc(n * sizeof(size_t))
+	};
+	assert(build.hashes != NULL && build.bucketStart != NULL
+	       && build.cursor != NULL && build.order != NULL
+	       && build.buckets != NULL && build.taken != NULL
+	       && build.slots != NULL);
+
+	// Change the seed until all the buckets find a pilot (usually the first).
+	uint16_t *pilots = (uint16_t *) out->pilots;
+	uint64_t attempt = 0;
+
+	int found = 0;
+
+	while (!found && attempt < FROZEN_HASH_TABLE_MAX_SEEDS) {
+		out->seed = _mixFrozenHashTable(++attempt);
+
+		for (size_t i = 0; i < n; ++i)
+			build.hashes[i] = _hashFrozenHashTable(out, nodes[i]->key);
+
+		found = _buildPilotsFrozenHashTable(out, pilots, &build);
+	}
+
+	// The slots over the entries go to the free positions under them.
+	uint32_t *remap = (uint32_t *) out->remap;
+	size_t hole = 0;
+
+	for (size_t slot = n; slot < out->nSlots; ++slot) {
+		if (!build.taken[slot])
+			continue;
+
+		while (build.taken[hole])
+			++hole;
+		remap[slot - n] = hole++;
+	}
+
+	int *keys = (int *) out->keys;
+	unsigned char *values = (unsigned char *) out->values;
+
+	for (size_t i = 0; found && i < n; ++i) {
+		const size_t slot = build.slots[i];
+		const size_t position = slot < n ? slot : remap[slot - n];
+
+		keys[position] = nodes[i]->key;
+		if (nodes[i]->value != NULL)
+			memcpy(values + position * valueSize, nodes[i]->value, valueSize);
+	}
+
+	free(build.hashes);
+	free(build.bucketStart);
+	free(build.cursor);
+	free(build.order);
+	free(build.buckets);
+	free(build.taken);
+	free(build.slots);
+	free(nodes);
+
+	if (!found) {
+		freeFrozenHashTable(out);
+		return -1;
+	}
+
+	return 0;
+}
+
+void freeFrozenHashTable(FrozenHashTable *out)
+{
+	if (out->mapped)
+		munmap(out->buffer, out->bufferSize);
+	else
+		free(out->buffer);
+
+	out->buffer = NULL;
+	out->bufferSize = 0;
+	out->entries = 0;
+}
+
+// Lookup ======================================================================
+
+const void *getKeyFrozenHashTable(const FrozenHashTable *in, int key)
+{
+	if (in->entries == 0)
+		return NULL;
+
+	const uint64_t hash = _hashFrozenHashTable(in, key);
+	const uint16_t pilot = in->pilots[_getBucketFrozenHashTable(in, hash)];
+	const size_t position = _getPositionFrozenHashTable(in, hash, pilot);
+
+	return in->keys[position] == key ? in->values + position * in->valueSize : NULL;
+}
+
+size_t getKeysFrozenHashTable(
+	const FrozenHashTable *in, const int *keys, size_t n, const void **values
+) {
+	if (in->entries == 0) {
+		for (size_t i = 0; i < n; ++i)
+			values[i] = NULL;
+		return 0;
+	}
+
+	uint64_t hashes[FROZEN_HASH_TABLE_BATCH];
+	size_t positions[FROZEN_HASH_TABLE_BATCH];
+	size_t found = 0;
+
+	for (size_t first = 0; first < n; first += FROZEN_HASH_TABLE_BATCH) {
+		const size_t batch = (n - first < FROZEN_HASH_TABLE_BATCH)
+			? n - first
+			: FROZEN_HASH_TABLE_BATCH;
+
+		// The memory accesses of every stage overlap.
+		for (size_t i = 0; i < batch; ++i) {
+			hashes[i] = _hashFrozenHashTable(in, keys[first + i]);
+			__builtin_prefetch(&in->pilots[_getBucketFrozenHashTable(in, hashes[i])]);
+		}
+
+		for (size_t i = 0; i < batch; ++i) {
+			const uint16_t pilot = in->pilots[_getBucketFrozenHashTable(in, hashes[i])];
+			positions[i] = _getPositionFrozenHashTable(in, hashes[i], pilot);
+			__builtin_prefetch(&in->keys[positions[i]]);
+			__builtin_prefetch(in->values + positions[i] * in->valueSize);
+		}
+
+		for (size_t i = 0; i < batch; ++i) {
+			const int hit = (in->keys[positions[i]] == keys[first + i]);
+			values[first + i] = hit ? in->values + positions[i] * in->valueSize : NULL;
+			found += hit;
+		}
+	}
+
+	return found;
+}
+
+// File ========================================================================
+
+int dumpFrozenHashTable(const FrozenHashTable *in, const char *filename)
+{
+	// Write a temporary file and rename it, so the processes with the old
+	// file mapped keep their version (even if it is the one in "in").
+	const size_t length = strlen(filename);
+	char *tmpname = malloc(length + 8);
+	assert(tmpname != NULL);
+	memcpy(tmpname, filename, length);
+	memcpy(tmpname + length, ".XXXXXX", 8);
+
+	const int fd = mkstemp(tmpname);
+	FILE *file = (fd >= 0) ? fdopen(fd, "wb") : NULL;
+
+	if (file == NULL) {
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmpname);
+		}
+		free(tmpname);
+		return -1;
+	}
+
+	struct FrozenHashTableHeader header = {
+		.magic = FROZEN_HASH_TABLE_MAGIC,
+		.version = FROZEN_HASH_TABLE_VERSION,
+		.entries = in->entries,
+		.nBuckets = in->nBuckets,
+		.nSlots = in->nSlots,
+		.valueSize = in->valueSize,
+		.seed = in->seed,
+		.bufferSize = in->mapped ? in->bufferSize - sizeof(header) : in->bufferSize,
+		.reserved = 0
+	};
+
+	// The pilots are the first array in the buffer.
+	int ret = (fwrite(&header, sizeof(header), 1, file) == 1
+	           && fwrite(in->pilots, 1, header.bufferSize, file) == header.bufferSize)
+		? 0 : -1;
+
+	if (fclose(file) != 0)
+		ret = -1;
+
+	if (ret == 0 && rename(tmpname, filename) != 0)
+		ret = -1;
+
+	if (ret != 0)
+		unlink(tmpname);
+
+	free(tmpname);
+	return ret;
+}
+
+int openFrozenHashTable(FrozenHashTable *out, const char *filename)
+{
+	const int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(struct FrozenHashTableHeader)) {
+		close(fd);
+		return -1;
+	}
+
+	// Shared, so all the processes using the file share the page cache.
+	const size_t fileSize = st.st_size;
+	unsigned char *map = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return -1;
+
+	struct FrozenHashTableHeader header;
+	memcpy(&header, map, sizeof(header));
+
+	FrozenHashTable table = {
+		.entries = header.entries,
+		.nBuckets = header.nBuckets,
+		.nSlots = header.nSlots,
+		.valueSize = header.valueSize,
+		.seed = header.seed,
+		.buffer = map,
+		.bufferSize = fileSize,
+		.mapped = 1
+	};
+
+	// Every array must fit in the file before computing the layout, so the
+	// sizes can't overflow.
+	if (memcmp(header.magic, FROZEN_HASH_TABLE_MAGIC, sizeof(header.magic)) != 0
+	    || header.version != FROZEN_HASH_TABLE_VERSION
+	    || header.nSlots < header.entries
+	    || header.nSlots == 0
+	    || header.nBuckets == 0
+	    || header.nBuckets > fileSize / sizeof(uint16_t)
+	    || header.nSlots - header.entries > fileSize / sizeof(uint32_t)
+	    || header.entries > fileSize / sizeof(int)
+	    || (header.valueSize != 0 && header.entries > fileSize / header.valueSize)
+	    || header.bufferSize != fileSize - sizeof(header)
+	    || _layoutFrozenHashTable(&table, map + sizeof(header)) != header.bufferSize) {
+		munmap(map, fileSize);
+		return -1;
+	}
+
+	// The remapped slots must point to the key positions.
+	for (size_t i = 0; i < table.nSlots - table.entries; ++i) {
+		if (table.entries > 0 && table.remap[i] >= table.entries) {
+			munmap(map, fileSize);
+			return -1;
+		}
+	}
+
+	*out = table;
+	return 0;
+}
@@ -24,62 +24,230 @@
 
 // List Node ===================================================================
 
+// Number of old buckets migrated by every operation while rehashing.
+#define HASH_TABLE_REHASH_STEPS 2
+
 size_t _hashFunction(HashTable *in, size_t key)
 {
 	return key % in->N;
 }
 
+static DoubleLinkedList *_allocInitBucketsHashTable(size_t N)
+{
+	DoubleLinkedList *table = malloc(N *sizeof(DoubleLinkedList));
+	assert(table != NULL);
+
+	for (size_t i = 0; i < N; ++i) {
+		allocInitDoubleLinkedList(&table[i]);
+	}
+
+	return table;
+}
+
+// The buckets don't keep ops, the values are owned by the table.
+static void _freeBucketsHashTable(
+	DoubleLinkedList *table, size_t N, const ValueOps *ops
+) {
+	for (size_t i = 0; i < N; ++i) {
+		LinkedListNode *it = table[i].list;
+		while (it != NULL) {
+			LinkedListNode *next = it->next;
+			_freeLinkedListNode(it, ops);
+			it = next;
+		}
+	}
+
+	free(table);
+}
+
 void allocInitHashTable(HashTable *out, size_t N)
 {
 	out->entries = 0;
 	out->N = N;
 
-	out->table = malloc(N *sizeof(DoubleLinkedList));
+	out->table = _allocInitBucketsHashTable(N);
 
-	for (size_t i = 0; i < N; ++i) {
-		allocInitDoubleLinkedList(&out->table[i]);
-	}
+	out->oldTable = NULL;
+	out->oldN = 0;
+	out->rehashIndex = 0;
+
+	out->filter = NULL;
+	out->ops = &ownedValueOps;
+	out->bytesKeys = 0;
 }
 
 void freeHashTable(HashTable *out)
 {
-	for (size_t i = 0; i < out->N; ++i) {
-		freeDoubleLinkedList(&out->table[i]);
-	}
+	_freeBucketsHashTable(out->table, out->N, out->ops);
+
+	if (out->oldTable != NULL)
+		_freeBucketsHashTable(out->oldTable, out->oldN, out->ops);
 
-	free(out->table);
+	out->oldTable = NULL;
+	out->oldN = 0;
 	out->N = 0;
 	out->entries = 0;
+
+	_setFilterHashTable(out, FILTER_NONE, 0);
+}
+
+static void _fillFilterBucketsHashTable(
+	Filter *filter, DoubleLinkedList *table, size_t N
+) {
+	for (size_t i = 0; i < N; ++i)
+		for (LinkedListNode *it = table[i].list; it != NULL; it = it->next)
+			insertKeyFilter(filter, it->key);
+}
+
+static void _fillFilterHashTable(HashTable *out, size_t capacity)
+{
+	clearFilter(out->filter, capacity);
+
+	_fillFilterBucketsHashTable(out->filter, out->table, out->N);
+	if (out->oldTable != NULL)
+		_fillFilterBucketsHashTable(out->filter, out->oldTable, out->oldN);
+}
+
+// Rebuild the filter when the insertions and removals degraded it.
+static void _syncFilterHashTable(HashTable *out)
+{
+	if (out->filter != NULL && needsRebuildFilter(out->filter))
+		_fillFilterHashTable(out, _rebuildCapacityFilter(out->filter, out->entries));
+}
+
+void _setFilterHashTable(HashTable *out, FilterType type, size_t capacity)
+{
+	if (out->filter != NULL) {
+		freeFilter(out->filter);
+		free(out->filter);
+		out->filter = NULL;
+	}
+
+	if (type == FILTER_NONE)
+		return;
+
+	out->filter = malloc(sizeof(Filter));
+	assert(out->filter != NULL);
+
+	capacity = capacity > out->entries ? capacity : out->entries;
+	allocInitFilter(out->filter, type, capacity);
+	_fillFilterHashTable(out, capacity);
+}
+
+void setFilterHashTable(HashTable *out, FilterType type)
+{
+	_setFilterHashTable(out, type, out->N);
+}
+
+void setValueOpsHashTable(HashTable *out, const ValueOps *ops)
+{
+	assert(out->entries == 0);
+	out->ops = ops != NULL ? ops : &ownedValueOps;
+}
+
+DoubleLinkedList *_getBucketHashTable(HashTable *in, int key)
+{
+	// While rehashing the keys are in the old table until their old bucket
+	// is migrated.
+	if (in->oldTable != NULL) {
+		const size_t oldHash = (size_t) key % in->oldN;
+		if (oldHash >= in->rehashIndex)
+			return &in->oldTable[oldHash];
+	}
+
+	const size_t hash = _hashFunction(in, key);
+	assert(hash < in->N);
+
+	return &in->table[hash];
+}
+
+void _rehashStepHashTable(HashTable *out, size_t steps)
+{
+	for (size_t i = 0; i < steps && out->oldTable != NULL; ++i) {
+		DoubleLinkedList *bucket = &out->oldTable[out->rehashIndex++];
+
+		while (bucket->list != NULL) {
+			HashTableNode *node = (HashTableNode *) bucket->list;
+			_extractNodeDoubleLinkedList(bucket, node);
+
+			node->next = NULL;
+			node->last = NULL;
+			insertNodeDoubleLinkedList(&out->table[_hashFunction(out, node->key)], node);
+		}
+
+		if (out->rehashIndex == out->oldN) {
+			_freeBucketsHashTable(out->oldTable, out->oldN, out->ops);
+			out->oldTable = NULL;
+			out->oldN = 0;
+			out->rehashIndex = 0;
+		}
+	}
+}
+
+void rehashHashTable(HashTable *out, size_t N)
+{
+	assert(N > 0);
+
+	// Finish the previous rehash first.
+	if (out->oldTable != NULL)
+		_rehashStepHashTable(out, out->oldN);
+
+	if (N == out->N)
+		return;
+
+	out->oldTable = out->table;
+	out->oldN = out->N;
+	out->rehashIndex = 0;
+
+	out->N = N;
+	out->table = _allocInitBucketsHashTable(N);
 }
 
 HashTableNode *_insertNodeHashTable(HashTable *out, HashTableNode *node)
+{
+	assert(getKeyDoubleLinkedList(_getBucketHashTable(out, node->key), node->key) == NULL);
+	return _linkNodeHashTable(out, node);
+}
+
+// Like _insertNodeHashTable, but the key may be repeated (byte string keys
+// with the same inline key).
+HashTableNode *_linkNodeHashTable(HashTable *out, HashTableNode *node)
 {
 	assert(out->N > 0);
-	const size_t hash = _hashFunction(out, node->key);
-	assert(hash < out->N);
+	if (out->oldTable != NULL)
+		_rehashStepHashTable(out, HASH_TABLE_REHASH_STEPS);
 
-	LinkedList *hashEntry = &out->table[hash];
-	assert(getKeyDoubleLinkedList(hashEntry, node->key) == NULL);
+	LinkedList *hashEntry = _getBucketHashTable(out, node->key);
 
 	out->entries++;
 	node = insertNodeDoubleLinkedList(hashEntry, node);
 
+	if (out->filter != NULL && !insertKeyFilter(out->filter, node->key))
+		_syncFilterHashTable(out);
+
 	return node;
 }
 
 HashTableNode *insertKeyHashTable(HashTable *out, int key, void *value)
 {
-	const size_t hash = _hashFunction(out, key);
-	assert(hash < out->N);
+	if (out->oldTable != NULL)
+		_rehashStepHashTable(out, HASH_TABLE_REHASH_STEPS);
 
-	LinkedList *hashEntry = &out->table[hash];
+	LinkedList *hashEntry = _getBucketHashTable(out, key);
 	HashTableNode *node = getKeyDoubleLinkedList(hashEntry, key);
 
+	value = _cloneValue(out->ops, value);
+
 	if (node == NULL) {
 		out->entries++;
-		node = insertKeyDoubleLinkedList(hashEntry, key, value);
+		node = insertNodeDoubleLinkedList(
+			hashEntry, _allocInitDoubleLinkedListNode(NULL, key, value)
+		);
+
+		if (out->filter != NULL && !insertKeyFilter(out->filter, key))
+			_syncFilterHashTable(out);
 	} else {
-		free(node->value);
+		_destroyValue(out->ops, node->value);
 		node->value = value;
 	}
 
@@ -88,10 +256,13 @@ HashTableNode *insertKeyHashTable(HashTable *out, int key, void *value)
 
 HashTableNode *getKeyHashTable(HashTable *out, int key)
 {
-	const size_t hash = _hashFunction(out, key);
-	assert(hash < out->N);
+	if (out->oldTable != NULL)
+		_rehashStepHashTable(out, HASH_TABLE_REHASH_STEPS);
 
-	return getKeyDoubleLinkedList(&out->table[hash], key);
+	if (out->filter != NULL && !containsKeyFilter(out->filter, key))
+		return NULL;
+
+	return getKeyDoubleLinkedList(_getBucketHashTable(out, key), key);
 }
 
 HashTableNode *_extractNodeHashTable(HashTable *out, HashTableNode *node)
@@ -99,23 +270,111 @@ HashTableNode *_extractNodeHashTable(HashTable *out, HashTableNode *node)
 	assert(node != NULL);
 	assert(out->entries > 0);
 
-	const size_t hash = _hashFunction(out, node->key);
-	assert(hash < out->N);
-
-	HashTableNode *tmp = _extractNodeDoubleLinkedList(&out->table[hash], node);
+	HashTableNode *tmp = _extractNodeDoubleLinkedList(
+		_getBucketHashTable(out, node->key), node);
 	assert(tmp != NULL);
 	assert(tmp == node);
 
 	out->entries--;
+
+	if (out->filter != NULL) {
+		removeKeyFilter(out->filter, node->key);
+		_syncFilterHashTable(out);
+	}
+
 	return tmp;
 }
 
 int popKeyHashTable(HashTable *out, int key)
 {
-	const size_t hash = _hashFunction(out, key);
-	assert(hash < out->N);
+	if (out->oldTable != NULL)
+		_rehashStepHashTable(out, HASH_TABLE_REHASH_STEPS);
+
+	if (out->filter != NULL && !containsKeyFilter(out->filter, key))
+		return 0;
+
+	HashTableNode *node = getKeyDoubleLinkedList(_getBucketHashTable(out, key), key);
+
+	if (node == NULL)
+		return 0;
+
+	_freeLinkedListNode((LinkedListNode *) _extractNodeHashTable(out, node), out->ops);
+	return 1;
+}
+
+// Byte string keys ============================================================
+
+HashTableNode *_getBytesKeyNodeHashTable(
+	HashTable *in, uint64_t hash, const void *key, size_t length, size_t nodeSize
+) {
+	if (in->oldTable != NULL)
+		_rehashStepHashTable(in, HASH_TABLE_REHASH_STEPS);
+
+	const int inlineKey = (int) hash;
+
+	if (in->filter != NULL && !containsKeyFilter(in->filter, inlineKey))
+		return NULL;
+
+	LinkedListNode *it = _getBucketHashTable(in, inlineKey)->list;
+
+	for (; it != NULL; it = it->next) {
+		if (it->key != inlineKey)
+			continue;
+
+		const BytesKey *bytesKey = (const BytesKey *) ((const char *) it + nodeSize);
+		if (_equalBytesKey(bytesKey, hash, key, length))
+			return (HashTableNode *) it;
+	}
+
+	return NULL;
+}
+
+HashTableNode *insertBytesKeyHashTable(
+	HashTable *out, const void *key, size_t length, void *value
+) {
+	const uint64_t hash = hashBytesKey(key, length);
+
+	HashTableNode *node = _getBytesKeyNodeHashTable(
+		out, hash, key, length, sizeof(HashTableNode)
+	);
+
+	value = _cloneValue(out->ops, value);
+
+	if (node != NULL) {
+		_destroyValue(out->ops, node->value);
+		node->value = value;
+		return node;
+	}
+
+	node = malloc(BYTES_KEY_NODE_SIZE(HashTableNode, length));
+	assert(node != NULL);
+
+	_allocInitDoubleLinkedListNode(node, (int) hash, value);
+	_initBytesKey(BYTES_KEY_NODE(HashTableNode, node), hash, key, length);
+	out->bytesKeys = 1;
+
+	return _linkNodeHashTable(out, node);
+}
+
+HashTableNode *getBytesKeyHashTable(HashTable *in, const void *key, size_t length)
+{
+	return _getBytesKeyNodeHashTable(
+		in, hashBytesKey(key, length), key, length, sizeof(HashTableNode)
+	);
+}
 
-	int removed = popKeyDoubleLinkedList(&out->table[hash], key);
-	out->entries -= removed;
-	return removed;
+int popBytesKeyHashTable(HashTable *out, const void *key, size_t length)
+{
+	HashTableNode *node = getBytesKeyHashTable(out, key, length);
+
+	if (node == NULL)
+		return 0;
+
+	_freeLinkedListNode((LinkedListNode *) _extractNodeHashTable(out, node), out->ops);
+	return 1;
+}
+
+const BytesKey *getBytesKeyHashTableNode(const HashTableNode *node)
+{
+	return BYTES_KEY_NODE(HashTableNode, node);
 }
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Buckets =====================================================================
+
+static inline InlineHashTableBucket *_getBucketInlineHashTable(
+	InlineHashTable *in, int key
+) {
+	return &in->table[(size_t) key % in->N];
+}
+
+static inline int _findSlotInlineHashTable(const InlineHashTableBucket *bucket, int key)
+{
+	for (int i = 0; i < INLINE_HASH_TABLE_SLOTS; ++i)
+		if ((bucket->used & (1 << i)) && bucket->keys[i] == key)
+			return i;
+	return -1;
+}
+
+// Returns the link pointing to the overflow node with key (or to NULL).
+static HashTableNode **_findOverflowInlineHashTable(
+	InlineHashTableBucket *bucket, int key
+) {
+	HashTableNode **link = &bucket->overflow;
+
+	while (*link != NULL && (*link)->key != key)
+		link = (HashTableNode **) &(*link)->next;
+
+	return link;
+}
+
+// Inline Hash Table ===========================================================
+
+void allocInitInlineHashTable(InlineHashTable *out, size_t N)
+{
+	assert(N > 0);
+
+	void *table = NULL;
+	int ret = posix_memalign(&table, 64, N * sizeof(InlineHashTableBucket));
+	assert(ret == 0);
+	(void) ret;
+
+	memset(table, 0, N * sizeof(InlineHashTableBucket));
+
+	out->entries = 0;
+	out->N = N;
+	out->table = table;
+}
+
+void freeInlineHashTable(InlineHashTable *out)
+{
+	for (size_t b = 0; b < out->N; ++b) {
+		InlineHashTableBucket *bucket = &out->table[b];
+
+		for (int i = 0; i < INLINE_HASH_TABLE_SLOTS; ++i)
+			if (bucket->used & (1 << i))
+				_freeLinkedListNode(
+					(LinkedListNode *) bucket->nodes[i], &ownedValueOps
+				);
+
+		while (bucket->overflow != NULL) {
+			HashTableNode *next = (HashTableNode *) bucket->overflow->next;
+			_freeLinkedListNode((LinkedListNode *) bucket->overflow, &ownedValueOps);
+			bucket->overflow = next;
+		}
+	}
+
+	free(out->table);
+	out->table = NULL;
+	out->N = 0;
+	out->entries = 0;
+}
+
+HashTableNode *getKeyInlineHashTable(InlineHashTable *in, int key)
+{
+	InlineHashTableBucket *bucket = _getBucketInlineHashTable(in, key);
+
+	const int slot = _findSlotInlineHashTable(bucket, key);
+	if (slot >= 0)
+		return bucket->nodes[slot];
+
+	// The overflow chain is only walked when the header is full.
+	return bucket->overflow != NULL
+		? *_findOverflowInlineHashTable(bucket, key)
+		: NULL;
+}
+
+HashTableNode *insertKeyInlineHashTable(InlineHashTable *out, int key, void *value)
+{
+	HashTableNode *node = getKeyInlineHashTable(out, key);
+
+	if (node != NULL) {
+		// Node exist, so update value only
+		free(node->value);
+		node->value = value;
+		return node;
+	}
+
+	node = _allocInitDoubleLinkedListNode(NULL, key, value);
+	InlineHashTableBucket *bucket = _getBucketInlineHashTable(out, key);
+
+	if (bucket->used != (1 << INLINE_HASH_TABLE_SLOTS) - 1) {
+		const int slot = __builtin_ctz(~bucket->used);
+		bucket->keys[slot] = key;
+		bucket->nodes[slot] = node;
+		bucket->used |= 1 << slot;
+	} else {
+		node->next = (LinkedListNode *) bucket->overflow;
+		bucket->overflow = node;
+	}
+
+	out->entries++;
+	return node;
+}
+
+int popKeyInlineHashTable(InlineHashTable *out, int key)
+{
+	InlineHashTableBucket *bucket = _getBucketInlineHashTable(out, key);
+	HashTableNode *node = NULL;
+
+	const int slot = _findSlotInlineHashTable(bucket, key);
+
+	if (slot >= 0) {
+		node = bucket->nodes[slot];
+
+		// Keep the header full promoting the first overflow node.
+		if (bucket->overflow != NULL) {
+			HashTableNode *promoted = bucket->overflow;
+			bucket->overflow = (HashTableNode *) promoted->next;
+			promoted->next = NULL;
+
+			bucket->keys[slot] = promoted->key;
+			bucket->nodes[slot] = promoted;
+		} else {
+			bucket->used &= ~(1 << slot);
+		}
+	} else {
+		HashTableNode **link = _findOverflowInlineHashTable(bucket, key);
+		node = *link;
+
+		if (node == NULL)
+			return 0;
+
+		*link = (HashTableNode *) node->next;
+	}
+
+	_freeLinkedListNode((LinkedListNode *) node, &ownedValueOps);
+	out->entries--;
+
+	return 1;
+}
@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "c-container.h"
+#include "c-container-internal.h"
 
 // List Node ===================================================================
 
@@ -40,10 +41,10 @@ LinkedListNode *_allocInitLinkedListNode(
 	return node;
 }
 
-void _freeLinkedListNode(LinkedListNode *node)
+void _freeLinkedListNode(LinkedListNode *node, const ValueOps *ops)
 {
-	// the value needs to be released as the node has its ownership
-	free(node->value);
+	// the value is released according to the container ownership
+	_destroyValue(ops, node->value);
 	free(node);
 }
 
@@ -57,11 +58,18 @@ void allocInitLinkedList(LinkedList *out)
 
 void freeLinkedList(LinkedList *out)
 {
+	freeWithOpsLinkedList(out, &ownedValueOps);
+}
+
+void freeWithOpsLinkedList(LinkedList *out, const ValueOps *ops)
+{
+	ops = ops != NULL ? ops : &ownedValueOps;
+
 	LinkedListNode *it = out->list;
 	while (it != NULL) {
 		LinkedListNode *tmp = it;
 		it = it->next;
-		_freeLinkedListNode(tmp);
+		_freeLinkedListNode(tmp, ops);
 	}
 
 	out->entries = 0;
@@ -134,7 +142,7 @@ int _popNodeLinkedList(LinkedList *out, LinkedListNode **ref)
 	LinkedListNode *next = (*ref)->next;
 
 	out->entries--;
-	free(*ref);
+	free(*ref);  // The value remains owned by the caller.
 	*ref = next;
 	return 1;
 }
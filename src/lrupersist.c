@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Snapshot format =============================================================
+//
+// Header followed by the records from the coldest to the hottest node, the
+// secondary policy segments first and then the main one. All the numbers are
+// in native endianness and the records are not padded:
+//
+//   key (int32) | segment (uint8) | deadline (uint64) | size (uint32)
+//   | [length (uint32) | key bytes] | value
+//
+// The key bytes are only present with LRU_TABLE_SNAPSHOT_BYTES_KEYS.
+
+#define LRU_TABLE_SNAPSHOT_MAGIC "LRUT"
+#define LRU_TABLE_SNAPSHOT_VERSION 1
+
+// Header flags
+#define LRU_TABLE_SNAPSHOT_BYTES_KEYS 1
+
+struct lruTableSnapshotHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t policy;
+	uint32_t flags;
+	uint64_t entries;
+};
+
+#define LRU_TABLE_RECORD_SIZE \
+	(sizeof(int32_t) + sizeof(uint8_t) + sizeof(uint64_t) + sizeof(uint32_t))
+
+// Dump ========================================================================
+
+struct lruTableDumpState {
+	FILE *file;
+	int bytesKeys;
+	void *buffer;
+	size_t bufferSize;
+	size_t (*serialize)(const void *value, void *buffer, size_t size, void *arg);
+	void *arg;
+};
+
+static int _dumpListlruTable(struct lruTableDumpState *state, lruTableNode *node)
+{
+	for (; node != NULL; node = node->right) {
+		size_t size = state->serialize(
+			node->value, state->buffer, state->bufferSize, state->arg
+		);
+
+		if (size > state->bufferSize) {
+			// Grow the buffer (like snprintf) and serialize again.
+			free(state->buffer);
+			state->bufferSize = 2 * size;
+			state->buffer = malloc(state->bufferSize);
+			assert(state->buffer != NULL);
+
+			size = state->serialize(
+				node->value, state->buffer, state->bufferSize, state->arg
+			);
+			assert(size <= state->bufferSize);
+		}
+
+		if (size > UINT32_MAX)
+			return -1;
+
+		const int32_t key = node->key;
+		const uint8_t segment = node->segment;
+		const uint64_t deadline = _getDeadlinelruTableNode(node);
+		const uint32_t size32 = size;
+
+		if (fwrite(&key, sizeof(key), 1, state->file) != 1
+		    || fwrite(&segment, sizeof(segment), 1, state->file) != 1
+		    || fwrite(&deadline, sizeof(deadline), 1, state->file) != 1
+		    || fwrite(&size32, sizeof(size32), 1, state->file) != 1)
+			return -1;
+
+		if (state->bytesKeys) {
+			const BytesKey *bytesKey = BYTES_KEY_NODE(lruTableNode, node);
+			const uint32_t length = bytesKey->length;
+
+			if (bytesKey->length > UINT32_MAX
+			    || fwrite(&length, sizeof(length), 1, state->file) != 1
+			    || fwrite(bytesKey->bytes, 1, length, state->file) != length)
+				return -1;
+		}
+
+		if (fwrite(state->buffer, 1, size, state->file) != size)
+			return -1;
+	}
+
+	return 0;
+}
+
+int dumplruTable(
+	lruTable *in, const char *filename,
+	size_t (*serialize)(const void *value, void *buffer, size_t size, void *arg),
+	void *arg
+) {
+	assert(serialize != NULL);
+
+	// The pending accesses are part of the recency order.
+	drainReadBufferlruTable(in);
+
+	FILE *file = fopen(filename, "wb");
+	if (file == NULL)
+		return -1;
+
+	struct lruTableSnapshotHeader header = {
+		.magic = LRU_TABLE_SNAPSHOT_MAGIC,
+		.version = LRU_TABLE_SNAPSHOT_VERSION,
+		.policy = in->policy,
+		.flags = in->bytesKeys ? LRU_TABLE_SNAPSHOT_BYTES_KEYS : 0,
+		.entries = in->entries
+	};
+
+	struct lruTableDumpState state = {
+		.file = file,
+		.bytesKeys = in->bytesKeys,
+		.bufferSize = 4096,
+		.buffer = malloc(4096),
+		.serialize = serialize,
+		.arg = arg
+	};
+	assert(state.buffer != NULL);
+
+	int ret = (fwrite(&header, sizeof(header), 1, file) == 1) ? 0 : -1;
+
+	if (ret == 0 && in->policyData != NULL) {
+		struct lruTablePolicyData *data = in->policyData;
+		ret = _dumpListlruTable(&state, data->window.accesList);
+		if (ret == 0)
+			ret = _dumpListlruTable(&state, data->probation.accesList);
+	}
+
+	if (ret == 0)
+		ret = _dumpListlruTable(&state, in->accesList);
+
+	free(state.buffer);
+
+	if (fclose(file) != 0)
+		ret = -1;
+
+	return ret;
+}
+
+// Load ========================================================================
+
+// Whether the policy keeps live nodes in the segment.
+static int _validSegmentlruTable(lruTablePolicy policy, int segment)
+{
+	switch (segment) {
+	case LRU_TABLE_SEGMENT_MAIN:
+		return 1;
+	case LRU_TABLE_SEGMENT_WINDOW:
+		return policy == LRU_TABLE_POLICY_2Q
+		    || policy == LRU_TABLE_POLICY_ARC
+		    || policy == LRU_TABLE_POLICY_TINYLFU;
+	case LRU_TABLE_SEGMENT_PROBATION:
+		return policy == LRU_TABLE_POLICY_TINYLFU;
+	default:
+		return 0;
+	}
+}
+
+int loadlruTable(
+	lruTable *out, const char *filename,
+	void *(*deserialize)(const void *buffer, size_t size, void *arg),
+	void *arg
+) {
+	assert(deserialize != NULL);
+	assert(out->entries == 0);
+
+	const int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(struct lruTableSnapshotHeader)) {
+		close(fd);
+		return -1;
+	}
+
+	const size_t fileSize = st.st_size;
+	const char *map = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return -1;
+
+	madvise((void *) map, fileSize, MADV_SEQUENTIAL);
+
+	struct lruTableSnapshotHeader header;
+	memcpy(&header, map, sizeof(header));
+
+	if (memcmp(header.magic, LRU_TABLE_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+	    || header.version != LRU_TABLE_SNAPSHOT_VERSION
+	    || (header.flags & ~LRU_TABLE_SNAPSHOT_BYTES_KEYS) != 0) {
+		munmap((void *) map, fileSize);
+		return -1;
+	}
+
+	// The segments are only meaningful for the policy that created them.
+	const int samePolicy = (header.policy == (uint32_t) out->policy);
+
+	const int bytesKeys = (header.flags & LRU_TABLE_SNAPSHOT_BYTES_KEYS) != 0;
+	out->bytesKeys = bytesKeys;
+
+	// When the snapshot doesn't fit only the hottest records are loaded.
+	uint64_t skip = header.entries > out->maxEntries
+		? header.entries - out->maxEntries
+		: 0;
+
+	const char *it = map + sizeof(header);
+	const char *end = map + fileSize;
+	int ret = 0;
+
+	for (uint64_t i = 0; i < header.entries; ++i) {
+		if ((size_t)(end - it) < LRU_TABLE_RECORD_SIZE) {
+			ret = -1;
+			break;
+		}
+
+		int32_t key;
+		uint8_t segment;
+		uint64_t deadline;
+		uint32_t size;
+
+		memcpy(&key, it, sizeof(key));
+		it += sizeof(key);
+		memcpy(&segment, it, sizeof(segment));
+		it += sizeof(segment);
+		memcpy(&deadline, it, sizeof(deadline));
+		it += sizeof(deadline);
+		memcpy(&size, it, sizeof(size));
+		it += sizeof(size);
+
+		const char *bytes = NULL;
+		uint32_t length = 0;
+
+		if (bytesKeys) {
+			if ((size_t)(end - it) < sizeof(length)) {
+				ret = -1;
+				break;
+			}
+
+			memcpy(&length, it, sizeof(length));
+			it += sizeof(length);
+
+			if ((size_t)(end - it) < length) {
+				ret = -1;
+				break;
+			}
+
+			bytes = it;
+			it += length;
+		}
+
+		if ((size_t)(end - it) < size) {
+			ret = -1;
+			break;
+		}
+
+		const char *buffer = it;
+		it += size;
+
+		if (skip > 0) {
+			--skip;
+			continue;
+		}
+
+		if (deadline != 0 && deadline <= out->now)
+			continue;
+
+		// The inline key of the byte string keys is the hash.
+		const uint64_t hash = bytesKeys ? hashBytesKey(bytes, length) : 0;
+		if (bytesKeys)
+			key = (int32_t) hash;
+
+		// A corrupt snapshot can't put live nodes on the ghost lists or
+		// repeat keys.
+		const int repeated = bytesKeys
+			? _getBytesKeyNodeHashTable((HashTable *)out, hash, bytes, length,
+			                            sizeof(lruTableNode)) != NULL
+			: getKeyHashTable((HashTable *)out, key) != NULL;
+
+		if (repeated || (samePolicy && !_validSegmentlruTable(out->policy, segment))) {
+			ret = -1;
+			break;
+		}
+
+		void *value = deserialize(buffer, size, arg);
+		if (value == NULL)
+			continue;
+
+		// Build the node directly: there are no previous entries, hooks or
+		// evictions to handle like in insertKeylruTable.
+		lruTableNode *node = NULL;
+		if (bytesKeys) {
+			node = malloc(BYTES_KEY_NODE_SIZE(lruTableNode, length));
+			assert(node != NULL);
+			_initBytesKey(BYTES_KEY_NODE(lruTableNode, node), hash, bytes, length);
+		}
+
+		node = _allocInitlruTableNode(node, key, value);
+		node->weight = out->weigher != NULL ? out->weigher(key, value) : 1;
+		out->weight += node->weight;
+
+		if (bytesKeys)
+			_linkNodeHashTable((HashTable *)out, (HashTableNode *)node);
+		else
+			_insertNodeHashTable((HashTable *)out, (HashTableNode *)node);
+		_reattachPolicylruTable(out, node, samePolicy ? segment : LRU_TABLE_SEGMENT_MAIN);
+
+		_scheduleTimerlruTable(out, node, deadline);
+	}
+
+	munmap((void *) map, fileSize);
+
+	// Weighted tables can't know the weights in advance, so evict the excess.
+	while (out->weight > out->maxWeight)
+		free(_evictOnelruTable(out, 0));
+
+	flushEvictionslruTable(out);
+
+	return ret;
+}
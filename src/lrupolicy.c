@@ -0,0 +1,481 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Segment lists ===============================================================
+
+static void _pushlruTableList(lruTableList *list, lruTableNode *node, int segment)
+{
+	_registerlruTableList(&list->accesList, &list->lastAccess, node);
+	node->segment = segment;
+	list->entries++;
+}
+
+static void _removelruTableList(lruTableList *list, lruTableNode *node)
+{
+	assert(list->entries > 0);
+	_disconnectlruTableList(&list->accesList, &list->lastAccess, node);
+	list->entries--;
+}
+
+static size_t _mainEntrieslruTable(lruTable *in)
+{
+	struct lruTablePolicyData *data = in->policyData;
+	return in->entries - data->window.entries - data->probation.entries;
+}
+
+static lruTableList *_getSegmentListlruTable(lruTable *in, int segment)
+{
+	struct lruTablePolicyData *data = in->policyData;
+
+	switch (segment) {
+	case LRU_TABLE_SEGMENT_WINDOW:
+		return &data->window;
+	case LRU_TABLE_SEGMENT_PROBATION:
+		return &data->probation;
+	case LRU_TABLE_SEGMENT_GHOST_RECENT:
+		return &data->ghostRecent;
+	case LRU_TABLE_SEGMENT_GHOST_FREQUENT:
+		return &data->ghostFrequent;
+	}
+
+	// The main segment is lruTable#accesList, which has no counter.
+	return NULL;
+}
+
+// Frequency sketch ============================================================
+
+static uint64_t _mixlruTableSketch(int key)
+{
+	// splitmix64 finalizer
+	uint64_t h = (uint64_t)(uint32_t) key;
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+	return h ^ (h >> 31);
+}
+
+static void _allocInitlruTableSketch(lruTableSketch *out, size_t N)
+{
+	out->width = 16;
+	while (out->width < N)
+		out->width <<= 1;
+
+	// 4 rows with width counters of 4 bits (16 per word)
+	out->table = calloc(4 * out->width / 16, sizeof(uint64_t));
+	out->additions = 0;
+	out->sampleSize = 10 * out->width;
+}
+
+static void _freelruTableSketch(lruTableSketch *out)
+{
+	free(out->table);
+	out->table = NULL;
+}
+
+static size_t _indexlruTableSketch(lruTableSketch *in, uint64_t hash, int row)
+{
+	// Double hashing to get an independent column for every row.
+	const uint64_t step = (hash >> 32) | 1;
+	return row * in->width + ((hash + row * step) & (in->width - 1));
+}
+
+static unsigned _frequencylruTableSketch(lruTableSketch *in, int key)
+{
+	const uint64_t hash = _mixlruTableSketch(key);
+	unsigned ret = 15;
+
+	for (int row = 0; row < 4; ++row) {
+		const size_t idx = _indexlruTableSketch(in, hash, row);
+		const unsigned count = (in->table[idx / 16] >> (4 * (idx % 16))) & 0xF;
+		if (count < ret)
+			ret = count;
+	}
+	return ret;
+}
+
+static void _incrementlruTableSketch(lruTableSketch *in, int key)
+{
+	const uint64_t hash = _mixlruTableSketch(key);
+
+	for (int row = 0; row < 4; ++row) {
+		const size_t idx = _indexlruTableSketch(in, hash, row);
+		const int shift = 4 * (idx % 16);
+		if (((in->table[idx / 16] >> shift) & 0xF) != 0xF)
+			in->table[idx / 16] += (uint64_t) 1 << shift;
+	}
+
+	// Aging: halve all the counters so old popular keys fade out.
+	if (++in->additions == in->sampleSize) {
+		const size_t words = 4 * in->width / 16;
+		for (size_t i = 0; i < words; ++i)
+			in->table[i] = (in->table[i] >> 1) & 0x7777777777777777ull;
+		in->additions /= 2;
+	}
+}
+
+// Ghosts ======================================================================
+
+static void _dropGhostlruTable(lruTable *in, lruTableNode *ghost)
+{
+	struct lruTablePolicyData *data = in->policyData;
+
+	_removelruTableList(_getSegmentListlruTable(in, ghost->segment), ghost);
+	_extractNodeHashTable(&data->ghosts, (HashTableNode *) ghost);
+	free(ghost);
+}
+
+static void _dropOldestGhostlruTable(lruTable *in)
+{
+	struct lruTablePolicyData *data = in->policyData;
+
+	// ARC removes from B2 first when the ghost directory is full.
+	lruTableNode *ghost = data->ghostFrequent.accesList != NULL
+		? data->ghostFrequent.accesList
+		: data->ghostRecent.accesList;
+
+	assert(ghost != NULL);
+	_dropGhostlruTable(in, ghost);
+}
+
+static void _addGhostlruTable(lruTable *in, int key, int segment)
+{
+	struct lruTablePolicyData *data = in->policyData;
+	const size_t c = in->maxEntries;
+
+	// Byte string keys may share the inline key, keep only the newest ghost.
+	if (in->bytesKeys) {
+		lruTableNode *old = (lruTableNode *) getKeyHashTable(&data->ghosts, key);
+		if (old != NULL)
+			_dropGhostlruTable(in, old);
+	}
+
+	if (in->policy == LRU_TABLE_POLICY_2Q) {
+		while (data->ghostRecent.entries >= data->ghostMax)
+			_dropGhostlruTable(in, data->ghostRecent.accesList);
+	} else {
+		assert(in->policy == LRU_TABLE_POLICY_ARC);
+		// Keep |T1| + |B1| <= c and |B1| + |B2| <= c
+		if (segment == LRU_TABLE_SEGMENT_GHOST_RECENT) {
+			while (data->window.entries + data->ghostRecent.entries >= c
+			       && data->ghostRecent.entries > 0)
+				_dropGhostlruTable(in, data->ghostRecent.accesList);
+		}
+		while (data->ghostRecent.entries + data->ghostFrequent.entries >= c)
+			_dropOldestGhostlruTable(in);
+	}
+
+	lruTableNode *ghost = _allocInitlruTableNode(NULL, key, NULL);
+	_insertNodeHashTable(&data->ghosts, (HashTableNode *) ghost);
+	_pushlruTableList(_getSegmentListlruTable(in, segment), ghost, segment);
+}
+
+// Policy hooks ================================================================
+
+void _allocInitPolicyDatalruTable(lruTable *out)
+{
+	out->policyData = NULL;
+
+	if (out->policy == LRU_TABLE_POLICY_LRU
+	    || out->policy == LRU_TABLE_POLICY_CLOCK)
+		return;
+
+	struct lruTablePolicyData *data = calloc(1, sizeof(struct lruTablePolicyData));
+	assert(data != NULL);
+
+	allocInitHashTable(&data->ghosts, out->N);
+
+	out->policyData = data;
+	_resizePolicyDatalruTable(out);
+}
+
+void _resizePolicyDatalruTable(lruTable *out)
+{
+	struct lruTablePolicyData *data = out->policyData;
+
+	if (data == NULL)
+		return;
+
+	const size_t c = out->maxEntries;
+
+	switch (out->policy) {
+	case LRU_TABLE_POLICY_2Q:
+		data->windowMax = c / 4 > 0 ? c / 4 : 1;
+		data->ghostMax = c / 2 > 0 ? c / 2 : 1;
+		break;
+	case LRU_TABLE_POLICY_ARC:
+		if (data->target > c)
+			data->target = c;
+		break;
+	case LRU_TABLE_POLICY_TINYLFU:
+		data->windowMax = c / 100 > 0 ? c / 100 : 1;
+		data->protectedMax = (c - data->windowMax) * 8 / 10;
+
+		// The sketch only grows, it restarts counting in that case.
+		if (data->sketch.table == NULL || data->sketch.width < c) {
+			_freelruTableSketch(&data->sketch);
+			_allocInitlruTableSketch(&data->sketch, c);
+		}
+		break;
+	default:
+		break;
+	}
+
+	// The excess of ghosts is dropped on the next eviction.
+	if (c > data->ghosts.N)
+		rehashHashTable(&data->ghosts, c);
+}
+
+void _freePolicyDatalruTable(lruTable *out)
+{
+	struct lruTablePolicyData *data = out->policyData;
+
+	if (data == NULL)
+		return;
+
+	freeHashTable(&data->ghosts);
+	_freelruTableSketch(&data->sketch);
+	free(data);
+
+	out->policyData = NULL;
+}
+
+int _missPolicylruTable(lruTable *in, int key)
+{
+	struct lruTablePolicyData *data = in->policyData;
+
+	if (in->policy == LRU_TABLE_POLICY_TINYLFU) {
+		_incrementlruTableSketch(&data->sketch, key);
+		return 0;
+	}
+
+	if (in->policy != LRU_TABLE_POLICY_2Q && in->policy != LRU_TABLE_POLICY_ARC)
+		return 0;
+
+	lruTableNode *ghost = (lruTableNode *) getKeyHashTable(&data->ghosts, key);
+	if (ghost == NULL)
+		return 0;
+
+	const int segment = ghost->segment;
+
+	if (in->policy == LRU_TABLE_POLICY_ARC) {
+		// Adapt the target size of T1 in favor of the list with the ghost hit.
+		const size_t b1 = data->ghostRecent.entries;
+		const size_t b2 = data->ghostFrequent.entries;
+
+		if (segment == LRU_TABLE_SEGMENT_GHOST_RECENT) {
+			const size_t delta = b2 > b1 ? b2 / b1 : 1;
+			data->target = data->target + delta < in->maxEntries
+				? data->target + delta : in->maxEntries;
+		} else {
+			const size_t delta = b1 > b2 ? b1 / b2 : 1;
+			data->target = data->target > delta ? data->target - delta : 0;
+		}
+	}
+
+	// The ghost is removed now, so it cannot be dropped by the eviction.
+	_dropGhostlruTable(in, ghost);
+
+	return segment;
+}
+
+lruTableNode *_getVictimPolicylruTable(lruTable *in, int ghost)
+{
+	struct lruTablePolicyData *data = in->policyData;
+
+	switch (in->policy) {
+	case LRU_TABLE_POLICY_CLOCK:
+		// Move the clock hand (the head of the access list) giving a second
+		// chance to the referenced nodes. This always ends because the
+		// referenced bits are cleared while sweeping.
+		while (in->accesList->referenced) {
+			lruTableNode *node = in->accesList;
+			node->referenced = 0;
+			_disconnectlruTableNodeAccess(in, node);
+			_registerNodeAccess(in, node);
+		}
+		return in->accesList;
+
+	case LRU_TABLE_POLICY_2Q:
+		if (data->window.entries > data->windowMax || in->accesList == NULL)
+			return data->window.accesList;
+		return in->accesList;
+
+	case LRU_TABLE_POLICY_ARC:
+		if (data->window.entries > 0
+		    && (data->window.entries > data->target
+		        || (ghost == LRU_TABLE_SEGMENT_GHOST_FREQUENT
+		            && data->window.entries == data->target)
+		        || in->accesList == NULL))
+			return data->window.accesList;
+		return in->accesList;
+
+	case LRU_TABLE_POLICY_TINYLFU: {
+		lruTableNode *victim = data->probation.accesList != NULL
+			? data->probation.accesList
+			: in->accesList;
+
+		if (data->window.entries < data->windowMax || data->window.entries == 0)
+			return victim != NULL ? victim : data->window.accesList;
+
+		// The window is full, so its oldest node (candidate) must leave it.
+		lruTableNode *candidate = data->window.accesList;
+		if (victim == NULL)
+			return candidate;
+
+		if (_frequencylruTableSketch(&data->sketch, candidate->key)
+		    <= _frequencylruTableSketch(&data->sketch, victim->key))
+			return candidate;
+
+		// The candidate is admitted in the main segment.
+		_removelruTableList(&data->window, candidate);
+		_pushlruTableList(&data->probation, candidate, LRU_TABLE_SEGMENT_PROBATION);
+		return victim;
+	}
+
+	default:
+		return in->accesList;
+	}
+}
+
+void _disconnectPolicylruTable(lruTable *in, lruTableNode *node)
+{
+	if (node->segment == LRU_TABLE_SEGMENT_MAIN)
+		_disconnectlruTableNodeAccess(in, node);
+	else
+		_removelruTableList(_getSegmentListlruTable(in, node->segment), node);
+}
+
+void _reattachPolicylruTable(lruTable *in, lruTableNode *node, int segment)
+{
+	if (segment == LRU_TABLE_SEGMENT_MAIN) {
+		node->segment = LRU_TABLE_SEGMENT_MAIN;
+		_registerNodeAccess(in, node);
+	} else {
+		_pushlruTableList(_getSegmentListlruTable(in, segment), node, segment);
+	}
+}
+
+void _evictPolicylruTable(lruTable *in, lruTableNode *node)
+{
+	const int segment = node->segment;
+
+	_disconnectPolicylruTable(in, node);
+
+	if (in->policy == LRU_TABLE_POLICY_2Q && segment == LRU_TABLE_SEGMENT_WINDOW) {
+		_addGhostlruTable(in, node->key, LRU_TABLE_SEGMENT_GHOST_RECENT);
+	} else if (in->policy == LRU_TABLE_POLICY_ARC) {
+		_addGhostlruTable(in, node->key,
+		                  segment == LRU_TABLE_SEGMENT_WINDOW
+		                  ? LRU_TABLE_SEGMENT_GHOST_RECENT
+		                  : LRU_TABLE_SEGMENT_GHOST_FREQUENT);
+	}
+}
+
+void _placePolicylruTable(lruTable *in, lruTableNode *node, int ghost)
+{
+	struct lruTablePolicyData *data = in->policyData;
+
+	switch (in->policy) {
+	case LRU_TABLE_POLICY_2Q:
+	case LRU_TABLE_POLICY_ARC:
+		// Keys seen again after their eviction go directly to the main list.
+		if (ghost == 0) {
+			_pushlruTableList(&data->window, node, LRU_TABLE_SEGMENT_WINDOW);
+			return;
+		}
+		break;
+	case LRU_TABLE_POLICY_TINYLFU:
+		_pushlruTableList(&data->window, node, LRU_TABLE_SEGMENT_WINDOW);
+
+		// While the table is not full the window oldest nodes move to the main
+		// segment without competing with any victim.
+		if (data->window.entries > data->windowMax) {
+			lruTableNode *oldest = data->window.accesList;
+			_removelruTableList(&data->window, oldest);
+			_pushlruTableList(&data->probation, oldest, LRU_TABLE_SEGMENT_PROBATION);
+		}
+		return;
+	default:
+		break;
+	}
+
+	node->segment = LRU_TABLE_SEGMENT_MAIN;
+	_registerNodeAccess(in, node);
+}
+
+void _hitPolicylruTable(lruTable *in, lruTableNode *node)
+{
+	struct lruTablePolicyData *data = in->policyData;
+
+	switch (in->policy) {
+	case LRU_TABLE_POLICY_CLOCK:
+		node->referenced = 1;
+		return;
+
+	case LRU_TABLE_POLICY_2Q:
+		// A1in is a FIFO, hits don't change it.
+		if (node->segment == LRU_TABLE_SEGMENT_WINDOW)
+			return;
+		break;
+
+	case LRU_TABLE_POLICY_ARC:
+		// Second access, promote from T1 to T2.
+		if (node->segment == LRU_TABLE_SEGMENT_WINDOW) {
+			_removelruTableList(&data->window, node);
+			node->segment = LRU_TABLE_SEGMENT_MAIN;
+		}
+		break;
+
+	case LRU_TABLE_POLICY_TINYLFU:
+		_incrementlruTableSketch(&data->sketch, node->key);
+
+		if (node->segment == LRU_TABLE_SEGMENT_WINDOW) {
+			_removelruTableList(&data->window, node);
+			_pushlruTableList(&data->window, node, LRU_TABLE_SEGMENT_WINDOW);
+			return;
+		}
+
+		if (node->segment == LRU_TABLE_SEGMENT_PROBATION) {
+			// Promote to protected and demote its oldest when it is full.
+			_removelruTableList(&data->probation, node);
+			node->segment = LRU_TABLE_SEGMENT_MAIN;
+			_registerNodeAccess(in, node);
+
+			if (_mainEntrieslruTable(in) > data->protectedMax) {
+				lruTableNode *demoted = in->accesList;
+				_disconnectlruTableNodeAccess(in, demoted);
+				_pushlruTableList(&data->probation, demoted,
+				                  LRU_TABLE_SEGMENT_PROBATION);
+			}
+			return;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	_disconnectlruTableNodeAccess(in, node);
+	_registerNodeAccess(in, node);
+}
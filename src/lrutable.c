@@ -18,13 +18,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 #include "c-container.h"
 #include "c-container-internal.h"
 
 // List Node ===================================================================
 
-static lruTableNode* _allocInitlruTableNode(lruTableNode *node, int key, void *value)
+lruTableNode* _allocInitlruTableNode(lruTableNode *node, int key, void *value)
 {
 	if (node == NULL) {
 		node = malloc(sizeof(struct lruTableNode));
@@ -35,47 +36,120 @@ static lruTableNode* _allocInitlruTableNode(lruTableNode *node, int key, void *v
 
 	node->left = NULL;
 	node->right = NULL;
+	node->referenced = 0;
+	node->segment = 0;
+	node->weight = 0;
+
+	node->timer = NULL;
 
 	return node;
 }
 
-void allocInitlruTable(lruTable *out, size_t N)
-{
+void allocInitCapacitylruTable(
+	lruTable *out, size_t N, size_t maxEntries, lruTablePolicy policy
+) {
+	assert(maxEntries > 0);
 	allocInitHashTable((HashTable *) out, N);
 
 	assert(out->N == N);
 
-	out->maxEntries = N;
+	out->maxEntries = maxEntries;
 	out->accesList = NULL;
 	out->lastAccess = NULL;
+	out->policy = policy;
+
+	out->weight = 0;
+	out->maxWeight = SIZE_MAX;
+	out->weigher = NULL;
+
+	out->now = 0;
+	out->defaultTTL = 0;
+	out->timers = NULL;
+
+	out->stats = (lruTableStats) {0};
+	out->evictFunc = NULL;
+	out->evictBatchFunc = NULL;
+	out->evictArg = NULL;
+	out->victims = NULL;
+	out->nVictims = 0;
+	out->maxVictims = 0;
+
+	out->readBuffer = NULL;
+	out->readBufferEntries = 0;
+	out->readBufferSize = 0;
+
+	out->freeNodes = NULL;
+
+	_allocInitPolicyDatalruTable(out);
+}
+
+void allocInitPolicylruTable(lruTable *out, size_t N, lruTablePolicy policy)
+{
+	allocInitCapacitylruTable(out, N, N, policy);
+}
+
+void allocInitlruTable(lruTable *out, size_t N)
+{
+	allocInitPolicylruTable(out, N, LRU_TABLE_POLICY_LRU);
+}
+
+void allocInitWeightedlruTable(
+	lruTable *out, size_t N, size_t maxWeight,
+	size_t (*weigher)(int key, void *value)
+) {
+	allocInitlruTable(out, N);
+
+	out->maxWeight = maxWeight;
+	out->weigher = weigher;
 }
 
 void freelruTable(lruTable *out)
 {
+	flushEvictionslruTable(out);
+	free(out->victims);
+	out->victims = NULL;
+
+	free(out->readBuffer);
+	out->readBuffer = NULL;
+	out->readBufferEntries = 0;
+
+	while (out->freeNodes != NULL) {
+		lruTableNode *next = out->freeNodes->right;
+		free(out->freeNodes);
+		out->freeNodes = next;
+	}
+
+	_freePolicyDatalruTable(out);
+	_freeTimerWheellruTable(out);
 	freeHashTable((HashTable *) out);
 
 	out->maxEntries = 0;
 	out->accesList = NULL;
 	out->lastAccess = NULL;
+	out->weight = 0;
 }
 
-void _disconnectlruTableNodeAccess(lruTable *in, lruTableNode *node)
-{
+void _disconnectlruTableList(
+	lruTableNode **first, lruTableNode **last, lruTableNode *node
+) {
 	// Remove one node from the access and connect the adjacent ones.  The node
 	// may be released individually, but this is not a perfect world and there
 	// are race conditions.
 	assert(node != NULL);
 
-	if (node->left == NULL && node->right == NULL) {
-		return;
-	} else if (in->accesList == node) {     // it is the oldest access, so no left
+	if (*first == node) {              // it is the oldest access, so no left
 		assert(node->left == NULL);
-		in->accesList = node->right;
-		in->accesList->left = NULL;
-	} else if (in->lastAccess == node) { // it is the newer access, so no right
+		*first = node->right;
+		if (*first != NULL)
+			(*first)->left = NULL;
+		else
+			*last = NULL;
+	} else if (*last == node) {        // it is the newer access, so no right
 		assert(node->right == NULL);
-		in->lastAccess = node->left;
-		in->lastAccess->right = NULL;
+		*last = node->left;
+		(*last)->right = NULL;
+	} else if (node->left == NULL && node->right == NULL) {
+		return;                        // it is not in the list
 	} else {
 		node->left->right = node->right;
 		node->right->left = node->left;
@@ -84,74 +158,471 @@ void _disconnectlruTableNodeAccess(lruTable *in, lruTableNode *node)
 	node->left = NULL;
 }
 
-void _registerNodeAccess(lruTable *in, lruTableNode *node)
-{
+void _registerlruTableList(
+	lruTableNode **first, lruTableNode **last, lruTableNode *node
+) {
 	assert(node != NULL);
 	// This may be called every time a new node is accessed or when a value is
 	// retrieved with the get function.
-	if (in->lastAccess == NULL) {  // Registering the very first access
-		assert(in->accesList == NULL);
-		in->accesList = node;
-		in->lastAccess = node;
+	if (*last == NULL) {  // Registering the very first access
+		assert(*first == NULL);
+		*first = node;
+		*last = node;
 	}
 
 	// When it is the last access just exit, no changes needed
-	if (in->lastAccess == node) {
+	if (*last == node) {
 		return;
 	}
 
-	in->lastAccess->right = node;
-	node->left = in->lastAccess;
-	in->lastAccess = node;
+	(*last)->right = node;
+	node->left = *last;
+	*last = node;
 }
 
-lruTableNode *insertKeylruTable(lruTable *out, int key, void *value)
+void _disconnectlruTableNodeAccess(lruTable *in, lruTableNode *node)
+{
+	_disconnectlruTableList(&in->accesList, &in->lastAccess, node);
+}
+
+void _registerNodeAccess(lruTable *in, lruTableNode *node)
 {
+	_registerlruTableList(&in->accesList, &in->lastAccess, node);
+}
+
+void setEvictionCallbacklruTable(
+	lruTable *out,
+	void (*func)(int key, void *value, lruTableRemovalCause cause, void *arg),
+	void *arg
+) {
+	flushEvictionslruTable(out);
+
+	out->evictFunc = func;
+	out->evictBatchFunc = NULL;
+	out->evictArg = arg;
+}
+
+void setBatchEvictionCallbacklruTable(
+	lruTable *out,
+	void (*func)(const lruTableVictim *victims, size_t n, void *arg),
+	size_t batchSize,
+	void *arg
+) {
+	assert(func == NULL || batchSize > 0);
+	flushEvictionslruTable(out);
+
+	out->evictFunc = NULL;
+	out->evictBatchFunc = func;
+	out->evictArg = arg;
+
+	out->victims = realloc(out->victims, batchSize * sizeof(lruTableVictim));
+	assert(batchSize == 0 || out->victims != NULL);
+	out->maxVictims = batchSize;
+}
+
+void flushEvictionslruTable(lruTable *out)
+{
+	if (out->nVictims == 0)
+		return;
+
+	assert(out->evictBatchFunc != NULL);
+	out->evictBatchFunc(out->victims, out->nVictims, out->evictArg);
+	out->nVictims = 0;
+}
+
+static void _releaseValuelruTable(
+	lruTable *out, lruTableNode *node, lruTableRemovalCause cause
+) {
+	// With callbacks the value ownership goes to them.
+	if (out->evictBatchFunc != NULL) {
+		out->victims[out->nVictims++] = (lruTableVictim) {node->key, node->value, cause};
+		if (out->nVictims == out->maxVictims)
+			flushEvictionslruTable(out);
+	} else if (out->evictFunc != NULL) {
+		out->evictFunc(node->key, node->value, cause, out->evictArg);
+	} else {
+		_destroyValue(out->ops, node->value);
+	}
+	node->value = NULL;
+}
+
+lruTableNode *_evictOnelruTable(lruTable *out, int ghost)
+{
+	// We return the node here to save malloc calls
+	lruTableNode *node = _getVictimPolicylruTable(out, ghost);
+	assert(node != NULL);
+
+	// Remove the victim chosen by the policy.
+	_evictPolicylruTable(out, node);
+	_cancelTimerlruTable(out, node);
+
+	// This performs an extra search
+	lruTableNode *tmp = (lruTableNode *)_extractNodeHashTable(
+		(HashTable *)out, (HashTableNode *)node);
+
+	assert(tmp == node);
+	(void) tmp;
+
+	// The node is reused, but the value is owned by the table.
+	out->weight -= node->weight;
+	_relaxedIncrement(&out->stats.evictions);
+	_releaseValuelruTable(out, node, LRU_TABLE_EVICTED);
+
+	return node;
+}
+
+void _removeNodelruTable(
+	lruTable *out, lruTableNode *node, lruTableRemovalCause cause
+) {
+	// The read buffer can't keep references to removed nodes.
+	drainReadBufferlruTable(out);
+
+	_disconnectPolicylruTable(out, node);
+	_cancelTimerlruTable(out, node);
+	_extractNodeHashTable((HashTable *)out, (HashTableNode *)node);
+
+	out->weight -= node->weight;
+	_releaseValuelruTable(out, node, cause);
+
+	// Keep the node for the next insertion, the free list uses the right link.
+	node->right = out->freeNodes;
+	out->freeNodes = node;
+}
+
+static void _setTTLlruTableNode(lruTable *out, lruTableNode *node, uint64_t ttl)
+{
+	_scheduleTimerlruTable(out, node, ttl > 0 ? out->now + ttl : 0);
+}
+
+static inline lruTableNode *_getBytesKeyNodelruTable(
+	lruTable *in, uint64_t hash, const void *bytes, size_t length
+) {
+	return (lruTableNode *) _getBytesKeyNodeHashTable(
+		(HashTable *) in, hash, bytes, length, sizeof(lruTableNode)
+	);
+}
+
+// bytes is NULL for int keys, else key is the inline key of hash.
+static lruTableNode *_insertlruTable(
+	lruTable *out, int key, const void *bytes, size_t length, uint64_t hash,
+	void *value, size_t weight, uint64_t ttl
+) {
 	assert(out->N > 0);
 	assert(out->entries <= out->maxEntries);
-	HashTableNode *nodeUncasted = getKeyHashTable((HashTable *)out, key);
 
-	lruTableNode *node = (lruTableNode *) nodeUncasted;
+	// Apply the pending accesses before any eviction.
+	drainReadBufferlruTable(out);
+
+	lruTableNode *node = (bytes == NULL)
+		? (lruTableNode *) getKeyHashTable((HashTable *)out, key)
+		: _getBytesKeyNodelruTable(out, hash, bytes, length);
+
+	if (weight > out->maxWeight) {
+		// Too large to admit. An old value for the same key is stale now.
+		_relaxedIncrement(&out->stats.rejections);
+		if (node != NULL)
+			_removeNodelruTable(out, node, LRU_TABLE_REJECTED);
+		return NULL;
+	}
 
 	if (node != NULL) {
 		// Node exist, so update value only
-		free(node->value);
-		node->value = value;
-		_disconnectlruTableNodeAccess(out, node);
-	} else {
+		_relaxedIncrement(&out->stats.updates);
+		_destroyValue(out->ops, node->value);
+		node->value = _cloneValue(out->ops, value);
+		_hitPolicylruTable(out, node);
+
+		out->weight = out->weight - node->weight + weight;
+		node->weight = weight;
+
+		if (out->weight > out->maxWeight) {
+			// Detach the node while evicting so it can't be chosen as victim.
+			const int segment = node->segment;
+			_disconnectPolicylruTable(out, node);
+
+			while (out->weight > out->maxWeight)
+				free(_evictOnelruTable(out, 0));
+
+			_reattachPolicylruTable(out, node, segment);
+		}
 
-		if (out->entries == out->maxEntries) {
-			node = out->accesList; // We set node here to save malloc calls
+		_setTTLlruTableNode(out, node, ttl);
+	} else {
+		// Non zero when the key was recently evicted and the policy remembers it.
+		const int ghost = _missPolicylruTable(out, key);
+		_relaxedIncrement(&out->stats.inserts);
 
-			// When full, remove the least recent access.
-			_disconnectlruTableNodeAccess(out, node);
+		// Weighted tables may need to evict several nodes, only the last one
+		// is reused.
+		while (out->entries == out->maxEntries
+		       || out->weight + weight > out->maxWeight) {
+			free(node);
+			node = _evictOnelruTable(out, ghost);
+		}
 
-			// This performs an extra search
-			lruTableNode *tmp = (lruTableNode *)_extractNodeHashTable(
-				(HashTable *)out, (HashTableNode *)node);
+		if (node == NULL && out->freeNodes != NULL) {
+			node = out->freeNodes;
+			out->freeNodes = node->right;
+		}
 
-			assert(tmp == node);
+		if (bytes != NULL) {
+			// The recycled nodes may be too small for the key.
+			node = realloc(node, BYTES_KEY_NODE_SIZE(lruTableNode, length));
 			assert(node != NULL);
-			assert(out->entries == out->maxEntries - 1);
+			_initBytesKey(BYTES_KEY_NODE(lruTableNode, node), hash, bytes, length);
+			out->bytesKeys = 1;
 		}
 
 		// if node == NULL malloc is called, else the node is reset.
-		node = _allocInitlruTableNode(node, key, value);
-		_insertNodeHashTable((HashTable *)out, (HashTableNode *)node);
+		node = _allocInitlruTableNode(node, key, _cloneValue(out->ops, value));
+		node->weight = weight;
+		out->weight += weight;
+		_linkNodeHashTable((HashTable *)out, (HashTableNode *)node);
+
+		// Push the node in the access list of the right segment.
+		_placePolicylruTable(out, node, ghost);
+		_setTTLlruTableNode(out, node, ttl);
 	}
 
-	// Push the node at the end of the use table.
-	_registerNodeAccess(out, node);
+	return node;
+}
+
+lruTableNode *insertWeightlruTable(
+	lruTable *out, int key, void *value, size_t weight
+) {
+	return _insertlruTable(out, key, NULL, 0, 0, value, weight, out->defaultTTL);
+}
 
+lruTableNode *insertTTLlruTable(lruTable *out, int key, void *value, uint64_t ttl)
+{
+	const size_t weight = out->weigher != NULL ? out->weigher(key, value) : 1;
+	return _insertlruTable(out, key, NULL, 0, 0, value, weight, ttl);
+}
+
+lruTableNode *insertKeylruTable(lruTable *out, int key, void *value)
+{
+	return insertTTLlruTable(out, key, value, out->defaultTTL);
+}
+
+void resizelruTable(lruTable *out, size_t maxEntries)
+{
+	assert(maxEntries > 0);
+	drainReadBufferlruTable(out);
+
+	// Shrinking evicts all the extra nodes at once.
+	while (out->entries > maxEntries)
+		free(_evictOnelruTable(out, 0));
+
+	flushEvictionslruTable(out);
+
+	out->maxEntries = maxEntries;
+	_resizePolicyDatalruTable(out);
+
+	// Keep the load factor under 1 when growing.
+	if (maxEntries > out->N)
+		rehashHashTable((HashTable *) out, maxEntries);
+}
+
+// Register the access to the node found by a lookup.
+static lruTableNode *_getlruTable(lruTable *out, lruTableNode *node)
+{
+	if (node != NULL && node->timer != NULL && node->timer->deadline <= out->now) {
+		// Expired but not removed yet by expirelruTable.
+		_relaxedIncrement(&out->stats.expirations);
+		_removeNodelruTable(out, node, LRU_TABLE_EXPIRED);
+		node = NULL;
+	}
+
+	if (node != NULL) {
+		_relaxedIncrement(&out->stats.hits);
+
+		if (out->readBuffer == NULL) {
+			_hitPolicylruTable(out, node);
+		} else {
+			out->readBuffer[out->readBufferEntries++] = node;
+			if (out->readBufferEntries == out->readBufferSize)
+				drainReadBufferlruTable(out);
+		}
+	} else {
+		_relaxedIncrement(&out->stats.misses);
+	}
 	return node;
 }
 
 lruTableNode *getKeylruTable(lruTable *out, int key)
 {
-	lruTableNode *node = (lruTableNode *)getKeyHashTable((HashTable *)out, key);
-	if (node != NULL) {
-		_disconnectlruTableNodeAccess(out, node);
-		_registerNodeAccess(out, node);
+	return _getlruTable(out, (lruTableNode *) getKeyHashTable((HashTable *)out, key));
+}
+
+lruTableNode *getOrLoadlruTable(
+	lruTable *out, int key,
+	void *(*loader)(int key, void *ctx),
+	void *ctx
+) {
+	lruTableNode *node = getKeylruTable(out, key);
+	if (node != NULL)
+		return node;
+
+	void *value = loader(key, ctx);
+	if (value == NULL)
+		return NULL;
+
+	// A rejected value is still ours.
+	node = insertKeylruTable(out, key, value);
+	if (node == NULL)
+		_destroyValue(out->ops, value);
+
+	return node;
+}
+
+size_t evictlruTable(lruTable *out, size_t n)
+{
+	drainReadBufferlruTable(out);
+
+	size_t evicted = 0;
+
+	for (; evicted < n && out->entries > 0; ++evicted) {
+		lruTableNode *node = _evictOnelruTable(out, 0);
+		node->right = out->freeNodes;
+		out->freeNodes = node;
+	}
+
+	flushEvictionslruTable(out);
+
+	return evicted;
+}
+
+static int _poplruTable(lruTable *out, lruTableNode *node)
+{
+	if (node == NULL)
+		return 0;
+
+	_relaxedIncrement(&out->stats.removals);
+	_removeNodelruTable(out, node, LRU_TABLE_REMOVED);
+	return 1;
+}
+
+int popKeylruTable(lruTable *out, int key)
+{
+	return _poplruTable(out, (lruTableNode *) getKeyHashTable((HashTable *)out, key));
+}
+
+static size_t _purgelruTableList(
+	lruTable *out, lruTableNode *node,
+	int (*predicate)(const struct lruTableNode *node, void *ctx),
+	void *ctx
+) {
+	size_t removed = 0;
+
+	while (node != NULL) {
+		lruTableNode *next = node->right;
+
+		if (predicate(node, ctx)) {
+			_relaxedIncrement(&out->stats.removals);
+			_removeNodelruTable(out, node, LRU_TABLE_REMOVED);
+			++removed;
+		}
+		node = next;
+	}
+
+	return removed;
+}
+
+size_t purgelruTable(
+	lruTable *out,
+	int (*predicate)(const struct lruTableNode *node, void *ctx),
+	void *ctx
+) {
+	drainReadBufferlruTable(out);
+
+	size_t removed = 0;
+
+	if (out->policyData != NULL) {
+		struct lruTablePolicyData *data = out->policyData;
+		removed += _purgelruTableList(out, data->window.accesList, predicate, ctx);
+		removed += _purgelruTableList(out, data->probation.accesList, predicate, ctx);
 	}
+
+	removed += _purgelruTableList(out, out->accesList, predicate, ctx);
+
+	flushEvictionslruTable(out);
+
+	return removed;
+}
+
+lruTableNode *peeklruTable(lruTable *in, int key)
+{
+	lruTableNode *node = (lruTableNode *)getKeyHashTable((HashTable *)in, key);
+
+	if (node != NULL && node->timer != NULL && node->timer->deadline <= in->now)
+		return NULL;
+
 	return node;
 }
+
+void setReadBufferlruTable(lruTable *out, size_t size)
+{
+	drainReadBufferlruTable(out);
+
+	free(out->readBuffer);
+	out->readBuffer = size > 0 ? malloc(size * sizeof(lruTableNode *)) : NULL;
+	assert(size == 0 || out->readBuffer != NULL);
+	out->readBufferSize = size;
+}
+
+void setFilterlruTable(lruTable *out, FilterType type)
+{
+	_setFilterHashTable((HashTable *) out, type, out->maxEntries);
+}
+
+void setValueOpslruTable(lruTable *out, const ValueOps *ops)
+{
+	setValueOpsHashTable((HashTable *) out, ops);
+}
+
+lruTableNode *insertBytesKeylruTable(
+	lruTable *out, const void *key, size_t length, void *value
+) {
+	const uint64_t hash = hashBytesKey(key, length);
+	const size_t weight = out->weigher != NULL ? out->weigher((int) hash, value) : 1;
+
+	return _insertlruTable(out, (int) hash, key, length, hash,
+	                       value, weight, out->defaultTTL);
+}
+
+lruTableNode *getBytesKeylruTable(lruTable *out, const void *key, size_t length)
+{
+	const uint64_t hash = hashBytesKey(key, length);
+	return _getlruTable(out, _getBytesKeyNodelruTable(out, hash, key, length));
+}
+
+int popBytesKeylruTable(lruTable *out, const void *key, size_t length)
+{
+	const uint64_t hash = hashBytesKey(key, length);
+	return _poplruTable(out, _getBytesKeyNodelruTable(out, hash, key, length));
+}
+
+const BytesKey *getBytesKeylruTableNode(const lruTableNode *node)
+{
+	return BYTES_KEY_NODE(lruTableNode, node);
+}
+
+void drainReadBufferlruTable(lruTable *out)
+{
+	for (size_t i = 0; i < out->readBufferEntries; ++i)
+		_hitPolicylruTable(out, out->readBuffer[i]);
+
+	out->readBufferEntries = 0;
+}
+
+void getStatslruTable(lruTable *in, lruTableStats *out)
+{
+	out->hits = __atomic_load_n(&in->stats.hits, __ATOMIC_RELAXED);
+	out->misses = __atomic_load_n(&in->stats.misses, __ATOMIC_RELAXED);
+	out->inserts = __atomic_load_n(&in->stats.inserts, __ATOMIC_RELAXED);
+	out->updates = __atomic_load_n(&in->stats.updates, __ATOMIC_RELAXED);
+	out->evictions = __atomic_load_n(&in->stats.evictions, __ATOMIC_RELAXED);
+	out->expirations = __atomic_load_n(&in->stats.expirations, __ATOMIC_RELAXED);
+	out->rejections = __atomic_load_n(&in->stats.rejections, __ATOMIC_RELAXED);
+	out->removals = __atomic_load_n(&in->stats.removals, __ATOMIC_RELAXED);
+}
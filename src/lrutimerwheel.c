@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Timer wheel =================================================================
+
+static void _addTimerWheel(struct lruTableTimerWheel *wheel, struct lruTableTimer *timer)
+{
+	// Deadlines in the past expire in the next tick and the ones beyond the
+	// wheel range are clamped (and rescheduled when they reach the level 0).
+	const uint64_t range = (uint64_t) 1 << (LRU_TABLE_WHEEL_BITS * LRU_TABLE_WHEEL_LEVELS);
+
+	uint64_t deadline = timer->deadline;
+	if (deadline <= wheel->current)
+		deadline = wheel->current + 1;
+	else if (deadline - wheel->current >= range)
+		deadline = wheel->current + range - 1;
+
+	const uint64_t delta = deadline - wheel->current;
+
+	int level = 0;
+	while (level < LRU_TABLE_WHEEL_LEVELS - 1
+	       && delta >= (uint64_t) 1 << (LRU_TABLE_WHEEL_BITS * (level + 1)))
+		++level;
+
+	const size_t slot = (deadline >> (LRU_TABLE_WHEEL_BITS * level))
+		& (LRU_TABLE_WHEEL_SLOTS - 1);
+
+	timer->level = level;
+	wheel->levelTimers[level]++;
+
+	// Push front in the slot list.
+	struct lruTableTimer **head = &wheel->slots[level][slot];
+	timer->next = *head;
+	if (*head != NULL)
+		(*head)->ref = &timer->next;
+	timer->ref = head;
+	*head = timer;
+}
+
+static void _removeTimerWheel(struct lruTableTimerWheel *wheel, struct lruTableTimer *timer)
+{
+	assert(timer->ref != NULL);
+	assert(wheel->levelTimers[timer->level] > 0);
+
+	wheel->levelTimers[timer->level]--;
+
+	*timer->ref = timer->next;
+	if (timer->next != NULL)
+		timer->next->ref = timer->ref;
+
+	timer->next = NULL;
+	timer->ref = NULL;
+}
+
+void _scheduleTimerlruTable(lruTable *in, lruTableNode *node, uint64_t deadline)
+{
+	if (deadline == 0) {
+		_cancelTimerlruTable(in, node);
+		return;
+	}
+
+	if (in->timers == NULL) {
+		in->timers = calloc(1, sizeof(struct lruTableTimerWheel));
+		assert(in->timers != NULL);
+		in->timers->current = in->now;
+	}
+
+	struct lruTableTimer *timer = node->timer;
+
+	// Reuse the timer when the node already has one.
+	if (timer != NULL) {
+		_removeTimerWheel(in->timers, timer);
+	} else {
+		timer = malloc(sizeof(struct lruTableTimer));
+		assert(timer != NULL);
+		timer->node = node;
+		node->timer = timer;
+		in->timers->timers++;
+	}
+
+	timer->deadline = deadline;
+	_addTimerWheel(in->timers, timer);
+}
+
+void _cancelTimerlruTable(lruTable *in, lruTableNode *node)
+{
+	struct lruTableTimer *timer = node->timer;
+	if (timer == NULL)
+		return;
+
+	assert(in->timers != NULL);
+	assert(in->timers->timers > 0);
+
+	_removeTimerWheel(in->timers, timer);
+	in->timers->timers--;
+
+	free(timer);
+	node->timer = NULL;
+}
+
+void _freeTimerWheellruTable(lruTable *out)
+{
+	struct lruTableTimerWheel *wheel = out->timers;
+	if (wheel == NULL)
+		return;
+
+	// The nodes are released with the hash table, only the timers are here.
+	for (int level = 0; level < LRU_TABLE_WHEEL_LEVELS; ++level) {
+		for (size_t slot = 0; slot < LRU_TABLE_WHEEL_SLOTS && wheel->levelTimers[level] > 0; ++slot) {
+			struct lruTableTimer *it = wheel->slots[level][slot];
+
+			while (it != NULL) {
+				struct lruTableTimer *next = it->next;
+				it->node->timer = NULL;
+				free(it);
+				wheel->levelTimers[level]--;
+				it = next;
+			}
+		}
+	}
+
+	free(wheel);
+	out->timers = NULL;
+}
+
+size_t expirelruTable(lruTable *out, uint64_t now)
+{
+	if (now <= out->now)
+		return 0;
+
+	out->now = now;
+	drainReadBufferlruTable(out);
+
+	struct lruTableTimerWheel *wheel = out->timers;
+	if (wheel == NULL)
+		return 0;
+
+	size_t expired = 0;
+
+	while (wheel->current < now) {
+		// Nothing to do in the empty ticks.
+		if (wheel->timers == 0) {
+			wheel->current = now;
+			break;
+		}
+
+		// When the lower levels are empty nothing happens until the next
+		// slot of the first non empty level, so jump there.
+		int empty = 0;
+		while (wheel->levelTimers[empty] == 0)
+			++empty;
+
+		if (empty > 0) {
+			const uint64_t mask = ((uint64_t) 1 << (LRU_TABLE_WHEEL_BITS * empty)) - 1;
+			const uint64_t last = wheel->current | mask;
+
+			if (last >= now) {
+				wheel->current = now;
+				break;
+			}
+			wheel->current = last;
+		}
+
+		const uint64_t tick = ++wheel->current;
+
+		// Cascade the slots of the upper levels starting at this tick.
+		for (int level = LRU_TABLE_WHEEL_LEVELS - 1; level > 0; --level) {
+			const uint64_t mask = ((uint64_t) 1 << (LRU_TABLE_WHEEL_BITS * level)) - 1;
+			if ((tick & mask) != 0)
+				continue;
+
+			const size_t slot = (tick >> (LRU_TABLE_WHEEL_BITS * level))
+				& (LRU_TABLE_WHEEL_SLOTS - 1);
+
+			struct lruTableTimer *it = wheel->slots[level][slot];
+
+			while (it != NULL) {
+				struct lruTableTimer *next = it->next;
+				_removeTimerWheel(wheel, it);
+				_addTimerWheel(wheel, it);
+				it = next;
+			}
+		}
+
+		struct lruTableTimer *it = wheel->slots[0][tick & (LRU_TABLE_WHEEL_SLOTS - 1)];
+
+		while (it != NULL) {
+			struct lruTableTimer *next = it->next;
+
+			if (it->deadline <= tick) {
+				// This also cancels and releases the timer.
+				_relaxedIncrement(&out->stats.expirations);
+				_removeNodelruTable(out, it->node, LRU_TABLE_EXPIRED);
+				++expired;
+			} else {
+				_removeTimerWheel(wheel, it);
+				// It was clamped to the wheel range.
+				_addTimerWheel(wheel, it);
+			}
+			it = next;
+		}
+	}
+
+	flushEvictionslruTable(out);
+
+	return expired;
+}
@@ -0,0 +1,597 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Image format ================================================================
+//
+//   header | buckets (uint64, nBuckets + 1) | records | data
+//
+// Every section starts at a multiple of 64 bytes and the values in the data
+// section at multiples of 8. The checksum covers everything after the header.
+
+#define MAPPED_TABLE_MAGIC "CCMT"
+#define MAPPED_TABLE_VERSION 1
+
+struct MappedTableHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t entries;
+	uint64_t nBuckets;
+	uint64_t dataSize;
+	uint64_t fileSize;
+	uint64_t checksum;
+	uint64_t reserved2;
+};
+
+_Static_assert(sizeof(struct MappedTableHeader) == 64, "Header must be 64 bytes");
+
+struct MappedTableLayout {
+	size_t buckets;
+	size_t records;
+	size_t data;
+	size_t fileSize;
+};
+
+static inline size_t _alignMappedTable(size_t size, size_t alignment)
+{
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+static struct MappedTableLayout _layoutMappedTable(
+	size_t entries, size_t nBuckets, size_t dataSize
+) {
+	struct MappedTableLayout layout;
+
+	layout.buckets = sizeof(struct MappedTableHeader);
+	layout.records = layout.buckets
+		+ _alignMappedTable((nBuckets + 1) * sizeof(uint64_t), 64);
+	layout.data = layout.records
+		+ _alignMappedTable(entries * sizeof(MappedTableRecord), 64);
+	layout.fileSize = layout.data + dataSize;
+
+	return layout;
+}
+
+static uint64_t _checksumMappedTable(const unsigned char *buffer, size_t size)
+{
+	uint64_t hash = 0x9e3779b97f4a7c15ULL ^ size;
+
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, buffer + i, sizeof(word));
+
+		hash ^= word * 0xff51afd7ed558ccdULL;
+		hash = ((hash << 31) | (hash >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+	}
+
+	for (; i < size; ++i)
+		hash = (hash ^ buffer[i]) * 0x100000001b3ULL;
+
+	return hash;
+}
+
+// Dump ========================================================================
+
+struct MappedTableEntry {
+	int key;
+	void *value;
+};
+
+struct MappedTableCollect {
+	struct MappedTableEntry *entries;
+	size_t count;
+};
+
+static int _writeMappedTable(
+	const char *filename, MappedTableType type,
+	const struct MappedTableEntry *entries, size_t count,
+	const uint64_t *buckets, size_t nBuckets,
+	size_t (*serialize)(const void *value, void *buffer, size_t size, void *arg),
+	void *arg
+) {
+	// Write a temporary file and rename it, so the processes with the old
+	// file mapped keep their version.
+	const size_t length = strlen(filename);
+	char *tmpname = malloc(length + 8);
+	assert(tmpname != NULL);
+	memcpy(tmpname, filename, length);
+	memcpy(tmpname + length, ".XXXXXX", 8);
+
+	const int fd = mkstemp(tmpname);
+	FILE *file = (fd >= 0) ? fdopen(fd, "w+b") : NULL;
+
+	if (file == NULL) {
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmpname);
+		}
+		free(tmpname);
+		return -1;
+	}
+
+	MappedTableRecord *records = malloc(count * sizeof(MappedTableRecord) + 1);
+	assert(records != NULL);
+
+	size_t bufferSize = 4096;
+	void *buffer = malloc(bufferSize);
+	assert(buffer != NULL);
+
+	const struct MappedTableLayout empty = _layoutMappedTable(count, nBuckets, 0);
+	const char padding[64] = {0};
+
+	int ret = fseek(file, empty.data, SEEK_SET);
+
+	// The values first, the records need their offsets.
+	uint64_t offset = 0;
+
+	for (size_t i = 0; i < count && ret == 0; ++i) {
+		size_t size = serialize(entries[i].value, buffer, bufferSize, arg);
+
+		if (size > bufferSize) {
+			// Grow the buffer (like snprintf) and serialize again.
+			free(buffer);
+			bufferSize = 2 * size;
+			buffer = malloc(bufferSize);
+			assert(buffer != NULL);
+
+			size = serialize(entries[i].value, buffer, bufferSize, arg);
+			assert(size <= bufferSize);
+		}
+
+		if (size > UINT32_MAX) {
+			ret = -1;
+			break;
+		}
+
+		records[i].key = entries[i].key;
+		records[i].size = size;
+		records[i].offset = offset;
+
+		const size_t pad = _alignMappedTable(size, 8) - size;
+		if (fwrite(buffer, 1, size, file) != size
+		    || fwrite(padding, 1, pad, file) != pad)
+			ret = -1;
+
+		offset += size + pad;
+	}
+
+	const struct MappedTableLayout layout = _layoutMappedTable(count, nBuckets, offset);
+
+	if (ret == 0) {
+		const size_t bucketsPad = layout.records - layout.buckets
+			- (nBuckets + 1) * sizeof(uint64_t);
+		const size_t recordsPad = layout.data - layout.records
+			- count * sizeof(MappedTableRecord);
+
+		ret = (fseek(file, layout.buckets, SEEK_SET) == 0
+		       && fwrite(buckets, sizeof(uint64_t), nBuckets + 1, file) == nBuckets + 1
+		       && fwrite(padding, 1, bucketsPad, file) == bucketsPad
+		       && fwrite(records, sizeof(MappedTableRecord), count, file) == count
+		       && fwrite(padding, 1, recordsPad, file) == recordsPad
+		       && fflush(file) == 0) ? 0 : -1;
+	}
+
+	// Checksum what was written.
+	uint64_t checksum = 0;
+
+	if (ret == 0) {
+		unsigned char *map = mmap(NULL, layout.fileSize, PROT_READ, MAP_SHARED, fd, 0);
+
+		if (map != MAP_FAILED) {
+			checksum = _checksumMappedTable(map + layout.buckets,
+			                                layout.fileSize - layout.buckets);
+			munmap(map, layout.fileSize);
+		} else {
+			ret = -1;
+		}
+	}
+
+	if (ret == 0) {
+		struct MappedTableHeader header = {
+			.magic = MAPPED_TABLE_MAGIC,
+			.version = MAPPED_TABLE_VERSION,
+			.type = type,
+			.entries = count,
+			.nBuckets = nBuckets,
+			.dataSize = offset,
+			.fileSize = layout.fileSize,
+			.checksum = checksum
+		};
+
+		ret = (fseek(file, 0, SEEK_SET) == 0
+		       && fwrite(&header, sizeof(header), 1, file) == 1) ? 0 : -1;
+	}
+
+	free(buffer);
+	free(records);
+
+	if (fclose(file) != 0)
+		ret = -1;
+
+	if (ret == 0 && rename(tmpname, filename) != 0)
+		ret = -1;
+
+	if (ret != 0)
+		unlink(tmpname);
+
+	free(tmpname);
+	return ret;
+}
+
+static void _collectBucketsMappedTable(
+	struct MappedTableCollect *collect, DoubleLinkedList *table, size_t N
+) {
+	for (size_t i = 0; i < N; ++i) {
+		for (LinkedListNode *it = table[i].list; it != NULL; it = it->next) {
+			collect->entries[collect->count].key = it->key;
+			collect->entries[collect->count].value = it->value;
+			collect->count++;
+		}
+	}
+}
+
+int dumpMappedHashTable(
+	HashTable *in, const char *filename,
+	size_t (*serialize)(const void *value, void *buffer, size_t size, void *arg),
+	void *arg
+) {
+	assert(serialize != NULL);
+
+	// The records only have the inline key, that may repeat.
+	if (in->bytesKeys)
+		return -1;
+
+	const size_t n = in->entries;
+	const size_t nBuckets = in->N;
+
+	struct MappedTableCollect collect = {
+		.entries = malloc(n * sizeof(struct MappedTableEntry) + 1),
+		.count = 0
+	};
+	assert(collect.entries != NULL);
+
+	_collectBucketsMappedTable(&collect, in->table, in->N);
+	if (in->oldTable != NULL)
+		_collectBucketsMappedTable(&collect, in->oldTable, in->oldN);
+	assert(collect.count == n);
+
+	// Group the entries by bucket (counting sort).
+	uint64_t *buckets = calloc(nBuckets + 1, sizeof(uint64_t));
+	uint64_t *cursor = malloc(nBuckets * sizeof(uint64_t));
+	struct MappedTableEntry *sorted = malloc(n * sizeof(struct MappedTableEntry) + 1);
+	assert(buckets != NULL && cursor != NULL && sorted != NULL);
+
+	for (size_t i = 0; i < n; ++i)
+		buckets[(size_t) collect.entries[i].key % nBuckets + 1]++;
+
+	for (size_t b = 0; b < nBuckets; ++b) {
+		buckets[b + 1] += buckets[b];
+		cursor[b] = buckets[b];
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		const size_t bucket = (size_t) collect.entries[i].key % nBuckets;
+		sorted[cursor[bucket]++] = collect.entries[i];
+	}
+
+	free(cursor);
+
+	const int ret = _writeMappedTable(filename, MAPPED_TABLE_HASH, sorted, n,
+	                                  buckets, nBuckets, serialize, arg);
+
+	free(sorted);
+	free(buckets);
+	free(collect.entries);
+
+	return ret;
+}
+
+static void _collectNodeMappedTable(BinaryTreeNode *node, void *arg)
+{
+	struct MappedTableCollect *collect = arg;
+
+	collect->entries[collect->count].key = node->key;
+	collect->entries[collect->count].value = node->value;
+	collect->count++;
+}
+
+int dumpMappedBinaryTree(
+	BinaryTree *in, const char *filename,
+	size_t (*serialize)(const void *value, void *buffer, size_t size, void *arg),
+	void *arg
+) {
+	assert(serialize != NULL);
+
+	// The inline keys of the byte string keys are not in order.
+	if (in->bytesKeys)
+		return -1;
+
+	struct MappedTableCollect collect = {
+		.entries = malloc(in->entries * sizeof(struct MappedTableEntry) + 1),
+		.count = 0
+	};
+	assert(collect.entries != NULL);
+
+	// In order, so the records are sorted by key.
+	dsfBinaryTree(in, _collectNodeMappedTable, &collect);
+	assert(collect.count == in->entries);
+
+	const uint64_t buckets[1] = {0};
+
+	const int ret = _writeMappedTable(filename, MAPPED_TABLE_TREE,
+	                                  collect.entries, collect.count,
+	                                  buckets, 0, serialize, arg);
+
+	free(collect.entries);
+
+	return ret;
+}
+
+// Open ========================================================================
+
+int openMappedTable(MappedTable *out, const char *filename, int verify)
+{
+	const int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(struct MappedTableHeader)) {
+		close(fd);
+		return -1;
+	}
+
+	// Shared, so all the processes using the file share the page cache.
+	const size_t fileSize = st.st_size;
+	unsigned char *map = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return -1;
+
+	struct MappedTableHeader header;
+	memcpy(&header, map, sizeof(header));
+
+	const struct MappedTableLayout layout = _layoutMappedTable(
+		header.entries, header.nBuckets, header.dataSize
+	);
+
+	if (memcmp(header.magic, MAPPED_TABLE_MAGIC, sizeof(header.magic)) != 0
+	    || header.version != MAPPED_TABLE_VERSION
+	    || (header.type != MAPPED_TABLE_HASH && header.type != MAPPED_TABLE_TREE)
+	    || (header.type == MAPPED_TABLE_HASH && header.nBuckets == 0)
+	    || header.entries > fileSize / sizeof(MappedTableRecord)
+	    || header.nBuckets > fileSize / sizeof(uint64_t)
+	    || header.fileSize != fileSize
+	    || layout.fileSize != fileSize) {
+		munmap(map, fileSize);
+		return -1;
+	}
+
+	out->type = header.type;
+	out->entries = header.entries;
+	out->nBuckets = header.nBuckets;
+	out->buckets = (const uint64_t *) (map + layout.buckets);
+	out->records = (const MappedTableRecord *) (map + layout.records);
+	out->data = map + layout.data;
+	out->dataSize = header.dataSize;
+	out->map = map;
+	out->mapSize = fileSize;
+
+	if (verify && !verifyMappedTable(out)) {
+		freeMappedTable(out);
+		return -1;
+	}
+
+	return 0;
+}
+
+void freeMappedTable(MappedTable *out)
+{
+	if (out->map != NULL)
+		munmap(out->map, out->mapSize);
+
+	out->map = NULL;
+	out->mapSize = 0;
+	out->entries = 0;
+}
+
+// The images are not verified on open, so every record is checked before its
+// value is used.
+static inline int _validRecordMappedTable(
+	const MappedTable *in, const MappedTableRecord *record
+) {
+	return record->offset <= in->dataSize
+		&& record->size <= in->dataSize - record->offset;
+}
+
+int verifyMappedTable(const MappedTable *in)
+{
+	struct MappedTableHeader header;
+	memcpy(&header, in->map, sizeof(header));
+
+	const unsigned char *map = in->map;
+	const size_t start = sizeof(header);
+
+	if (_checksumMappedTable(map + start, in->mapSize - start) != header.checksum)
+		return 0;
+
+	// A valid checksum of a malicious file is still possible, so check that
+	// all the references are in range.
+	if (in->type == MAPPED_TABLE_HASH) {
+		if (in->buckets[0] != 0 || in->buckets[in->nBuckets] != in->entries)
+			return 0;
+
+		for (size_t b = 0; b < in->nBuckets; ++b)
+			if (in->buckets[b] > in->buckets[b + 1])
+				return 0;
+	}
+
+	for (size_t i = 0; i < in->entries; ++i) {
+		const MappedTableRecord *record = &in->records[i];
+
+		if (!_validRecordMappedTable(in, record))
+			return 0;
+
+		if (in->type == MAPPED_TABLE_TREE && i > 0 && in->records[i - 1].key >= record->key)
+			return 0;
+	}
+
+	return 1;
+}
+
+// Lookup ======================================================================
+
+const void *getKeyMappedTable(const MappedTable *in, int key, size_t *size)
+{
+	const MappedTableRecord *record = NULL;
+
+	if (in->type == MAPPED_TABLE_HASH) {
+		const size_t bucket = (size_t) key % in->nBuckets;
+		const uint64_t first = in->buckets[bucket];
+		const uint64_t last = in->buckets[bucket + 1];
+
+		if (first > last || last > in->entries)
+			return NULL;
+
+		for (uint64_t i = first; i < last; ++i) {
+			if (in->records[i].key == key) {
+				record = &in->records[i];
+				break;
+			}
+		}
+	} else {
+		size_t first = 0, last = in->entries;
+
+		while (first < last) {
+			const size_t middle = first + (last - first) / 2;
+
+			if (in->records[middle].key < key) {
+				first = middle + 1;
+			} else if (in->records[middle].key > key) {
+				last = middle;
+			} else {
+				record = &in->records[middle];
+				break;
+			}
+		}
+	}
+
+	if (record == NULL || !_validRecordMappedTable(in, record))
+		return NULL;
+
+	if (size != NULL)
+		*size = record->size;
+
+	return in->data + record->offset;
+}
+
+// Thaw ========================================================================
+
+static void *_copyValueMappedTable(
+	const MappedTable *in, const MappedTableRecord *record,
+	void *(*deserialize)(const void *buffer, size_t size, void *arg),
+	void *arg
+) {
+	const void *buffer = in->data + record->offset;
+
+	if (deserialize != NULL)
+		return deserialize(buffer, record->size, arg);
+
+	void *value = malloc(record->size + 1);
+	assert(value != NULL);
+	memcpy(value, buffer, record->size);
+
+	return value;
+}
+
+void thawMappedHashTable(
+	const MappedTable *in, HashTable *out,
+	void *(*deserialize)(const void *buffer, size_t size, void *arg),
+	void *arg
+) {
+	for (size_t i = 0; i < in->entries; ++i) {
+		const MappedTableRecord *record = &in->records[i];
+		if (_validRecordMappedTable(in, record))
+			insertKeyHashTable(out, record->key,
+			                   _copyValueMappedTable(in, record, deserialize, arg));
+	}
+}
+
+static int _compareRecordsMappedTable(const void *a, const void *b)
+{
+	const MappedTableRecord *first = *(const MappedTableRecord * const *) a;
+	const MappedTableRecord *second = *(const MappedTableRecord * const *) b;
+
+	return (first->key > second->key) - (first->key < second->key);
+}
+
+// Insert the middle record before the two halves, so the tree is balanced.
+static void _thawRangeMappedTable(
+	const MappedTable *in, BinaryTree *out,
+	const MappedTableRecord **sorted, size_t first, size_t last,
+	void *(*deserialize)(const void *buffer, size_t size, void *arg),
+	void *arg
+) {
+	if (first >= last)
+		return;
+
+	const size_t middle = first + (last - first) / 2;
+	insertBinaryTree(out, sorted[middle]->key,
+	                 _copyValueMappedTable(in, sorted[middle], deserialize, arg));
+
+	_thawRangeMappedTable(in, out, sorted, first, middle, deserialize, arg);
+	_thawRangeMappedTable(in, out, sorted, middle + 1, last, deserialize, arg);
+}
+
+void thawMappedBinaryTree(
+	const MappedTable *in, BinaryTree *out,
+	void *(*deserialize)(const void *buffer, size_t size, void *arg),
+	void *arg
+) {
+	const MappedTableRecord **sorted = malloc(in->entries * sizeof(MappedTableRecord *) + 1);
+	assert(sorted != NULL);
+
+	size_t n = 0;
+	for (size_t i = 0; i < in->entries; ++i)
+		if (_validRecordMappedTable(in, &in->records[i]))
+			sorted[n++] = &in->records[i];
+
+	// The tree images are sorted already.
+	if (in->type == MAPPED_TABLE_HASH)
+		qsort(sorted, n, sizeof(MappedTableRecord *), _compareRecordsMappedTable);
+
+	_thawRangeMappedTable(in, out, sorted, 0, n, deserialize, arg);
+
+	free(sorted);
+}
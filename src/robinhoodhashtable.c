@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Slots =======================================================================
+
+static inline size_t _homeRobinHoodHashTable(const RobinHoodHashTable *in, int key)
+{
+	// Linear probing needs the consecutive keys scattered.
+	const uint64_t mixed = (uint64_t)(uint32_t) key * 0x9E3779B97F4A7C15ull;
+	return (size_t)(mixed >> 32) & (in->N - 1);
+}
+
+static inline size_t _nextRobinHoodHashTable(const RobinHoodHashTable *in, size_t index)
+{
+	return (index + 1) & (in->N - 1);
+}
+
+// Index of the key slot or -1.
+static ssize_t _findRobinHoodHashTable(const RobinHoodHashTable *in, int key)
+{
+	size_t index = _homeRobinHoodHashTable(in, key);
+
+	for (uint32_t distance = 1; ; ++distance) {
+		const RobinHoodHashTableSlot *slot = &in->table[index];
+
+		// Empty slot or a richer key: the key would have been here.
+		if (slot->distance < distance)
+			return -1;
+
+		if (slot->key == key)
+			return index;
+
+		index = _nextRobinHoodHashTable(in, index);
+	}
+}
+
+// Insert a key known to be missing, returns its slot.
+static RobinHoodHashTableSlot *_insertNewRobinHoodHashTable(
+	RobinHoodHashTable *out, int key, void *value
+) {
+	RobinHoodHashTableSlot carry = {key, 1, value};
+	RobinHoodHashTableSlot *result = NULL;
+
+	size_t index = _homeRobinHoodHashTable(out, key);
+
+	for (;;) {
+		RobinHoodHashTableSlot *slot = &out->table[index];
+
+		if (slot->distance == 0) {
+			*slot = carry;
+			break;
+		}
+
+		// Take the place of the richer keys and carry them forward.
+		if (slot->distance < carry.distance) {
+			const RobinHoodHashTableSlot tmp = *slot;
+			*slot = carry;
+			carry = tmp;
+
+			if (result == NULL)
+				result = slot;
+		}
+
+		++carry.distance;
+		index = _nextRobinHoodHashTable(out, index);
+	}
+
+	out->entries++;
+	return result != NULL ? result : &out->table[index];
+}
+
+static void _resizeRobinHoodHashTable(RobinHoodHashTable *out, size_t N)
+{
+	RobinHoodHashTableSlot *old = out->table;
+	const size_t oldN = out->N;
+
+	out->table = calloc(N, sizeof(RobinHoodHashTableSlot));
+	assert(out->table != NULL);
+	out->N = N;
+	out->entries = 0;
+
+	for (size_t i = 0; i < oldN; ++i)
+		if (old[i].distance != 0)
+			_insertNewRobinHoodHashTable(out, old[i].key, old[i].value);
+
+	free(old);
+}
+
+// Robin Hood Hash Table =======================================================
+
+void allocInitRobinHoodHashTable(RobinHoodHashTable *out, size_t N)
+{
+	size_t size = 2;
+	while (size * 9 < N * 10)
+		size *= 2;
+
+	out->entries = 0;
+	out->N = size;
+	out->table = calloc(size, sizeof(RobinHoodHashTableSlot));
+	assert(out->table != NULL);
+}
+
+void freeRobinHoodHashTable(RobinHoodHashTable *out)
+{
+	for (size_t i = 0; i < out->N; ++i)
+		if (out->table[i].distance != 0)
+			free(out->table[i].value);
+
+	free(out->table);
+	out->table = NULL;
+	out->N = 0;
+	out->entries = 0;
+}
+
+void **insertKeyRobinHoodHashTable(RobinHoodHashTable *out, int key, void *value)
+{
+	const ssize_t index = _findRobinHoodHashTable(out, key);
+
+	if (index >= 0) {
+		// Key exist, so update value only
+		free(out->table[index].value);
+		out->table[index].value = value;
+		return &out->table[index].value;
+	}
+
+	if ((out->entries + 1) * 10 > out->N * 9)
+		_resizeRobinHoodHashTable(out, 2 * out->N);
+
+	return &_insertNewRobinHoodHashTable(out, key, value)->value;
+}
+
+void **getKeyRobinHoodHashTable(RobinHoodHashTable *in, int key)
+{
+	const ssize_t index = _findRobinHoodHashTable(in, key);
+
+	return index >= 0 ? &in->table[index].value : NULL;
+}
+
+int popKeyRobinHoodHashTable(RobinHoodHashTable *out, int key)
+{
+	ssize_t index = _findRobinHoodHashTable(out, key);
+
+	if (index < 0)
+		return 0;
+
+	free(out->table[index].value);
+
+	// Shift back the following keys until an empty slot or a key in its home.
+	size_t next = _nextRobinHoodHashTable(out, index);
+
+	while (out->table[next].distance > 1) {
+		out->table[index] = out->table[next];
+		out->table[index].distance--;
+
+		index = next;
+		next = _nextRobinHoodHashTable(out, next);
+	}
+
+	out->table[index] = (RobinHoodHashTableSlot) {0, 0, NULL};
+	out->entries--;
+
+	return 1;
+}
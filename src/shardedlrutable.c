@@ -0,0 +1,568 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Shards ======================================================================
+
+ShardedlruTableShard *_getShardShardedlruTable(ShardedlruTable *in, int key)
+{
+	// The shard index must not correlate with the bucket index inside the
+	// shard (key % N), so the key is mixed with a multiplicative hash first.
+	const uint64_t mixed = (uint64_t)(uint32_t) key * 0x9E3779B97F4A7C15ull;
+	const size_t shard = (size_t)(mixed >> 32) % in->nShards;
+
+	return &in->shards[shard];
+}
+
+void allocInitShardedlruTable(ShardedlruTable *out, size_t nShards, size_t N)
+{
+	assert(nShards > 0);
+	assert(N >= nShards);
+
+	out->maxEntries = N;
+	out->nShards = nShards;
+
+	void *shards = NULL;
+	int ret = posix_memalign(&shards, 64, nShards * sizeof(ShardedlruTableShard));
+	assert(ret == 0);
+	(void) ret;
+
+	out->shards = shards;
+	out->maintenance = NULL;
+
+	for (size_t i = 0; i < nShards; ++i) {
+		// The first N % nShards shards get one extra entry.
+		const size_t capacity = N / nShards + (i < N % nShards);
+
+		allocInitlruTable((lruTable *) &out->shards[i], capacity);
+		pthread_mutex_init(&out->shards[i].lock, NULL);
+		pthread_cond_init(&out->shards[i].loaded, NULL);
+		out->shards[i].loads = NULL;
+		out->shards[i].asyncLoads = 0;
+
+		out->shards[i].highWater = SIZE_MAX;
+		out->shards[i].garbage = NULL;
+		out->shards[i].nGarbage = 0;
+		out->shards[i].maxGarbage = 0;
+	}
+}
+
+void freeShardedlruTable(ShardedlruTable *out)
+{
+	// The async loaders insert in the shards, wait for them first.
+	for (size_t i = 0; i < out->nShards; ++i) {
+		ShardedlruTableShard *shard = &out->shards[i];
+
+		pthread_mutex_lock(&shard->lock);
+		while (shard->asyncLoads > 0)
+			pthread_cond_wait(&shard->loaded, &shard->lock);
+		pthread_mutex_unlock(&shard->lock);
+	}
+
+	if (out->maintenance != NULL)
+		stopMaintenanceShardedlruTable(out);
+
+	for (size_t i = 0; i < out->nShards; ++i) {
+		assert(out->shards[i].loads == NULL);
+		freelruTable((lruTable *) &out->shards[i]);
+		pthread_mutex_destroy(&out->shards[i].lock);
+		pthread_cond_destroy(&out->shards[i].loaded);
+	}
+
+	free(out->shards);
+	out->shards = NULL;
+	out->nShards = 0;
+	out->maxEntries = 0;
+}
+
+void setValueOpsShardedlruTable(ShardedlruTable *out, const ValueOps *ops)
+{
+	for (size_t i = 0; i < out->nShards; ++i)
+		setValueOpslruTable((lruTable *) &out->shards[i], ops);
+}
+
+void insertKeyShardedlruTable(ShardedlruTable *out, int key, void *value)
+{
+	ShardedlruTableShard *shard = _getShardShardedlruTable(out, key);
+
+	pthread_mutex_lock(&shard->lock);
+	_deferReplacedShardedlruTable(shard, key);
+	insertKeylruTable((lruTable *) shard, key, value);
+	const int wakeup = shard->entries > shard->highWater;
+	pthread_mutex_unlock(&shard->lock);
+
+	if (wakeup)
+		_wakeupMaintenanceShardedlruTable(out);
+}
+
+int getKeyShardedlruTable(
+	ShardedlruTable *in, int key,
+	void (*func)(struct lruTableNode *, void *),
+	void *arg
+) {
+	ShardedlruTableShard *shard = _getShardShardedlruTable(in, key);
+
+	pthread_mutex_lock(&shard->lock);
+
+	lruTableNode *node = getKeylruTable((lruTable *) shard, key);
+
+	if (node != NULL && func != NULL)
+		func(node, arg);
+
+	pthread_mutex_unlock(&shard->lock);
+
+	return node != NULL;
+}
+
+void getStatsShardedlruTable(ShardedlruTable *in, lruTableStats *out)
+{
+	*out = (lruTableStats) {0};
+
+	for (size_t i = 0; i < in->nShards; ++i) {
+		lruTableStats shard;
+		getStatslruTable((lruTable *) &in->shards[i], &shard);
+
+		out->hits += shard.hits;
+		out->misses += shard.misses;
+		out->inserts += shard.inserts;
+		out->updates += shard.updates;
+		out->evictions += shard.evictions;
+		out->expirations += shard.expirations;
+		out->rejections += shard.rejections;
+		out->removals += shard.removals;
+	}
+}
+
+// Maintenance =================================================================
+
+// Nodes evicted per lock acquisition, so the callers don't wait too long.
+#define SHARDED_LRU_TABLE_MAINTENANCE_BATCH 32
+
+// Maximum time the maintenance thread sleeps without checking the shards.
+#define SHARDED_LRU_TABLE_MAINTENANCE_PERIOD_NS 10000000
+
+void _wakeupMaintenanceShardedlruTable(ShardedlruTable *in)
+{
+	struct ShardedlruTableMaintenance *maintenance = in->maintenance;
+
+	pthread_mutex_lock(&maintenance->lock);
+	if (!maintenance->pending) {
+		maintenance->pending = 1;
+		pthread_cond_signal(&maintenance->wakeup);
+	}
+	pthread_mutex_unlock(&maintenance->lock);
+}
+
+static void _reserveGarbageShardedlruTable(ShardedlruTableShard *shard, size_t n)
+{
+	if (shard->nGarbage + n > shard->maxGarbage) {
+		shard->maxGarbage = 2 * (shard->nGarbage + n);
+		shard->garbage = realloc(shard->garbage, shard->maxGarbage * sizeof(void *));
+		assert(shard->garbage != NULL);
+	}
+}
+
+// Batched eviction callback, called with the shard lock held.
+static void _deferValuesShardedlruTable(
+	const lruTableVictim *victims, size_t n, void *arg
+) {
+	ShardedlruTableShard *shard = arg;
+
+	_reserveGarbageShardedlruTable(shard, n);
+
+	for (size_t i = 0; i < n; ++i)
+		shard->garbage[shard->nGarbage++] = victims[i].value;
+}
+
+// With maintenance the value replaced by an insertion goes to the garbage too,
+// called with the shard lock held before the insertion.
+void _deferReplacedShardedlruTable(ShardedlruTableShard *shard, int key)
+{
+	if (shard->evictBatchFunc != _deferValuesShardedlruTable)
+		return;
+
+	lruTableNode *node = (lruTableNode *) getKeyHashTable((HashTable *) shard, key);
+	if (node == NULL || node->value == NULL)
+		return;
+
+	_reserveGarbageShardedlruTable(shard, 1);
+	shard->garbage[shard->nGarbage++] = node->value;
+	node->value = NULL;
+}
+
+static void _maintainShardShardedlruTable(
+	ShardedlruTableShard *shard, size_t lowPercent,
+	void ***release, size_t *maxRelease
+) {
+	const size_t lowWater = shard->maxEntries * lowPercent / 100;
+
+	pthread_mutex_lock(&shard->lock);
+
+	if (shard->entries > shard->highWater) {
+		// Release the lock between batches to let the callers progress.
+		while (shard->entries > lowWater) {
+			size_t n = shard->entries - lowWater;
+			if (n > SHARDED_LRU_TABLE_MAINTENANCE_BATCH)
+				n = SHARDED_LRU_TABLE_MAINTENANCE_BATCH;
+
+			evictlruTable((lruTable *) shard, n);
+
+			pthread_mutex_unlock(&shard->lock);
+			pthread_mutex_lock(&shard->lock);
+		}
+	}
+
+	// Take the values evicted here and by the callers, swapping the buffers
+	// keeps both allocated.
+	flushEvictionslruTable((lruTable *) shard);
+
+	void **garbage = shard->garbage;
+	const size_t nGarbage = shard->nGarbage;
+	const size_t maxGarbage = shard->maxGarbage;
+
+	shard->garbage = *release;
+	shard->maxGarbage = *maxRelease;
+	shard->nGarbage = 0;
+
+	pthread_mutex_unlock(&shard->lock);
+
+	for (size_t i = 0; i < nGarbage; ++i)
+		_destroyValue(shard->ops, garbage[i]);
+
+	*release = garbage;
+	*maxRelease = maxGarbage;
+}
+
+static void *_maintenanceShardedlruTable(void *arg)
+{
+	ShardedlruTable *table = arg;
+	struct ShardedlruTableMaintenance *maintenance = table->maintenance;
+
+	void **release = NULL;
+	size_t maxRelease = 0;
+
+	pthread_mutex_lock(&maintenance->lock);
+
+	while (maintenance->running) {
+		if (!maintenance->pending) {
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += SHARDED_LRU_TABLE_MAINTENANCE_PERIOD_NS;
+			if (deadline.tv_nsec >= 1000000000) {
+				deadline.tv_nsec -= 1000000000;
+				++deadline.tv_sec;
+			}
+			pthread_cond_timedwait(&maintenance->wakeup, &maintenance->lock, &deadline);
+		}
+		maintenance->pending = 0;
+		pthread_mutex_unlock(&maintenance->lock);
+
+		for (size_t i = 0; i < table->nShards; ++i)
+			_maintainShardShardedlruTable(
+				&table->shards[i], maintenance->lowPercent, &release, &maxRelease
+			);
+
+		pthread_mutex_lock(&maintenance->lock);
+	}
+
+	pthread_mutex_unlock(&maintenance->lock);
+
+	free(release);
+	return NULL;
+}
+
+void startMaintenanceShardedlruTable(
+	ShardedlruTable *out, size_t highPercent, size_t lowPercent
+) {
+	assert(out->maintenance == NULL);
+	assert(lowPercent < highPercent);
+	assert(highPercent <= 100);
+
+	struct ShardedlruTableMaintenance *maintenance =
+		malloc(sizeof(struct ShardedlruTableMaintenance));
+	assert(maintenance != NULL);
+
+	pthread_mutex_init(&maintenance->lock, NULL);
+	pthread_cond_init(&maintenance->wakeup, NULL);
+	maintenance->running = 1;
+	maintenance->pending = 0;
+	maintenance->lowPercent = lowPercent;
+
+	// Published before the shards are configured: the callers only wake the
+	// thread up after seeing the new highWater under the shard lock.
+	out->maintenance = maintenance;
+
+	for (size_t i = 0; i < out->nShards; ++i) {
+		ShardedlruTableShard *shard = &out->shards[i];
+
+		pthread_mutex_lock(&shard->lock);
+		shard->highWater = shard->maxEntries * highPercent / 100;
+		setBatchEvictionCallbacklruTable(
+			(lruTable *) shard, _deferValuesShardedlruTable,
+			SHARDED_LRU_TABLE_MAINTENANCE_BATCH, shard
+		);
+		pthread_mutex_unlock(&shard->lock);
+	}
+
+	int ret = pthread_create(
+		&maintenance->thread, NULL, _maintenanceShardedlruTable, out
+	);
+	assert(ret == 0);
+	(void) ret;
+}
+
+void stopMaintenanceShardedlruTable(ShardedlruTable *out)
+{
+	struct ShardedlruTableMaintenance *maintenance = out->maintenance;
+	assert(maintenance != NULL);
+
+	pthread_mutex_lock(&maintenance->lock);
+	maintenance->running = 0;
+	pthread_cond_signal(&maintenance->wakeup);
+	pthread_mutex_unlock(&maintenance->lock);
+
+	pthread_join(maintenance->thread, NULL);
+
+	for (size_t i = 0; i < out->nShards; ++i) {
+		ShardedlruTableShard *shard = &out->shards[i];
+
+		pthread_mutex_lock(&shard->lock);
+
+		// This flushes the pending victims into the garbage.
+		setEvictionCallbacklruTable((lruTable *) shard, NULL, NULL);
+		shard->highWater = SIZE_MAX;
+
+		void **garbage = shard->garbage;
+		const size_t nGarbage = shard->nGarbage;
+		shard->garbage = NULL;
+		shard->nGarbage = 0;
+		shard->maxGarbage = 0;
+
+		pthread_mutex_unlock(&shard->lock);
+
+		for (size_t j = 0; j < nGarbage; ++j)
+			_destroyValue(shard->ops, garbage[j]);
+
+		free(garbage);
+	}
+
+	pthread_mutex_destroy(&maintenance->lock);
+	pthread_cond_destroy(&maintenance->wakeup);
+	free(maintenance);
+	out->maintenance = NULL;
+}
+
+// Loads =======================================================================
+
+static struct ShardedlruTableLoad *_findLoadShardedlruTable(
+	ShardedlruTableShard *shard, int key
+) {
+	struct ShardedlruTableLoad *load = shard->loads;
+
+	while (load != NULL && load->key != key)
+		load = load->next;
+
+	return load;
+}
+
+static struct ShardedlruTableLoad *_startLoadShardedlruTable(
+	ShardedlruTableShard *shard, int key,
+	void *(*loader)(int key, void *ctx),
+	void *ctx,
+	struct ShardedlruTableWaiter *waiter
+) {
+	struct ShardedlruTableLoad *load = malloc(sizeof(struct ShardedlruTableLoad));
+	assert(load != NULL);
+
+	load->key = key;
+	load->loader = loader;
+	load->ctx = ctx;
+	load->shard = shard;
+	load->waiters = waiter;
+	load->next = shard->loads;
+	shard->loads = load;
+
+	return load;
+}
+
+// Call the loader out of the lock and wake all the waiters with the result.
+static void _runLoadShardedlruTable(struct ShardedlruTableLoad *load)
+{
+	void *value = load->loader(load->key, load->ctx);
+
+	ShardedlruTableShard *shard = load->shard;
+	pthread_mutex_lock(&shard->lock);
+
+	lruTableNode *node = NULL;
+	if (value != NULL) {
+		_deferReplacedShardedlruTable(shard, load->key);
+		node = insertKeylruTable((lruTable *) shard, load->key, value);
+	}
+
+	struct ShardedlruTableLoad **it = &shard->loads;
+	while (*it != load)
+		it = &(*it)->next;
+	*it = load->next;
+
+	struct ShardedlruTableWaiter *waiter = load->waiters;
+	while (waiter != NULL) {
+		// Sync waiters live in their own stack, don't touch them after done.
+		struct ShardedlruTableWaiter *next = waiter->next;
+
+		if (waiter->func != NULL && (node != NULL || waiter->async))
+			waiter->func(node, waiter->arg);
+
+		if (waiter->async) {
+			free(waiter);
+		} else {
+			waiter->found = (node != NULL);
+			waiter->done = 1;
+		}
+		waiter = next;
+	}
+
+	pthread_cond_broadcast(&shard->loaded);
+	pthread_mutex_unlock(&shard->lock);
+
+	// A rejected value is still ours, it is released out of the lock.
+	if (value != NULL && node == NULL)
+		_destroyValue(shard->ops, value);
+
+	free(load);
+}
+
+static void *_asyncLoadShardedlruTable(void *arg)
+{
+	struct ShardedlruTableLoad *load = arg;
+	ShardedlruTableShard *shard = load->shard;
+
+	_runLoadShardedlruTable(load);
+
+	// The shard must not be used after this, it may be released already.
+	pthread_mutex_lock(&shard->lock);
+	if (--shard->asyncLoads == 0)
+		pthread_cond_broadcast(&shard->loaded);
+	pthread_mutex_unlock(&shard->lock);
+
+	return NULL;
+}
+
+int getOrLoadShardedlruTable(
+	ShardedlruTable *in, int key,
+	void *(*loader)(int key, void *ctx),
+	void *ctx,
+	void (*func)(struct lruTableNode *, void *),
+	void *arg
+) {
+	ShardedlruTableShard *shard = _getShardShardedlruTable(in, key);
+
+	pthread_mutex_lock(&shard->lock);
+
+	lruTableNode *node = getKeylruTable((lruTable *) shard, key);
+	if (node != NULL) {
+		if (func != NULL)
+			func(node, arg);
+
+		pthread_mutex_unlock(&shard->lock);
+		return 1;
+	}
+
+	struct ShardedlruTableWaiter waiter = {
+		.func = func, .arg = arg, .async = 0, .done = 0, .found = 0, .next = NULL
+	};
+
+	struct ShardedlruTableLoad *load = _findLoadShardedlruTable(shard, key);
+
+	if (load == NULL) {
+		load = _startLoadShardedlruTable(shard, key, loader, ctx, &waiter);
+		pthread_mutex_unlock(&shard->lock);
+
+		_runLoadShardedlruTable(load);
+		assert(waiter.done);
+		return waiter.found;
+	}
+
+	// Somebody else is loading the key: park until it finishes.
+	waiter.next = load->waiters;
+	load->waiters = &waiter;
+
+	while (!waiter.done)
+		pthread_cond_wait(&shard->loaded, &shard->lock);
+
+	pthread_mutex_unlock(&shard->lock);
+
+	return waiter.found;
+}
+
+void getOrLoadAsyncShardedlruTable(
+	ShardedlruTable *in, int key,
+	void *(*loader)(int key, void *ctx),
+	void *ctx,
+	void (*complete)(struct lruTableNode *, void *),
+	void *arg
+) {
+	assert(complete != NULL);
+	ShardedlruTableShard *shard = _getShardShardedlruTable(in, key);
+
+	pthread_mutex_lock(&shard->lock);
+
+	lruTableNode *node = getKeylruTable((lruTable *) shard, key);
+	if (node != NULL) {
+		complete(node, arg);
+		pthread_mutex_unlock(&shard->lock);
+		return;
+	}
+
+	struct ShardedlruTableWaiter *waiter = malloc(sizeof(struct ShardedlruTableWaiter));
+	assert(waiter != NULL);
+	*waiter = (struct ShardedlruTableWaiter) {
+		.func = complete, .arg = arg, .async = 1, .done = 0, .found = 0, .next = NULL
+	};
+
+	struct ShardedlruTableLoad *load = _findLoadShardedlruTable(shard, key);
+
+	if (load != NULL) {
+		waiter->next = load->waiters;
+		load->waiters = waiter;
+		pthread_mutex_unlock(&shard->lock);
+		return;
+	}
+
+	load = _startLoadShardedlruTable(shard, key, loader, ctx, waiter);
+	shard->asyncLoads++;
+	pthread_mutex_unlock(&shard->lock);
+
+	pthread_t thread;
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	int ret = pthread_create(&thread, &attr, _asyncLoadShardedlruTable, load);
+	assert(ret == 0);
+	(void) ret;
+
+	pthread_attr_destroy(&attr);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include "c-container.h"
+#include "c-container-internal.h"
+
+// Value Ownership =============================================================
+
+const ValueOps ownedValueOps = {free, NULL};
+
+const ValueOps borrowedValueOps = {NULL, NULL};
+
+void *_cloneValue(const ValueOps *ops, void *value)
+{
+	assert(ops != NULL);
+	return (ops->clone != NULL && value != NULL) ? ops->clone(value) : value;
+}
+
+void _destroyValue(const ValueOps *ops, void *value)
+{
+	assert(ops != NULL);
+	if (ops->destroy != NULL && value != NULL)
+		ops->destroy(value);
+}
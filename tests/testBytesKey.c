@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include <string.h>
+#include <unistd.h>
+#include "c-container.h"
+
+#define NENTRIES 1000
+
+int *newInt(int value)
+{
+	int *ret = malloc(sizeof(int));
+	*ret = value;
+	return ret;
+}
+
+// Keys of different lengths, some of them longer than a cache line.
+size_t makeKey(char *buffer, int i)
+{
+	int length = sprintf(buffer, "key-%d-", i);
+	for (int j = 0; j < i % 97; ++j)
+		buffer[length++] = 'a' + (j % 26);
+	buffer[length] = '\0';
+	return length;
+}
+
+void testHash()
+{
+	char a[] = "some bytes", b[] = "some bytes";
+	assert(hashBytesKey(a, sizeof(a)) == hashBytesKey(b, sizeof(b)));
+	assert(hashBytesKey(a, 4) != hashBytesKey(a, 5));
+
+	// The length is part of the key, the zeroes too.
+	const char zeroes[3] = {0, 0, 0};
+	assert(hashBytesKey(zeroes, 2) != hashBytesKey(zeroes, 3));
+}
+
+void testHashTable()
+{
+	HashTable table;
+	allocInitHashTable(&table, 8);
+
+	char buffer[256];
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		const size_t length = makeKey(buffer, i);
+		HashTableNode *node = insertBytesKeyHashTable(&table, buffer, length, newInt(i));
+		assert(node != NULL);
+
+		const BytesKey *key = getBytesKeyHashTableNode(node);
+		assert(key->length == length);
+		assert(memcmp(key->bytes, buffer, length) == 0);
+		assert(key->hash == hashBytesKey(buffer, length));
+	}
+	assert(table.entries == NENTRIES);
+
+	// Update the value
+	const size_t length = makeKey(buffer, 10);
+	insertBytesKeyHashTable(&table, buffer, length, newInt(-10));
+	assert(table.entries == NENTRIES);
+	assert(*(int *)getBytesKeyHashTable(&table, buffer, length)->value == -10);
+
+	// Prefixes are different keys
+	assert(getBytesKeyHashTable(&table, buffer, length - 1) == NULL);
+
+	for (int i = 0; i < NENTRIES; i += 2) {
+		const size_t length = makeKey(buffer, i);
+		assert(popBytesKeyHashTable(&table, buffer, length) == 1);
+		assert(popBytesKeyHashTable(&table, buffer, length) == 0);
+	}
+	assert(table.entries == NENTRIES / 2);
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		const size_t length = makeKey(buffer, i);
+		HashTableNode *node = getBytesKeyHashTable(&table, buffer, length);
+
+		if (i % 2 == 0) {
+			assert(node == NULL);
+		} else {
+			assert(node != NULL);
+			assert(i == 10 || *(int *)node->value == i);
+		}
+	}
+
+	freeHashTable(&table);
+}
+
+void testlruTable()
+{
+	lruTable table;
+	allocInitCapacitylruTable(&table, 64, 100, LRU_TABLE_POLICY_LRU);
+
+	char buffer[256];
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		const size_t length = makeKey(buffer, i);
+		lruTableNode *node = insertBytesKeylruTable(&table, buffer, length, newInt(i));
+		assert(node != NULL);
+
+		const BytesKey *key = getBytesKeylruTableNode(node);
+		assert(key->length == length);
+		assert(memcmp(key->bytes, buffer, length) == 0);
+	}
+	assert(table.entries == 100);
+
+	// Only the most recent ones remain.
+	for (int i = 0; i < NENTRIES; ++i) {
+		const size_t length = makeKey(buffer, i);
+		lruTableNode *node = getBytesKeylruTable(&table, buffer, length);
+
+		if (i < NENTRIES - 100) {
+			assert(node == NULL);
+		} else {
+			assert(node != NULL);
+			assert(*(int *)node->value == i);
+		}
+	}
+
+	for (int i = NENTRIES - 100; i < NENTRIES; i += 2) {
+		const size_t length = makeKey(buffer, i);
+		assert(popBytesKeylruTable(&table, buffer, length) == 1);
+		assert(popBytesKeylruTable(&table, buffer, length) == 0);
+	}
+	assert(table.entries == 50);
+
+	freelruTable(&table);
+}
+
+size_t serializeInt(const void *value, void *buffer, size_t size, void *arg)
+{
+	if (size >= sizeof(int))
+		memcpy(buffer, value, sizeof(int));
+	return sizeof(int);
+}
+
+void *deserializeInt(const void *buffer, size_t size, void *arg)
+{
+	assert(size == sizeof(int));
+	int *ret = malloc(sizeof(int));
+	memcpy(ret, buffer, sizeof(int));
+	return ret;
+}
+
+// The snapshots keep the key bytes.
+void testlruTableSnapshot()
+{
+	lruTable table;
+	allocInitCapacitylruTable(&table, 64, NENTRIES, LRU_TABLE_POLICY_LRU);
+
+	char buffer[256];
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		const size_t length = makeKey(buffer, i);
+		insertBytesKeylruTable(&table, buffer, length, newInt(i));
+	}
+
+	char filename[] = "/tmp/testBytesKey.XXXXXX";
+	const int fd = mkstemp(filename);
+	assert(fd >= 0);
+	close(fd);
+
+	assert(dumplruTable(&table, filename, serializeInt, NULL) == 0);
+	freelruTable(&table);
+
+	lruTable loaded;
+	allocInitCapacitylruTable(&loaded, 64, NENTRIES, LRU_TABLE_POLICY_LRU);
+	assert(loadlruTable(&loaded, filename, deserializeInt, NULL) == 0);
+	assert(loaded.entries == NENTRIES);
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		const size_t length = makeKey(buffer, i);
+		lruTableNode *node = getBytesKeylruTable(&loaded, buffer, length);
+		assert(node != NULL);
+		assert(*(int *)node->value == i);
+
+		const BytesKey *key = getBytesKeylruTableNode(node);
+		assert(key->length == length);
+		assert(memcmp(key->bytes, buffer, length) == 0);
+	}
+
+	freelruTable(&loaded);
+	unlink(filename);
+}
+
+// Two byte string keys with the same inline key evicted to the ghost lists.
+void testlruTableGhosts(lruTablePolicy policy)
+{
+	HashTable seen;
+	allocInitHashTable(&seen, 1 << 18);
+
+	char a[32], b[32];
+	size_t lengthA = 0, lengthB = 0;
+
+	for (int i = 0; lengthA == 0; ++i) {
+		lengthB = sprintf(b, "k%d", i);
+		const int key = (int) hashBytesKey(b, lengthB);
+
+		HashTableNode *node = getKeyHashTable(&seen, key);
+		if (node != NULL)
+			lengthA = sprintf(a, "k%d", *(int *)node->value);
+		else
+			insertKeyHashTable(&seen, key, newInt(i));
+	}
+	freeHashTable(&seen);
+
+	lruTable table;
+	allocInitPolicylruTable(&table, 4, policy);
+
+	char buffer[256];
+	const char *keys[2] = {a, b};
+	const size_t lengths[2] = {lengthA, lengthB};
+
+	// Both are evicted one after the other.
+	for (int k = 0; k < 2; ++k)
+		insertBytesKeylruTable(&table, keys[k], lengths[k], newInt(k));
+
+	for (int i = 0; i < 4; ++i) {
+		const size_t length = makeKey(buffer, i);
+		insertBytesKeylruTable(&table, buffer, length, newInt(i));
+	}
+
+	for (int k = 0; k < 2; ++k)
+		assert(getBytesKeylruTable(&table, keys[k], lengths[k]) == NULL);
+
+	freelruTable(&table);
+}
+
+void checkOrder(BinaryTreeNode *node, void *arg)
+{
+	const BytesKey **last = (const BytesKey **) arg;
+	const BytesKey *key = getBytesKeyBinaryTreeNode(node);
+
+	if (*last != NULL)
+		assert(compareBytesKey(*last, key) > 0);
+	*last = key;
+}
+
+int reverseCompare(const BytesKey *a, const BytesKey *b)
+{
+	return compareBytesKey(b, a);
+}
+
+void testBinaryTree()
+{
+	BinaryTree tree;
+	allocInitBinaryTree(&tree);
+	setCompareBinaryTree(&tree, reverseCompare);
+
+	char buffer[256];
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		const int k = (i * 7919) % NENTRIES;
+		const size_t length = makeKey(buffer, k);
+		assert(insertBytesKeyBinaryTree(&tree, buffer, length, newInt(k)) != NULL);
+	}
+	assert(tree.entries == NENTRIES);
+
+	const BytesKey *last = NULL;
+	dsfBinaryTree(&tree, checkOrder, &last);
+
+	// Remove nodes with zero, one and two children.
+	for (int i = 0; i < NENTRIES; i += 3) {
+		const size_t length = makeKey(buffer, i);
+		assert(popBytesKeyBinaryTree(&tree, buffer, length) == 1);
+		assert(popBytesKeyBinaryTree(&tree, buffer, length) == 0);
+	}
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		const size_t length = makeKey(buffer, i);
+		BinaryTreeNode *node = getBytesKeyBinaryTree(&tree, buffer, length);
+
+		if (i % 3 == 0) {
+			assert(node == NULL);
+		} else {
+			assert(node != NULL);
+			assert(*(int *)node->value == i);
+		}
+	}
+
+	last = NULL;
+	dsfBinaryTree(&tree, checkOrder, &last);
+
+	freeBinaryTree(&tree);
+}
+
+int main()
+{
+	testHash();
+	testHashTable();
+	testlruTable();
+	testlruTableSnapshot();
+	testlruTableGhosts(LRU_TABLE_POLICY_2Q);
+	testlruTableGhosts(LRU_TABLE_POLICY_ARC);
+	testBinaryTree();
+
+	return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include "c-container.h"
+
+#define NENTRIES 10
+
+// Static storage for a table without allocations.
+uint64_t buffer[
+	COMPACT_LRU_TABLE_BUFFER_SIZE(NENTRIES, NENTRIES, sizeof(double)) / sizeof(uint64_t) + 1
+];
+
+int main()
+{
+	CompactlruTable list;
+	allocInitCompactlruTable(&list, NENTRIES / 2, NENTRIES, sizeof(int));
+
+	// The int values and the links fit in 24 bytes per entry.
+	assert(list.nodeSize == 24);
+
+	// Fill the table
+	for (int i = 0; i < NENTRIES; ++i) {
+		int *value = insertKeyCompactlruTable(&list, i, &i);
+		assert(*value == i);
+	}
+	assert(list.entries == NENTRIES);
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		int *value = getKeyCompactlruTable(&list, i);
+		assert(value != NULL);
+		assert(*value == i);
+	}
+	assert(getKeyCompactlruTable(&list, NENTRIES * 10 + 1) == NULL);
+
+	// Access 0 so the next insertions evict 1 and 2
+	assert(getKeyCompactlruTable(&list, 0) != NULL);
+
+	for (int i = NENTRIES; i < NENTRIES + 2; ++i)
+		insertKeyCompactlruTable(&list, i, &i);
+
+	assert(list.entries == NENTRIES);
+	assert(getKeyCompactlruTable(&list, 0) != NULL);
+	assert(getKeyCompactlruTable(&list, 1) == NULL);
+	assert(getKeyCompactlruTable(&list, 2) == NULL);
+
+	// Update in place
+	const int update = -5;
+	insertKeyCompactlruTable(&list, 3, &update);
+	assert(*(int *)getKeyCompactlruTable(&list, 3) == update);
+	assert(list.entries == NENTRIES);
+
+	// Many evictions keep the latest keys only.
+	for (int i = 0; i < 100 * NENTRIES; ++i)
+		insertKeyCompactlruTable(&list, i, &i);
+
+	for (int i = 99 * NENTRIES; i < 100 * NENTRIES; ++i)
+		assert(*(int *)getKeyCompactlruTable(&list, i) == i);
+	assert(getKeyCompactlruTable(&list, 99 * NENTRIES - 1) == NULL);
+
+	// Access list order from the Least to the Most Recently used
+	size_t count = 0;
+	for (uint32_t it = list.accesList; it != COMPACT_LRU_TABLE_NIL; ++count) {
+		CompactlruTableNode *node =
+			(CompactlruTableNode *) (list.nodes + it * list.nodeSize);
+		assert(node->key == 99 * NENTRIES + (int) count);
+		it = node->right;
+	}
+	assert(count == NENTRIES);
+
+	freeCompactlruTable(&list);
+
+	// Static table in a caller provided block
+	CompactlruTable fixed;
+	initStaticCompactlruTable(&fixed, buffer, sizeof(buffer),
+	                          NENTRIES, NENTRIES, sizeof(double));
+	assert(fixed.nodeSize == 24);
+	assert((unsigned char *) fixed.nodes == (unsigned char *) buffer);
+
+	for (int i = 0; i < 2 * NENTRIES; ++i) {
+		const double value = i / 2.0;
+		insertKeyCompactlruTable(&fixed, i, &value);
+	}
+
+	for (int i = NENTRIES; i < 2 * NENTRIES; ++i)
+		assert(*(double *)getKeyCompactlruTable(&fixed, i) == i / 2.0);
+	assert(getKeyCompactlruTable(&fixed, NENTRIES - 1) == NULL);
+
+	freeCompactlruTable(&fixed);
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include "c-container.h"
+
+#define NENTRIES 100
+#define NTHREADS 4
+
+void copyfunc(const HashTableNode *node, void *arg)
+{
+	*(int *)arg = *(int *)node->value;
+}
+
+int *newInt(int value)
+{
+	int *ret = malloc(sizeof(int));
+	*ret = value;
+	return ret;
+}
+
+void *readerfunc(void *arg)
+{
+	ConcurrentHashTable *table = arg;
+	unsigned int seed = 1;
+
+	for (int i = 0; i < 100 * NENTRIES; ++i) {
+		const int key = rand_r(&seed) % (2 * NENTRIES);
+
+		int value = -1;
+		if (getKeyConcurrentHashTable(table, key, copyfunc, &value))
+			assert(value == key);
+	}
+
+	return NULL;
+}
+
+void *writerfunc(void *arg)
+{
+	ConcurrentHashTable *table = arg;
+	unsigned int seed = 2;
+
+	for (int i = 0; i < 20 * NENTRIES; ++i) {
+		const int key = rand_r(&seed) % (2 * NENTRIES);
+
+		if (rand_r(&seed) % 2)
+			insertKeyConcurrentHashTable(table, key, newInt(key));
+		else
+			popKeyConcurrentHashTable(table, key);
+	}
+
+	return NULL;
+}
+
+int main()
+{
+	ConcurrentHashTable table;
+	allocInitConcurrentHashTable(&table, NENTRIES / 4, 8);
+
+	// Single thread insert, update, get and pop.
+	for (int i = 0; i < NENTRIES; ++i)
+		insertKeyConcurrentHashTable(&table, i, newInt(i));
+	assert(table.entries == NENTRIES);
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		int value = -1;
+		assert(getKeyConcurrentHashTable(&table, i, copyfunc, &value) == 1);
+		assert(value == i);
+	}
+	assert(getKeyConcurrentHashTable(&table, NENTRIES * 10 + 1, NULL, NULL) == 0);
+
+	insertKeyConcurrentHashTable(&table, 5, newInt(-5));
+	assert(table.entries == NENTRIES);
+
+	int value = 0;
+	assert(getKeyConcurrentHashTable(&table, 5, copyfunc, &value) == 1);
+	assert(value == -5);
+
+	for (int i = 0; i < NENTRIES; i += 2)
+		assert(popKeyConcurrentHashTable(&table, i) == 1);
+	assert(popKeyConcurrentHashTable(&table, 0) == 0);
+	assert(table.entries == NENTRIES / 2);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		assert(getKeyConcurrentHashTable(&table, i, NULL, NULL) == i % 2);
+
+	// Concurrent readers and writers, the readers never see a wrong value.
+	insertKeyConcurrentHashTable(&table, 5, newInt(5));
+
+	pthread_t readers[NTHREADS], writers[NTHREADS];
+	for (size_t i = 0; i < NTHREADS; ++i) {
+		pthread_create(&readers[i], NULL, readerfunc, &table);
+		pthread_create(&writers[i], NULL, writerfunc, &table);
+	}
+
+	for (size_t i = 0; i < NTHREADS; ++i) {
+		pthread_join(readers[i], NULL);
+		pthread_join(writers[i], NULL);
+	}
+
+	size_t entries = 0;
+	for (int i = 0; i < 2 * NENTRIES; ++i)
+		entries += getKeyConcurrentHashTable(&table, i, NULL, NULL);
+	assert(entries == table.entries);
+
+	freeConcurrentHashTable(&table);
+
+	return 0;
+}
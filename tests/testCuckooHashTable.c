@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include "c-container.h"
+
+#define NENTRIES 1000
+
+int *newInt(int value)
+{
+	int *ret = malloc(sizeof(int));
+	*ret = value;
+	return ret;
+}
+
+int main()
+{
+	CuckooHashTable table;
+	allocInitCuckooHashTable(&table, 10);
+
+	assert(sizeof(CuckooHashTableBucket) == 64);
+	const size_t initialBuckets = table.nBuckets;
+
+	// Many more keys than the initial size, including negative ones. The
+	// displacements fill the table over 90% before growing.
+	for (int i = -NENTRIES; i < NENTRIES; ++i) {
+		const size_t entries = table.entries, nBuckets = table.nBuckets;
+
+		void **value = insertKeyCuckooHashTable(&table, i, newInt(i));
+		assert(value != NULL && *(int *)*value == i);
+
+		if (table.nBuckets != nBuckets)
+			assert(entries * 10 >= nBuckets * CUCKOO_HASH_TABLE_SLOTS * 9);
+	}
+	assert(table.entries == 2 * NENTRIES);
+	assert(table.nBuckets > initialBuckets);
+
+	for (int i = -NENTRIES; i < NENTRIES; ++i) {
+		void **value = getKeyCuckooHashTable(&table, i);
+		assert(value != NULL);
+		assert(*(int *)*value == i);
+	}
+	assert(getKeyCuckooHashTable(&table, NENTRIES * 10 + 1) == NULL);
+
+	// Update
+	insertKeyCuckooHashTable(&table, 7, newInt(-7));
+	assert(*(int *)*getKeyCuckooHashTable(&table, 7) == -7);
+	assert(table.entries == 2 * NENTRIES);
+
+	// Remove
+	for (int i = -NENTRIES; i < NENTRIES; i += 2)
+		assert(popKeyCuckooHashTable(&table, i) == 1);
+	assert(popKeyCuckooHashTable(&table, -NENTRIES) == 0);
+	assert(table.entries == NENTRIES);
+
+	for (int i = -NENTRIES; i < NENTRIES; ++i)
+		assert((getKeyCuckooHashTable(&table, i) != NULL) == (i % 2 != 0));
+
+	// Reinsert in the free slots without growing.
+	const size_t buckets = table.nBuckets;
+	for (int i = -NENTRIES; i < NENTRIES; i += 2)
+		insertKeyCuckooHashTable(&table, i, newInt(i));
+	assert(table.nBuckets == buckets);
+
+	for (int i = -NENTRIES; i < NENTRIES; ++i)
+		assert(*(int *)*getKeyCuckooHashTable(&table, i) == (i == 7 ? -7 : i));
+
+	freeCuckooHashTable(&table);
+
+	return 0;
+}
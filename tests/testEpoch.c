@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include "c-container.h"
+
+#define NTHREADS 4
+
+int released = 0;
+
+void countfree(void *ptr)
+{
+	__atomic_fetch_add(&released, 1, __ATOMIC_RELAXED);
+	free(ptr);
+}
+
+void *retirefunc(void *arg)
+{
+	EpochDomain *domain = arg;
+	EpochThread *thread = registerThreadEpochDomain(domain);
+
+	for (int i = 0; i < 10 * EPOCH_RETIRE_BATCH; ++i) {
+		enterEpochDomain(thread);
+		exitEpochDomain(thread);
+		retireEpochDomain(thread, malloc(16), countfree);
+	}
+
+	unregisterThreadEpochDomain(thread);
+
+	return NULL;
+}
+
+int main()
+{
+	EpochDomain domain;
+	allocInitEpochDomain(&domain);
+
+	EpochThread *thread = registerThreadEpochDomain(&domain);
+	assert(getThreadEpochDomain(&domain) == thread);
+
+	// A node retired while a reader is inside its critical section is kept.
+	int *node = malloc(sizeof(int));
+	enterEpochDomain(thread);
+	retireEpochDomain(thread, node, countfree);
+
+	for (int i = 0; i < 4; ++i)
+		assert(collectEpochThread(thread) == 1);
+	assert(released == 0);
+
+	exitEpochDomain(thread);
+
+	// Two epochs after the reader exit it is released.
+	collectEpochThread(thread);
+	collectEpochThread(thread);
+	assert(collectEpochThread(thread) == 0);
+	assert(released == 1);
+
+	// Hazard pointers keep the node after the critical section.
+	node = malloc(sizeof(int));
+	enterEpochDomain(thread);
+	protectEpochThread(thread, 0, node);
+	exitEpochDomain(thread);
+
+	retireEpochDomain(thread, node, countfree);
+	for (int i = 0; i < 4; ++i)
+		assert(collectEpochThread(thread) == 1);
+
+	releaseEpochThread(thread, 0);
+	assert(collectEpochThread(thread) == 0);
+	assert(released == 2);
+
+	// The batches are released automatically by many threads.
+	pthread_t threads[NTHREADS];
+	for (size_t i = 0; i < NTHREADS; ++i)
+		pthread_create(&threads[i], NULL, retirefunc, &domain);
+
+	for (size_t i = 0; i < NTHREADS; ++i)
+		pthread_join(threads[i], NULL);
+
+	assert(released > 2);
+
+	// The unregistered records are reused.
+	EpochThread *records = domain.threads;
+	size_t nRecords = 0;
+	for (; records != NULL; records = records->next)
+		++nRecords;
+	assert(nRecords <= NTHREADS + 1);
+
+	// Pending retired nodes are released on shutdown.
+	retireEpochDomain(thread, malloc(16), countfree);
+	unregisterThreadEpochDomain(thread);
+	freeEpochDomain(&domain);
+
+	assert(released == 2 + NTHREADS * 10 * EPOCH_RETIRE_BATCH + 1);
+
+	return 0;
+}
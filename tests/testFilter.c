@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include "c-container.h"
+
+#define NENTRIES 10000
+
+int *newInt(int value)
+{
+	int *ret = malloc(sizeof(int));
+	*ret = value;
+	return ret;
+}
+
+void testFilter(FilterType type, double maxRate)
+{
+	Filter filter;
+	allocInitFilter(&filter, type, NENTRIES);
+	setCountersFilter(&filter, 1);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		assert(insertKeyFilter(&filter, 2 * i) == 1);
+	assert(filter.entries == NENTRIES);
+	assert(!needsRebuildFilter(&filter));
+
+	// No false negatives
+	for (int i = 0; i < NENTRIES; ++i)
+		assert(containsKeyFilter(&filter, 2 * i));
+
+	size_t positives = 0;
+	for (int i = 0; i < NENTRIES; ++i)
+		positives += containsKeyFilter(&filter, 2 * i + 1);
+	assert(positives < maxRate * NENTRIES);
+	assert(filter.lookups == 2 * NENTRIES);
+	assert(filter.negatives == NENTRIES - positives);
+
+	// The lookups don't write to the filter without counters.
+	setCountersFilter(&filter, 0);
+	containsKeyFilter(&filter, 1);
+	assert(filter.lookups == 2 * NENTRIES);
+
+	// Removals
+	for (int i = 0; i < NENTRIES; i += 2)
+		removeKeyFilter(&filter, 2 * i);
+
+	for (int i = 1; i < NENTRIES; i += 2)
+		assert(containsKeyFilter(&filter, 2 * i));
+
+	if (type == FILTER_CUCKOO) {
+		assert(filter.entries == NENTRIES / 2);
+
+		positives = 0;
+		for (int i = 0; i < NENTRIES; i += 2)
+			positives += containsKeyFilter(&filter, 2 * i);
+		assert(positives < maxRate * NENTRIES);
+	} else {
+		assert(filter.stale == NENTRIES / 2);
+		assert(!needsRebuildFilter(&filter));
+		removeKeyFilter(&filter, 2);
+		assert(needsRebuildFilter(&filter));
+	}
+
+	// Over capacity
+	clearFilter(&filter, NENTRIES / 4);
+	assert(filter.entries == 0);
+
+	int full = 0;
+	for (int i = 0; i < NENTRIES; ++i)
+		full |= !insertKeyFilter(&filter, i);
+	assert(full);
+	assert(needsRebuildFilter(&filter));
+
+	for (int i = 0; i < NENTRIES; ++i)
+		assert(containsKeyFilter(&filter, i));
+
+	freeFilter(&filter);
+}
+
+void testHashTable(FilterType type)
+{
+	HashTable table;
+	allocInitHashTable(&table, 64);
+
+	for (int i = 0; i < NENTRIES / 2; ++i)
+		insertKeyHashTable(&table, i, newInt(i));
+
+	// Filled with the existing keys, and grows with the table.
+	setFilterHashTable(&table, type);
+	assert(table.filter != NULL);
+	assert(table.filter->capacity >= NENTRIES / 2);
+	setCountersFilter(table.filter, 1);
+
+	for (int i = NENTRIES / 2; i < NENTRIES; ++i)
+		insertKeyHashTable(&table, i, newInt(i));
+	rehashHashTable(&table, 1024);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		assert(*(int *) getKeyHashTable(&table, i)->value == i);
+
+	const size_t negatives = table.filter->negatives;
+	for (int i = NENTRIES; i < 2 * NENTRIES; ++i)
+		assert(getKeyHashTable(&table, i) == NULL);
+	assert(table.filter->negatives - negatives > NENTRIES * 0.9);
+
+	// Removals and churn (stale keys in the Bloom filter)
+	for (int i = 0; i < NENTRIES; ++i) {
+		assert(popKeyHashTable(&table, i) == 1);
+		assert(popKeyHashTable(&table, i) == 0);
+		insertKeyHashTable(&table, NENTRIES + i, newInt(i));
+	}
+	assert(table.entries == NENTRIES);
+	assert(table.filter->stale <= table.filter->capacity / 2);
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		assert(getKeyHashTable(&table, i) == NULL);
+		assert(getKeyHashTable(&table, NENTRIES + i) != NULL);
+	}
+
+	setFilterHashTable(&table, FILTER_NONE);
+	assert(table.filter == NULL);
+
+	setFilterHashTable(&table, type);
+	freeHashTable(&table);
+}
+
+void testlruTable(FilterType type)
+{
+	lruTable table;
+	allocInitCapacitylruTable(&table, 128, NENTRIES / 4, LRU_TABLE_POLICY_ARC);
+	setFilterlruTable(&table, type);
+	assert(table.filter->capacity == NENTRIES / 4);
+
+	// Evictions and ghosts remove and insert keys in the table.
+	for (int i = 0; i < NENTRIES; ++i)
+		insertKeylruTable(&table, i, newInt(i));
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		lruTableNode *node = getKeylruTable(&table, i);
+		assert(node == NULL || *(int *) node->value == i);
+		assert(node == NULL || i >= NENTRIES - NENTRIES / 4);
+	}
+
+	for (int i = NENTRIES - NENTRIES / 4; i < NENTRIES; ++i)
+		assert(getKeylruTable(&table, i) != NULL);
+
+	assert(popKeylruTable(&table, NENTRIES - 1) == 1);
+	assert(getKeylruTable(&table, NENTRIES - 1) == NULL);
+
+	freelruTable(&table);
+}
+
+void testBinaryTree(FilterType type)
+{
+	BinaryTree tree;
+	allocInitBinaryTree(&tree);
+	setFilterBinaryTree(&tree, type);
+
+	unsigned int seed = 1;
+	for (int i = 0; i < NENTRIES; ++i) {
+		const int key = rand_r(&seed) % (4 * NENTRIES);
+		insertBinaryTree(&tree, key, newInt(key));
+	}
+	assert(tree.filter->capacity >= tree.entries);
+
+	size_t entries = 0;
+	for (int i = 0; i < 4 * NENTRIES; ++i) {
+		BinaryTreeNode *node = getKeyBinaryTree(&tree, i);
+		if (node != NULL) {
+			assert(*(int *) node->value == i);
+			++entries;
+		}
+	}
+	assert(entries == tree.entries);
+
+	for (int i = 0; i < 4 * NENTRIES; i += 2)
+		popKeyBinaryTree(&tree, i);
+
+	for (int i = 0; i < 4 * NENTRIES; i += 2)
+		assert(getKeyBinaryTree(&tree, i) == NULL);
+
+	freeBinaryTree(&tree);
+}
+
+int main()
+{
+	testFilter(FILTER_BLOOM, 0.02);
+	testFilter(FILTER_CUCKOO, 0.005);
+
+	testHashTable(FILTER_BLOOM);
+	testHashTable(FILTER_CUCKOO);
+
+	testlruTable(FILTER_BLOOM);
+	testlruTable(FILTER_CUCKOO);
+
+	testBinaryTree(FILTER_BLOOM);
+	testBinaryTree(FILTER_CUCKOO);
+
+	return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include <string.h>
+#include <unistd.h>
+#include "c-container.h"
+
+#define NENTRIES 10000
+
+int *newInt(int value)
+{
+	int *ret = malloc(sizeof(int));
+	*ret = value;
+	return ret;
+}
+
+void patchFile(const char *filename, long offset, const void *data, size_t size)
+{
+	FILE *file = fopen(filename, "r+b");
+	assert(file != NULL);
+	assert(fseek(file, offset, SEEK_SET) == 0);
+	assert(fwrite(data, 1, size, file) == size);
+	assert(fclose(file) == 0);
+}
+
+void checkTable(const FrozenHashTable *table, size_t entries)
+{
+	assert(table->entries == entries);
+
+	// Minimal: every position has a different key.
+	for (size_t i = 0; i < table->entries; ++i) {
+		const int key = table->keys[i];
+		assert(key % 3 == 0);
+		assert(getKeyFrozenHashTable(table, key) == table->values + i * sizeof(int));
+	}
+
+	for (int i = 0; i < 3 * (int) entries; ++i) {
+		const int *value = getKeyFrozenHashTable(table, i);
+		if (i % 3 == 0) {
+			assert(value != NULL);
+			assert(*value == -i);
+		} else {
+			assert(value == NULL);
+		}
+	}
+
+	// Batched lookups
+	int keys[1000];
+	const void *values[1000];
+
+	for (int i = 0; i < 1000; ++i)
+		keys[i] = i;
+
+	const size_t expected = entries < 334 ? entries : 334;
+	assert(getKeysFrozenHashTable(table, keys, 1000, values) == expected);
+
+	for (int i = 0; i < 1000; ++i) {
+		assert(values[i] == getKeyFrozenHashTable(table, i));
+	}
+}
+
+// Byte string keys with the same inline key can't be frozen.
+void testRepeatedKeys()
+{
+	HashTable table;
+	allocInitHashTable(&table, 1 << 18);
+
+	char key[32];
+	for (int i = 0; i < 300000; ++i) {
+		const int length = sprintf(key, "k%d", i);
+		insertBytesKeyHashTable(&table, key, length, NULL);
+	}
+
+	FrozenHashTable frozen;
+	assert(freezeHashTable(&table, &frozen, sizeof(int)) == -1);
+	assert(frozen.entries == 0);
+	assert(getKeyFrozenHashTable(&frozen, 0) == NULL);
+
+	freeHashTable(&table);
+}
+
+int main()
+{
+	testRepeatedKeys();
+
+	const size_t sizes[] = {0, 1, 2, 7, NENTRIES};
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+		HashTable table;
+		allocInitHashTable(&table, 64);
+
+		for (int i = 0; i < 3 * (int) sizes[s]; i += 3)
+			insertKeyHashTable(&table, i, newInt(-i));
+
+		// Also with keys in the old table.
+		rehashHashTable(&table, 128);
+
+		FrozenHashTable frozen;
+		assert(freezeHashTable(&table, &frozen, sizeof(int)) == 0);
+		freeHashTable(&table);
+
+		checkTable(&frozen, sizes[s]);
+
+		if (sizes[s] == NENTRIES) {
+			const double bits = 8.0 * (frozen.nBuckets * sizeof(uint16_t)
+			                           + (frozen.nSlots - frozen.entries) * sizeof(uint32_t));
+			assert(bits / frozen.entries < 4);
+		}
+
+		// Dump and mmap
+		char filename[] = "/tmp/testFrozenHashTable.XXXXXX";
+		const int fd = mkstemp(filename);
+		assert(fd >= 0);
+		close(fd);
+
+		assert(dumpFrozenHashTable(&frozen, filename) == 0);
+		freeFrozenHashTable(&frozen);
+
+		FrozenHashTable mapped;
+		assert(openFrozenHashTable(&mapped, filename) == 0);
+		assert(mapped.mapped);
+		checkTable(&mapped, sizes[s]);
+
+		// A mapped table can be dumped again.
+		assert(dumpFrozenHashTable(&mapped, filename) == 0);
+		freeFrozenHashTable(&mapped);
+
+		assert(openFrozenHashTable(&mapped, filename) == 0);
+		checkTable(&mapped, sizes[s]);
+
+		// The header (64 bytes) has the sizes after the magic, version and
+		// entries. A number of buckets that wraps to the same layout size is
+		// still rejected.
+		const uint64_t nBuckets = mapped.nBuckets;
+		const uint64_t wrapped = nBuckets + ((uint64_t) 1 << 63);
+		const long remap = 64 + ((nBuckets * sizeof(uint16_t) + 63) & ~(uint64_t) 63);
+		freeFrozenHashTable(&mapped);
+
+		patchFile(filename, 16, &wrapped, sizeof(wrapped));
+		assert(openFrozenHashTable(&mapped, filename) == -1);
+		patchFile(filename, 16, &nBuckets, sizeof(nBuckets));
+
+		// A remapped slot out of the keys.
+		if (sizes[s] > 0) {
+			const uint32_t position = sizes[s];
+			patchFile(filename, remap, &position, sizeof(position));
+			assert(openFrozenHashTable(&mapped, filename) == -1);
+		}
+
+		// Truncated
+		assert(truncate(filename, 16) == 0);
+		assert(openFrozenHashTable(&mapped, filename) == -1);
+
+		unlink(filename);
+	}
+
+	FrozenHashTable missing;
+	assert(openFrozenHashTable(&missing, "/nonexistent/file") == -1);
+
+	return 0;
+}
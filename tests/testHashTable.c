@@ -72,6 +72,45 @@ int main()
 		}
 	}
 
+	{   // Incremental rehash
+		HashTable table;
+		allocInitHashTable(&table, 4);
+
+		for (int i = 0; i < 100; ++i) {
+			int *val = malloc(sizeof(int));
+			*val = i;
+			insertKeyHashTable(&table, i, val);
+		}
+
+		HashTableNode *node50 = getKeyHashTable(&table, 50);
+
+		rehashHashTable(&table, 37);
+		assert(table.N == 37);
+		assert(table.oldTable != NULL);
+
+		// Operations during the migration see all the keys
+		assert(popKeyHashTable(&table, 7) == 1);
+		assert(insertKeyHashTable(&table, 1000, NULL) != NULL);
+
+		for (int i = 0; i < 100; ++i) {
+			HashTableNode *node = getKeyHashTable(&table, i);
+			if (i == 7) {
+				assert(node == NULL);
+			} else {
+				assert(node != NULL);
+				assert(*(int *)node->value == i);
+			}
+		}
+
+		// The migration is completed and the nodes are the same.
+		assert(table.oldTable == NULL);
+		assert(getKeyHashTable(&table, 50) == node50);
+		assert(getKeyHashTable(&table, 1000) != NULL);
+		assert(table.entries == 100);
+
+		freeHashTable(&table);
+	}
+
 	freeHashTable(&list);
 
 	return 0;
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include "c-container.h"
+
+#define NBUCKETS 16
+#define NENTRIES 1000
+
+int *newInt(int value)
+{
+	int *ret = malloc(sizeof(int));
+	*ret = value;
+	return ret;
+}
+
+// The headers are full before any key goes to the overflow chain.
+void checkInvariants(InlineHashTable *table)
+{
+	size_t entries = 0;
+
+	for (size_t b = 0; b < table->N; ++b) {
+		const InlineHashTableBucket *bucket = &table->table[b];
+
+		for (int i = 0; i < INLINE_HASH_TABLE_SLOTS; ++i) {
+			if (!(bucket->used & (1 << i)))
+				continue;
+
+			++entries;
+			assert(bucket->nodes[i]->key == bucket->keys[i]);
+			assert((size_t) bucket->keys[i] % table->N == b);
+		}
+
+		if (bucket->overflow != NULL)
+			assert(bucket->used == (1 << INLINE_HASH_TABLE_SLOTS) - 1);
+
+		for (HashTableNode *it = bucket->overflow; it != NULL;
+		     it = (HashTableNode *) it->next) {
+			++entries;
+			assert((size_t) it->key % table->N == b);
+		}
+	}
+
+	assert(entries == table->entries);
+}
+
+int main()
+{
+	assert(sizeof(InlineHashTableBucket) == 64);
+
+	InlineHashTable table;
+	allocInitInlineHashTable(&table, NBUCKETS);
+
+	// Insert
+	for (int i = 0; i < NENTRIES; ++i) {
+		HashTableNode *node = insertKeyInlineHashTable(&table, i, newInt(i));
+		assert(node->key == i);
+		assert(*(int *) node->value == i);
+		assert(table.entries == (size_t) i + 1);
+	}
+	checkInvariants(&table);
+
+	// Update
+	HashTableNode *node = insertKeyInlineHashTable(&table, 7, newInt(-7));
+	assert(*(int *) node->value == -7);
+	assert(table.entries == NENTRIES);
+
+	// Get
+	for (int i = 0; i < NENTRIES; ++i) {
+		node = getKeyInlineHashTable(&table, i);
+		assert(node != NULL);
+		assert(node->key == i);
+		assert(*(int *) node->value == (i == 7 ? -7 : i));
+	}
+	assert(getKeyInlineHashTable(&table, NENTRIES) == NULL);
+	assert(getKeyInlineHashTable(&table, -1) == NULL);
+
+	// Remove the even keys, inline and overflow ones.
+	for (int i = 0; i < NENTRIES; i += 2)
+		assert(popKeyInlineHashTable(&table, i) == 1);
+	assert(popKeyInlineHashTable(&table, 0) == 0);
+	assert(table.entries == NENTRIES / 2);
+	checkInvariants(&table);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		assert((getKeyInlineHashTable(&table, i) != NULL) == (i % 2 == 1));
+
+	// Few keys per bucket fit in the headers.
+	for (int i = 1; i < NENTRIES; i += 2)
+		if (i >= NBUCKETS * 2)
+			assert(popKeyInlineHashTable(&table, i) == 1);
+	checkInvariants(&table);
+
+	for (size_t b = 0; b < table.N; ++b)
+		assert(table.table[b].overflow == NULL);
+
+	// Reinsert
+	for (int i = 0; i < NENTRIES; i += 2)
+		insertKeyInlineHashTable(&table, i, newInt(i));
+	checkInvariants(&table);
+
+	freeInlineHashTable(&table);
+	assert(table.entries == 0);
+
+	return 0;
+}
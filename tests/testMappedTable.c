@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include "c-container.h"
+
+#define NENTRIES 1000
+
+char *newString(int value)
+{
+	char *ret = malloc(32);
+	// Different lengths
+	snprintf(ret, 32, "value-%d%.*s", value, value % 7, "xxxxxxx");
+	return ret;
+}
+
+size_t serialize(const void *value, void *buffer, size_t size, void *arg)
+{
+	const size_t length = strlen(value) + 1;
+	if (length <= size)
+		memcpy(buffer, value, length);
+	return length;
+}
+
+void *deserialize(const void *buffer, size_t size, void *arg)
+{
+	++*(int *) arg;
+	return strdup(buffer);
+}
+
+void checkMapped(const MappedTable *table)
+{
+	assert(table->entries == NENTRIES);
+	assert(verifyMappedTable(table));
+
+	for (int i = -NENTRIES; i < 2 * NENTRIES; ++i) {
+		size_t size = 0;
+		const char *value = getKeyMappedTable(table, 2 * i, &size);
+
+		if (i < 0 || i >= NENTRIES) {
+			assert(value == NULL);
+			continue;
+		}
+
+		char *expected = newString(i);
+		assert(value != NULL);
+		assert(size == strlen(expected) + 1);
+		assert(strcmp(value, expected) == 0);
+		free(expected);
+
+		// Odd keys are not there.
+		assert(getKeyMappedTable(table, 2 * i + 1, NULL) == NULL);
+	}
+}
+
+void checkThaw(const MappedTable *table)
+{
+	int count = 0;
+
+	HashTable hash;
+	allocInitHashTable(&hash, 64);
+	thawMappedHashTable(table, &hash, deserialize, &count);
+	assert(hash.entries == NENTRIES);
+	assert(count == NENTRIES);
+
+	BinaryTree tree;
+	allocInitBinaryTree(&tree);
+	thawMappedBinaryTree(table, &tree, NULL, NULL);
+	assert(tree.entries == NENTRIES);
+
+	// Balanced
+	size_t depth = 0;
+	for (BinaryTreeNode *it = tree.tree; it != NULL; it = it->left)
+		++depth;
+	assert(depth <= 11);
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		char *expected = newString(i);
+		assert(strcmp(getKeyHashTable(&hash, 2 * i)->value, expected) == 0);
+		assert(strcmp(getKeyBinaryTree(&tree, 2 * i)->value, expected) == 0);
+		free(expected);
+	}
+
+	// The copies are mutable.
+	insertKeyHashTable(&hash, 1, newString(1));
+	insertBinaryTree(&tree, 1, newString(1));
+
+	freeHashTable(&hash);
+	freeBinaryTree(&tree);
+}
+
+int main()
+{
+	char filename[] = "/tmp/testMappedTable.XXXXXX";
+	const int fd = mkstemp(filename);
+	assert(fd >= 0);
+	close(fd);
+
+	HashTable hash;
+	allocInitHashTable(&hash, 64);
+
+	BinaryTree tree;
+	allocInitBinaryTree(&tree);
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		const int key = 2 * ((i * 7919) % NENTRIES);
+		insertKeyHashTable(&hash, key, newString(key / 2));
+		insertBinaryTree(&tree, key, newString(key / 2));
+	}
+
+	// Also with keys in the old table.
+	rehashHashTable(&hash, 100);
+
+	MappedTable table;
+
+	// Hash
+	assert(dumpMappedHashTable(&hash, filename, serialize, NULL) == 0);
+	assert(openMappedTable(&table, filename, 1) == 0);
+	assert(table.type == MAPPED_TABLE_HASH);
+	assert(table.nBuckets == 100);
+	assert((uintptr_t) table.records % 64 == 0);
+	checkMapped(&table);
+	checkThaw(&table);
+	freeMappedTable(&table);
+
+	// Tree
+	assert(dumpMappedBinaryTree(&tree, filename, serialize, NULL) == 0);
+	assert(openMappedTable(&table, filename, 1) == 0);
+	assert(table.type == MAPPED_TABLE_TREE);
+	checkMapped(&table);
+	checkThaw(&table);
+
+	// Replacing the file doesn't affect the current mapping.
+	assert(dumpMappedHashTable(&hash, filename, serialize, NULL) == 0);
+	checkMapped(&table);
+	freeMappedTable(&table);
+
+	// Corrupted references are ignored by the lookups without verification.
+	assert(dumpMappedHashTable(&hash, filename, serialize, NULL) == 0);
+	assert(openMappedTable(&table, filename, 0) == 0);
+
+	const unsigned char *map = table.map;
+	const long records = (const unsigned char *) table.records - map;
+	const long buckets = (const unsigned char *) table.buckets - map;
+	const int badKey = table.records[0].key;
+	const size_t badBucket = ((size_t) badKey + 1) % table.nBuckets;
+	freeMappedTable(&table);
+
+	FILE *file = fopen(filename, "r+b");
+	assert(file != NULL);
+	const uint64_t huge = UINT64_MAX - 1;
+	assert(fseek(file, records + offsetof(MappedTableRecord, offset), SEEK_SET) == 0);
+	assert(fwrite(&huge, sizeof(huge), 1, file) == 1);
+	assert(fseek(file, buckets + (badBucket + 1) * sizeof(uint64_t), SEEK_SET) == 0);
+	assert(fwrite(&huge, sizeof(huge), 1, file) == 1);
+	fclose(file);
+
+	assert(openMappedTable(&table, filename, 0) == 0);
+	assert(getKeyMappedTable(&table, badKey, NULL) == NULL);
+
+	size_t found = 0;
+	for (int i = 0; i < 2 * NENTRIES; ++i)
+		found += getKeyMappedTable(&table, i, NULL) != NULL;
+	assert(found < NENTRIES - 1);
+
+	HashTable thawed;
+	allocInitHashTable(&thawed, 64);
+	thawMappedHashTable(&table, &thawed, NULL, NULL);
+	assert(thawed.entries == NENTRIES - 1);
+	freeHashTable(&thawed);
+
+	assert(!verifyMappedTable(&table));
+	freeMappedTable(&table);
+
+	// Corrupted value
+	assert(dumpMappedHashTable(&hash, filename, serialize, NULL) == 0);
+	file = fopen(filename, "r+b");
+	assert(file != NULL);
+	assert(fseek(file, -3, SEEK_END) == 0);
+	fputc('#', file);
+	fclose(file);
+
+	assert(openMappedTable(&table, filename, 0) == 0);
+	assert(!verifyMappedTable(&table));
+	freeMappedTable(&table);
+	assert(openMappedTable(&table, filename, 1) == -1);
+
+	// Truncated
+	assert(truncate(filename, 100) == 0);
+	assert(openMappedTable(&table, filename, 0) == -1);
+
+	unlink(filename);
+	assert(openMappedTable(&table, filename, 0) == -1);
+
+	// Empty
+	BinaryTree empty;
+	allocInitBinaryTree(&empty);
+	assert(dumpMappedBinaryTree(&empty, filename, serialize, NULL) == 0);
+	assert(openMappedTable(&table, filename, 1) == 0);
+	assert(table.entries == 0);
+	assert(getKeyMappedTable(&table, 0, NULL) == NULL);
+	freeMappedTable(&table);
+	unlink(filename);
+
+	// Byte string keys are rejected
+	insertBytesKeyHashTable(&hash, "bytes", 5, NULL);
+	assert(dumpMappedHashTable(&hash, filename, serialize, NULL) == -1);
+
+	insertBytesKeyBinaryTree(&empty, "bytes", 5, NULL);
+	assert(dumpMappedBinaryTree(&empty, filename, serialize, NULL) == -1);
+	assert(access(filename, F_OK) != 0);
+
+	freeHashTable(&hash);
+	freeBinaryTree(&tree);
+	freeBinaryTree(&empty);
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include "c-container.h"
+
+#define NENTRIES 1000
+
+int *newInt(int value)
+{
+	int *ret = malloc(sizeof(int));
+	*ret = value;
+	return ret;
+}
+
+// Every key is reachable from its home without gaps and with the right distance.
+void checkInvariants(RobinHoodHashTable *table)
+{
+	size_t entries = 0;
+
+	for (size_t i = 0; i < table->N; ++i) {
+		const RobinHoodHashTableSlot *slot = &table->table[i];
+		if (slot->distance == 0)
+			continue;
+
+		++entries;
+		assert(getKeyRobinHoodHashTable(table, slot->key) == &slot->value);
+
+		// The previous slot can't be poorer than this one plus 1.
+		const RobinHoodHashTableSlot *prev = &table->table[(i + table->N - 1) % table->N];
+		if (slot->distance > 1)
+			assert(prev->distance + 1 >= slot->distance);
+	}
+
+	assert(entries == table->entries);
+}
+
+int main()
+{
+	RobinHoodHashTable table;
+	allocInitRobinHoodHashTable(&table, 10);
+
+	for (int i = -NENTRIES; i < NENTRIES; ++i) {
+		void **value = insertKeyRobinHoodHashTable(&table, i, newInt(i));
+		assert(value != NULL && *(int *)*value == i);
+	}
+	assert(table.entries == 2 * NENTRIES);
+	assert(table.entries * 10 <= table.N * 9);
+	checkInvariants(&table);
+
+	for (int i = -NENTRIES; i < NENTRIES; ++i)
+		assert(*(int *)*getKeyRobinHoodHashTable(&table, i) == i);
+	assert(getKeyRobinHoodHashTable(&table, NENTRIES * 10 + 1) == NULL);
+
+	// Update
+	insertKeyRobinHoodHashTable(&table, 7, newInt(-7));
+	assert(*(int *)*getKeyRobinHoodHashTable(&table, 7) == -7);
+	assert(table.entries == 2 * NENTRIES);
+
+	// Remove
+	for (int i = -NENTRIES; i < NENTRIES; i += 2)
+		assert(popKeyRobinHoodHashTable(&table, i) == 1);
+	assert(popKeyRobinHoodHashTable(&table, -NENTRIES) == 0);
+	assert(table.entries == NENTRIES);
+	checkInvariants(&table);
+
+	for (int i = -NENTRIES; i < NENTRIES; ++i)
+		assert((getKeyRobinHoodHashTable(&table, i) != NULL) == (i % 2 != 0));
+
+	// Churn doesn't leave tombstones: the empty slots are really empty.
+	unsigned int seed = 1;
+	for (int i = 0; i < 100 * NENTRIES; ++i) {
+		const int key = rand_r(&seed) % (4 * NENTRIES);
+		if (rand_r(&seed) % 2)
+			insertKeyRobinHoodHashTable(&table, key, newInt(key));
+		else
+			popKeyRobinHoodHashTable(&table, key);
+	}
+	checkInvariants(&table);
+
+	freeRobinHoodHashTable(&table);
+
+	return 0;
+}
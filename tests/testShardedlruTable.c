@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include <unistd.h>
+#include "c-container.h"
+
+#define NENTRIES 100
+#define NSHARDS 8
+#define NTHREADS 4
+
+void copyfunc(struct lruTableNode *node, void *arg)
+{
+	*(int *)arg = *(int *)node->value;
+}
+
+// Slow loader counting its calls, the value is the key or NULL when negative.
+int loads = 0;
+
+void *slowloader(int key, void *ctx)
+{
+	__atomic_fetch_add(&loads, 1, __ATOMIC_RELAXED);
+	usleep(20000);
+
+	if (key < 0)
+		return NULL;
+
+	int *val = malloc(sizeof(int));
+	*val = key;
+	return val;
+}
+
+size_t intWeigher(int key, void *value)
+{
+	return *(int *)value;
+}
+
+int destroyed = 0;
+pthread_t destroyer;
+
+void countDestroy(void *value)
+{
+	destroyer = pthread_self();
+	__atomic_fetch_add(&destroyed, 1, __ATOMIC_RELEASE);
+	free(value);
+}
+
+const ValueOps countedOps = {countDestroy, NULL};
+
+struct loadArgs {
+	ShardedlruTable *list;
+	int key;
+	int value;
+	int found;
+};
+
+void *loadfunc(void *arg)
+{
+	struct loadArgs *args = arg;
+	args->value = -1;
+	args->found = getOrLoadShardedlruTable(
+		args->list, args->key, slowloader, NULL, copyfunc, &args->value
+	);
+	return NULL;
+}
+
+int completed = 0;
+
+void completefunc(struct lruTableNode *node, void *arg)
+{
+	*(int *)arg = (node != NULL) ? *(int *)node->value : -1;
+	__atomic_fetch_add(&completed, 1, __ATOMIC_RELEASE);
+}
+
+void *threadfunc(void *arg)
+{
+	ShardedlruTable *list = arg;
+
+	for (int i = 0; i < 10 * NENTRIES; ++i) {
+		const int key = rand() % (2 * NENTRIES);
+
+		int value = -1;
+		if (getKeyShardedlruTable(list, key, copyfunc, &value)) {
+			assert(value == key);
+			continue;
+		}
+
+		int *val = malloc(sizeof(int));
+		*val = key;
+		insertKeyShardedlruTable(list, key, val);
+	}
+
+	return NULL;
+}
+
+int main()
+{
+	ShardedlruTable list;
+	allocInitShardedlruTable(&list, NSHARDS, NENTRIES);
+
+	// The capacity is split between all the shards.
+	size_t total = 0;
+	for (size_t i = 0; i < NSHARDS; ++i)
+		total += list.shards[i].maxEntries;
+	assert(total == NENTRIES);
+
+	// Insert the values and check them in a single thread.
+	for (int i = 0; i < NENTRIES / 2; ++i) {
+		int *val = malloc(sizeof(int));
+		*val = i;
+		insertKeyShardedlruTable(&list, i, val);
+	}
+
+	for (int i = 0; i < NENTRIES / 2; ++i) {
+		int value = -1;
+		assert(getKeyShardedlruTable(&list, i, copyfunc, &value) == 1);
+		assert(value == i);
+	}
+
+	assert(getKeyShardedlruTable(&list, NENTRIES * 10 + 1, NULL, NULL) == 0);
+
+	lruTableStats stats;
+	getStatsShardedlruTable(&list, &stats);
+	assert(stats.hits == NENTRIES / 2);
+	assert(stats.misses == 1);
+	assert(stats.inserts == NENTRIES / 2);
+
+	// No shard can hold more than its own capacity.
+	for (int i = NENTRIES / 2; i < 4 * NENTRIES; ++i) {
+		int *val = malloc(sizeof(int));
+		*val = i;
+		insertKeyShardedlruTable(&list, i, val);
+	}
+
+	for (size_t i = 0; i < NSHARDS; ++i)
+		assert(list.shards[i].entries == list.shards[i].maxEntries);
+
+	// The last inserted key is always there
+	assert(getKeyShardedlruTable(&list, 4 * NENTRIES - 1, NULL, NULL) == 1);
+
+	// Concurrent accesses
+	pthread_t threads[NTHREADS];
+	for (size_t i = 0; i < NTHREADS; ++i)
+		pthread_create(&threads[i], NULL, threadfunc, &list);
+
+	for (size_t i = 0; i < NTHREADS; ++i)
+		pthread_join(threads[i], NULL);
+
+	for (size_t i = 0; i < NSHARDS; ++i)
+		assert(list.shards[i].entries <= list.shards[i].maxEntries);
+
+	// Thundering herd on a missing key: a single load for all the threads.
+	struct loadArgs args[NTHREADS];
+	for (int key = 5 * NENTRIES; key >= -1; key -= 5 * NENTRIES + 1) {
+		loads = 0;
+		for (size_t i = 0; i < NTHREADS; ++i) {
+			args[i] = (struct loadArgs) {.list = &list, .key = key};
+			pthread_create(&threads[i], NULL, loadfunc, &args[i]);
+		}
+
+		for (size_t i = 0; i < NTHREADS; ++i) {
+			pthread_join(threads[i], NULL);
+			assert(args[i].found == (key >= 0));
+			assert(args[i].value == (key >= 0 ? key : -1));
+		}
+		assert(loads == 1);
+	}
+
+	// Loaded values are hits afterwards.
+	loads = 0;
+	assert(getOrLoadShardedlruTable(&list, 5 * NENTRIES, slowloader, NULL, NULL, NULL));
+	assert(loads == 0);
+
+	// Asynchronous loads share the load in flight as well.
+	int results[3];
+	for (int i = 0; i < 3; ++i)
+		getOrLoadAsyncShardedlruTable(
+			&list, 6 * NENTRIES, slowloader, NULL, completefunc, &results[i]
+		);
+
+	while (__atomic_load_n(&completed, __ATOMIC_ACQUIRE) < 3)
+		usleep(1000);
+
+	assert(loads == 1);
+	for (int i = 0; i < 3; ++i)
+		assert(results[i] == 6 * NENTRIES);
+
+	// Async hits complete immediately.
+	getOrLoadAsyncShardedlruTable(
+		&list, 6 * NENTRIES, slowloader, NULL, completefunc, &results[0]
+	);
+	assert(completed == 4);
+	assert(loads == 1);
+
+	{   // A loaded value too large to admit is released.
+		ShardedlruTable weighted;
+		allocInitShardedlruTable(&weighted, 1, NENTRIES);
+		setValueOpsShardedlruTable(&weighted, &countedOps);
+		weighted.shards[0].weigher = intWeigher;
+		weighted.shards[0].maxWeight = 100;
+
+		loads = 0;
+		assert(getOrLoadShardedlruTable(&weighted, 101, slowloader, NULL, NULL, NULL) == 0);
+		assert(loads == 1);
+		assert(destroyed == 1);
+		assert(weighted.shards[0].entries == 0);
+
+		freeShardedlruTable(&weighted);
+	}
+
+	// Background maintenance keeps the shards between the water marks.
+	startMaintenanceShardedlruTable(&list, 80, 50);
+
+	for (int i = 0; i < 10 * NENTRIES; ++i) {
+		int *val = malloc(sizeof(int));
+		*val = i;
+		insertKeyShardedlruTable(&list, 7 * NENTRIES + i, val);
+	}
+
+	for (int retry = 0; retry < 1000; ++retry) {
+		size_t above = 0;
+		for (size_t i = 0; i < NSHARDS; ++i) {
+			pthread_mutex_lock(&list.shards[i].lock);
+			above += (list.shards[i].entries > list.shards[i].highWater);
+			pthread_mutex_unlock(&list.shards[i].lock);
+		}
+		if (above == 0)
+			break;
+		usleep(1000);
+	}
+
+	for (size_t i = 0; i < NSHARDS; ++i)
+		assert(list.shards[i].entries <= list.shards[i].highWater);
+
+	// The newest key survives the maintenance.
+	assert(getKeyShardedlruTable(&list, 17 * NENTRIES - 1, NULL, NULL) == 1);
+
+	getStatsShardedlruTable(&list, &stats);
+	assert(stats.evictions > 0);
+
+	stopMaintenanceShardedlruTable(&list);
+	assert(list.maintenance == NULL);
+
+	{   // The replaced values are also released by the maintenance thread.
+		ShardedlruTable replaced;
+		allocInitShardedlruTable(&replaced, 1, NENTRIES);
+		setValueOpsShardedlruTable(&replaced, &countedOps);
+		startMaintenanceShardedlruTable(&replaced, 80, 50);
+
+		destroyed = 0;
+		for (int i = 0; i < 2; ++i) {
+			int *val = malloc(sizeof(int));
+			*val = i;
+			insertKeyShardedlruTable(&replaced, 0, val);
+		}
+
+		while (__atomic_load_n(&destroyed, __ATOMIC_ACQUIRE) == 0)
+			usleep(1000);
+		assert(!pthread_equal(destroyer, pthread_self()));
+
+		freeShardedlruTable(&replaced);
+		assert(destroyed == 2);
+	}
+
+	// The maintenance can start while other threads use the table, and
+	// leaving it running is also fine.
+	for (size_t i = 0; i < NTHREADS; ++i)
+		pthread_create(&threads[i], NULL, threadfunc, &list);
+
+	startMaintenanceShardedlruTable(&list, 90, 10);
+
+	for (size_t i = 0; i < NTHREADS; ++i)
+		pthread_join(threads[i], NULL);
+
+	// And the async loads in flight complete before the table is released.
+	completed = 0;
+	for (int i = 0; i < 3; ++i)
+		getOrLoadAsyncShardedlruTable(
+			&list, 8 * NENTRIES + i, slowloader, NULL, completefunc, &results[i]
+		);
+
+	freeShardedlruTable(&list);
+	assert(completed == 3);
+
+	return 0;
+}
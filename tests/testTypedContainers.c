@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include "c-container-typed.h"
+
+#define NENTRIES 10000
+
+typedef struct Point {
+	double x, y;
+} Point;
+
+DEFINE_HASH_TABLE_TYPED(PointHashTable, int64_t, Point, hashIntegerTyped, EQUAL_SCALAR_TYPED)
+
+DEFINE_BINARY_TREE_TYPED(PointBinaryTree, int64_t, Point, COMPARE_SCALAR_TYPED)
+
+void testHashTable()
+{
+	PointHashTable table;
+	allocInitPointHashTable(&table, 10);
+	assert(table.N == 16);
+
+	// Keys beyond the int range
+	const int64_t base = (int64_t) 1 << 40;
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		PointHashTableNode *node =
+			insertKeyPointHashTable(&table, base + i, (Point) {i, -i});
+		assert(node->key == base + i);
+	}
+	assert(table.entries == NENTRIES);
+	assert(table.N >= NENTRIES);
+
+	// Update
+	insertKeyPointHashTable(&table, base, (Point) {1, 1});
+	assert(table.entries == NENTRIES);
+	assert(getKeyPointHashTable(&table, base)->value.x == 1);
+
+	for (int i = 1; i < NENTRIES; ++i) {
+		PointHashTableNode *node = getKeyPointHashTable(&table, base + i);
+		assert(node != NULL);
+		assert(node->value.x == i && node->value.y == -i);
+	}
+	assert(getKeyPointHashTable(&table, 0) == NULL);
+
+	for (int i = 0; i < NENTRIES; i += 2) {
+		Point point;
+		assert(popKeyPointHashTable(&table, base + i, &point) == 1);
+		assert(i == 0 || point.y == -i);
+		assert(popKeyPointHashTable(&table, base + i, NULL) == 0);
+	}
+	assert(table.entries == NENTRIES / 2);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		assert((getKeyPointHashTable(&table, base + i) == NULL) == (i % 2 == 0));
+
+	freePointHashTable(&table);
+	assert(table.entries == 0);
+}
+
+void checkOrder(PointBinaryTreeNode *node, void *arg)
+{
+	int64_t *last = (int64_t *) arg;
+	assert(node->key > *last);
+	assert(node->value.x == node->key);
+	*last = node->key;
+}
+
+void testBinaryTree()
+{
+	PointBinaryTree tree;
+	allocInitPointBinaryTree(&tree);
+
+	for (int i = 0; i < NENTRIES; ++i) {
+		const int64_t key = (i * 7919) % NENTRIES;
+		insertKeyPointBinaryTree(&tree, key, (Point) {key, 0});
+	}
+	assert(tree.entries == NENTRIES);
+
+	int64_t last = -1;
+	dsfPointBinaryTree(&tree, checkOrder, &last);
+	assert(last == NENTRIES - 1);
+
+	// Remove nodes with zero, one and two children.
+	for (int i = 0; i < NENTRIES; i += 3) {
+		Point point;
+		assert(popKeyPointBinaryTree(&tree, i, &point) == 1);
+		assert(point.x == i);
+		assert(popKeyPointBinaryTree(&tree, i, NULL) == 0);
+	}
+
+	for (int i = 0; i < NENTRIES; ++i)
+		assert((getKeyPointBinaryTree(&tree, i) == NULL) == (i % 3 == 0));
+
+	last = -1;
+	dsfPointBinaryTree(&tree, checkOrder, &last);
+
+	freePointBinaryTree(&tree);
+	assert(tree.tree == NULL);
+}
+
+int main()
+{
+	testHashTable();
+	testBinaryTree();
+
+	return 0;
+}
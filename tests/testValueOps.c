@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2022  Jimmy Aguilar Mena
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifdef NDEBUG
+#error "Only Debug builds are supported"
+#endif
+
+#include <string.h>
+#include "c-container.h"
+
+#define NENTRIES 100
+
+// Values owned by the test (a "pool"), they must never be released.
+int pool[NENTRIES];
+
+int destroyed = 0;
+int cloned = 0;
+
+void countDestroy(void *value)
+{
+	++destroyed;
+	free(value);
+}
+
+void *countClone(const void *value)
+{
+	++cloned;
+	int *ret = malloc(sizeof(int));
+	*ret = *(const int *) value;
+	return ret;
+}
+
+const ValueOps countedOps = {countDestroy, countClone};
+
+void testLinkedList()
+{
+	LinkedList list;
+	allocInitLinkedList(&list);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		insertKeyLinkedList(&list, i, &pool[i]);
+
+	assert(getKeyLinkedList(&list, 5)->value == &pool[5]);
+	assert(popKeyLinkedList(&list, 5) == 1);
+	assert(popIndexLinkedList(&list, 0) == 1);
+	freeWithOpsLinkedList(&list, &borrowedValueOps);
+
+	// The list values are released with the ops given to the destructor.
+	destroyed = 0;
+	DoubleLinkedList dlist;
+	allocInitDoubleLinkedList(&dlist);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		insertKeyDoubleLinkedList(&dlist, i, countClone(&pool[i]));
+
+	DoubleLinkedListNode *node = getKeyDoubleLinkedList(&dlist, 7);
+	assert(*(int *) node->value == 7);
+
+	// The pops leave the values to the caller.
+	void *popped[2] = {node->value, getIndexDoubleLinkedList(&dlist, 0)->value};
+	assert(popKeyDoubleLinkedList(&dlist, 7) == 1);
+	assert(popIndexDoubleLinkedList(&dlist, 0) == 1);
+	assert(*(int *) popped[0] == 7 && *(int *) popped[1] == 0);
+	free(popped[0]);
+	free(popped[1]);
+
+	freeWithOpsDoubleLinkedList(&dlist, &countedOps);
+	assert(destroyed == NENTRIES - 2);
+}
+
+void testHashTable()
+{
+	HashTable table;
+	allocInitHashTable(&table, 8);
+	setValueOpsHashTable(&table, &borrowedValueOps);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		insertKeyHashTable(&table, i, &pool[i]);
+
+	// Update and rehash without releasing the borrowed values.
+	insertKeyHashTable(&table, 3, &pool[4]);
+	assert(getKeyHashTable(&table, 3)->value == &pool[4]);
+	rehashHashTable(&table, 64);
+
+	insertBytesKeyHashTable(&table, "key", 3, &pool[0]);
+	assert(popBytesKeyHashTable(&table, "key", 3) == 1);
+	assert(popKeyHashTable(&table, 5) == 1);
+
+	freeHashTable(&table);
+
+	// Owned values with custom functions.
+	destroyed = cloned = 0;
+	allocInitHashTable(&table, 8);
+	setValueOpsHashTable(&table, &countedOps);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		insertKeyHashTable(&table, i, &pool[i]);
+
+	insertKeyHashTable(&table, 3, &pool[4]);
+	assert(cloned == NENTRIES + 1);
+	assert(destroyed == 1);
+	assert(*(int *) getKeyHashTable(&table, 3)->value == 4);
+
+	assert(popKeyHashTable(&table, 5) == 1);
+	assert(destroyed == 2);
+
+	freeHashTable(&table);
+	assert(destroyed == NENTRIES + 1);
+}
+
+void testlruTable()
+{
+	lruTable table;
+	allocInitCapacitylruTable(&table, 16, 10, LRU_TABLE_POLICY_LRU);
+	setValueOpslruTable(&table, &borrowedValueOps);
+
+	// Evictions, updates, pops and free never release the values.
+	for (int i = 0; i < NENTRIES; ++i)
+		insertKeylruTable(&table, i, &pool[i]);
+
+	insertKeylruTable(&table, NENTRIES - 1, &pool[0]);
+	assert(getKeylruTable(&table, NENTRIES - 1)->value == &pool[0]);
+	assert(popKeylruTable(&table, NENTRIES - 2) == 1);
+
+	freelruTable(&table);
+
+	destroyed = cloned = 0;
+	allocInitCapacitylruTable(&table, 16, 10, LRU_TABLE_POLICY_LRU);
+	setValueOpslruTable(&table, &countedOps);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		insertKeylruTable(&table, i, &pool[i]);
+	assert(cloned == NENTRIES);
+	assert(destroyed == NENTRIES - 10);
+
+	freelruTable(&table);
+	assert(destroyed == NENTRIES);
+}
+
+void testShardedlruTable()
+{
+	// The values released by the maintenance thread use the ops too.
+	ShardedlruTable table;
+	allocInitShardedlruTable(&table, 4, 16);
+	setValueOpsShardedlruTable(&table, &borrowedValueOps);
+	startMaintenanceShardedlruTable(&table, 50, 25);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		insertKeyShardedlruTable(&table, i, &pool[i]);
+
+	stopMaintenanceShardedlruTable(&table);
+	freeShardedlruTable(&table);
+
+	destroyed = cloned = 0;
+	allocInitShardedlruTable(&table, 4, 16);
+	setValueOpsShardedlruTable(&table, &countedOps);
+	startMaintenanceShardedlruTable(&table, 50, 25);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		insertKeyShardedlruTable(&table, i, &pool[i]);
+
+	freeShardedlruTable(&table);
+	assert(cloned == NENTRIES);
+	assert(destroyed == NENTRIES);
+}
+
+void testBinaryTree()
+{
+	BinaryTree tree;
+	allocInitBinaryTree(&tree);
+	setValueOpsBinaryTree(&tree, &borrowedValueOps);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		insertBinaryTree(&tree, (i * 37) % NENTRIES, &pool[(i * 37) % NENTRIES]);
+
+	insertBinaryTree(&tree, 10, &pool[11]);
+	assert(getKeyBinaryTree(&tree, 10)->value == &pool[11]);
+
+	// Nodes with two children move their values.
+	for (int i = 0; i < NENTRIES; i += 3)
+		assert(popKeyBinaryTree(&tree, i) == 1);
+
+	assert(getKeyBinaryTree(&tree, 1)->value == &pool[1]);
+
+	freeBinaryTree(&tree);
+
+	destroyed = cloned = 0;
+	allocInitBinaryTree(&tree);
+	setValueOpsBinaryTree(&tree, &countedOps);
+
+	for (int i = 0; i < NENTRIES; ++i)
+		insertBinaryTree(&tree, (i * 37) % NENTRIES, &pool[(i * 37) % NENTRIES]);
+
+	for (int i = 0; i < NENTRIES; i += 3)
+		assert(popKeyBinaryTree(&tree, i) == 1);
+	assert(destroyed == (NENTRIES + 2) / 3);
+
+	freeBinaryTree(&tree);
+	assert(cloned == NENTRIES);
+	assert(destroyed == NENTRIES);
+}
+
+int main()
+{
+	for (int i = 0; i < NENTRIES; ++i)
+		pool[i] = i;
+
+	testLinkedList();
+	testHashTable();
+	testlruTable();
+	testShardedlruTable();
+	testBinaryTree();
+
+	// The values in the pool were never modified.
+	for (int i = 0; i < NENTRIES; ++i)
+		assert(pool[i] == i);
+
+	return 0;
+}
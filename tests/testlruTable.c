@@ -19,10 +19,132 @@
 #error "Only Debug builds are supported"
 #endif
 
+#include <string.h>
+#include <unistd.h>
 #include "c-container.h"
 
 #define NENTRIES 10
 
+size_t intWeigher(int key, void *value)
+{
+	return *(int *)value;
+}
+
+int *newInt(int value)
+{
+	int *ret = malloc(sizeof(int));
+	*ret = value;
+	return ret;
+}
+
+size_t serializeInt(const void *value, void *buffer, size_t size, void *arg)
+{
+	if (size >= sizeof(int))
+		memcpy(buffer, value, sizeof(int));
+	return sizeof(int);
+}
+
+void *deserializeInt(const void *buffer, size_t size, void *arg)
+{
+	assert(size == sizeof(int));
+	int *ret = malloc(sizeof(int));
+	memcpy(ret, buffer, sizeof(int));
+	return ret;
+}
+
+int isEven(const struct lruTableNode *node, void *ctx)
+{
+	++*(int *)ctx;
+	return node->key % 2 == 0;
+}
+
+void patchFile(const char *filename, long offset, const void *data, size_t size)
+{
+	FILE *file = fopen(filename, "r+b");
+	assert(file != NULL);
+	assert(fseek(file, offset, SEEK_SET) == 0);
+	assert(fwrite(data, 1, size, file) == size);
+	assert(fclose(file) == 0);
+}
+
+void *loader(int key, void *ctx)
+{
+	++*(int *)ctx;
+	return key >= 0 ? newInt(key) : NULL;
+}
+
+int destroyed = 0;
+
+void countDestroy(void *value)
+{
+	++destroyed;
+	free(value);
+}
+
+const ValueOps countedOps = {countDestroy, NULL};
+
+void evictfunc(int key, void *value, lruTableRemovalCause cause, void *arg)
+{
+	int *counter = arg;
+	assert(*(int *)value == key);
+	assert(cause == LRU_TABLE_EVICTED);
+	++*counter;
+	free(value);
+}
+
+void batchfunc(const lruTableVictim *victims, size_t n, void *arg)
+{
+	size_t *batches = arg;
+	assert(n <= 4);
+
+	for (size_t i = 0; i < n; ++i) {
+		assert(*(int *)victims[i].value == victims[i].key);
+		free(victims[i].value);
+	}
+	batches[n]++;
+}
+
+// Number of keys of a hot set that survive a scan of one-off keys.
+size_t hotKeysAfterScan(lruTablePolicy policy)
+{
+	const int capacity = 100, hot = 50;
+
+	lruTable table;
+	allocInitPolicylruTable(&table, capacity, policy);
+
+	// Warm up the hot keys mixed with some noise, like a real cache does.
+	int noise = 1000;
+	for (int round = 0; round < 10; ++round) {
+		for (int key = 0; key < hot; ++key) {
+			if (getKeylruTable(&table, key) == NULL)
+				insertKeylruTable(&table, key, NULL);
+		}
+
+		for (int i = 0; i < capacity / 2; ++i, ++noise)
+			insertKeylruTable(&table, noise, NULL);
+	}
+
+	for (int key = 0; key < hot; ++key) {
+		if (getKeylruTable(&table, key) == NULL)
+			insertKeylruTable(&table, key, NULL);
+	}
+
+	// The scan of one-off keys.
+	for (int i = 0; i < 10 * capacity; ++i, ++noise) {
+		assert(getKeylruTable(&table, noise) == NULL);
+		insertKeylruTable(&table, noise, NULL);
+		assert(table.entries <= table.maxEntries);
+	}
+
+	size_t count = 0;
+	for (int key = 0; key < hot; ++key)
+		count += (getKeylruTable(&table, key) != NULL);
+
+	freelruTable(&table);
+
+	return count;
+}
+
 int main()
 {
 	size_t values[2*NENTRIES];
@@ -95,5 +217,395 @@ int main()
 
 	freelruTable(&list);
 
+	{   // CLOCK policy: hits set the reference bit but don't reorder the list.
+		lruTable clock;
+		allocInitPolicylruTable(&clock, 4, LRU_TABLE_POLICY_CLOCK);
+
+		for (int i = 0; i < 4; ++i) {
+			int *val = malloc(sizeof(int));
+			*val = i;
+			insertKeylruTable(&clock, i, val);
+		}
+
+		assert(getKeylruTable(&clock, 0)->referenced == 1);
+		assert(getKeylruTable(&clock, 2)->referenced == 1);
+		assert(clock.accesList->key == 0);
+		assert(clock.lastAccess->key == 3);
+
+		// 0 gets a second chance, so 1 is evicted.
+		insertKeylruTable(&clock, 4, malloc(sizeof(int)));
+		assert(getKeylruTable(&clock, 1) == NULL);
+		assert(clock.entries == 4);
+
+		// Now the hand is in 2 which gets a second chance, so 3 is evicted.
+		insertKeylruTable(&clock, 5, malloc(sizeof(int)));
+		assert(getKeylruTable(&clock, 3) == NULL);
+
+		for (int i = 0; i < 6; ++i) {
+			if (i == 1 || i == 3)
+				continue;
+			assert(getKeylruTable(&clock, i) != NULL);
+		}
+
+		freelruTable(&clock);
+	}
+
+	{   // Weighted capacity: the value is its own weight.
+		lruTable weighted;
+		allocInitWeightedlruTable(&weighted, NENTRIES, 100, intWeigher);
+
+		assert(insertKeylruTable(&weighted, 0, newInt(30)) != NULL);
+		assert(insertKeylruTable(&weighted, 1, newInt(30)) != NULL);
+		assert(insertKeylruTable(&weighted, 2, newInt(30)) != NULL);
+		assert(weighted.weight == 90);
+
+		// One insertion evicts the two least recently used.
+		assert(insertKeylruTable(&weighted, 3, newInt(50)) != NULL);
+		assert(weighted.entries == 2);
+		assert(weighted.weight == 80);
+		assert(getKeylruTable(&weighted, 0) == NULL);
+		assert(getKeylruTable(&weighted, 1) == NULL);
+
+		// Too large to admit, the caller keeps the value.
+		int *large = newInt(101);
+		assert(insertKeylruTable(&weighted, 4, large) == NULL);
+		assert(getKeylruTable(&weighted, 4) == NULL);
+		assert(weighted.weight == 80);
+
+		// A rejected update removes the stale node.
+		assert(insertWeightlruTable(&weighted, 2, large, 101) == NULL);
+		assert(getKeylruTable(&weighted, 2) == NULL);
+		assert(weighted.weight == 50);
+		free(large);
+
+		// Growing an existing node evicts others but never itself.
+		assert(insertKeylruTable(&weighted, 5, newInt(40)) != NULL);
+		lruTableNode *node = insertKeylruTable(&weighted, 3, newInt(90));
+		assert(node != NULL);
+		assert(node->weight == 90);
+		assert(getKeylruTable(&weighted, 5) == NULL);
+		assert(weighted.entries == 1);
+		assert(weighted.weight == 90);
+
+		freelruTable(&weighted);
+	}
+
+	{   // Expiration with the timer wheel
+		lruTable ttl;
+		allocInitlruTable(&ttl, NENTRIES);
+
+		assert(expirelruTable(&ttl, 100) == 0);
+
+		insertTTLlruTable(&ttl, 1, newInt(1), 5);          // level 0
+		insertTTLlruTable(&ttl, 2, newInt(2), 100);        // level 1
+		insertTTLlruTable(&ttl, 3, newInt(3), 5000);       // level 2
+		insertKeylruTable(&ttl, 4, newInt(4));             // never
+		insertTTLlruTable(&ttl, 5, newInt(5), 1000000000); // beyond the wheel range
+
+		assert(expirelruTable(&ttl, 104) == 0);
+		assert(getKeylruTable(&ttl, 1) != NULL);
+		assert(expirelruTable(&ttl, 105) == 1);
+		assert(getKeylruTable(&ttl, 1) == NULL);
+		assert(ttl.entries == 4);
+
+		// Updating a key resets the expiration time.
+		insertTTLlruTable(&ttl, 2, newInt(2), 1000);
+		assert(expirelruTable(&ttl, 1000) == 0);
+		assert(getKeylruTable(&ttl, 2) != NULL);
+
+		assert(expirelruTable(&ttl, 5100) == 2);
+		assert(getKeylruTable(&ttl, 2) == NULL);
+		assert(getKeylruTable(&ttl, 3) == NULL);
+
+		// Default TTL
+		ttl.defaultTTL = 10;
+		insertKeylruTable(&ttl, 6, newInt(6));
+		assert(expirelruTable(&ttl, 5109) == 0);
+		assert(expirelruTable(&ttl, 5110) == 1);
+		assert(getKeylruTable(&ttl, 6) == NULL);
+
+		// Evicted nodes don't keep their timers
+		for (int i = 10; i < 10 + NENTRIES; ++i)
+			insertKeylruTable(&ttl, i, newInt(i));
+		assert(getKeylruTable(&ttl, 5) == NULL);
+		assert(ttl.entries == NENTRIES);
+
+		assert(expirelruTable(&ttl, 1000000000 + 100) == NENTRIES);
+		assert(getKeylruTable(&ttl, 4) == NULL);
+		assert(ttl.entries == 0);
+
+		// Only the nodes with a TTL hold a timer.
+		ttl.defaultTTL = 0;
+		assert(insertKeylruTable(&ttl, 7, newInt(7))->timer == NULL);
+		assert(insertTTLlruTable(&ttl, 8, newInt(8), 10)->timer != NULL);
+		assert(insertKeylruTable(&ttl, 8, newInt(8))->timer == NULL);
+		assert(expirelruTable(&ttl, 1000000000 + 200) == 0);
+
+		// The pending timers are released with the table.
+		insertTTLlruTable(&ttl, 9, newInt(9), 10);
+
+		freelruTable(&ttl);
+	}
+
+	{   // Capacity independent of the buckets and resize.
+		lruTable sized;
+		allocInitCapacitylruTable(&sized, 4, 100, LRU_TABLE_POLICY_LRU);
+
+		for (int i = 0; i < 100; ++i)
+			insertKeylruTable(&sized, i, newInt(i));
+		assert(sized.entries == 100);
+		assert(sized.N == 4);
+
+		// Shrink evicts the least recently used keys
+		getKeylruTable(&sized, 0);
+		resizelruTable(&sized, 10);
+		assert(sized.entries == 10);
+		assert(getKeylruTable(&sized, 0) != NULL);
+		assert(getKeylruTable(&sized, 90) == NULL);
+		for (int i = 91; i < 100; ++i)
+			assert(getKeylruTable(&sized, i) != NULL);
+
+		// Grow keeps the entries and rehashes in the background.
+		resizelruTable(&sized, 1000);
+		assert(sized.N == 1000);
+		for (int i = 0; i < 1000; ++i)
+			insertKeylruTable(&sized, 1000 + i, newInt(i));
+		assert(sized.entries == 1000);
+		assert(sized.oldTable == NULL);
+		assert(getKeylruTable(&sized, 1000) != NULL);
+
+		freelruTable(&sized);
+	}
+
+	{   // Statistics and eviction callbacks
+		lruTable stats;
+		allocInitlruTable(&stats, NENTRIES);
+
+		int evicted = 0;
+		setEvictionCallbacklruTable(&stats, evictfunc, &evicted);
+
+		for (int i = 0; i < 2 * NENTRIES; ++i)
+			insertKeylruTable(&stats, i, newInt(i));
+		assert(evicted == NENTRIES);
+
+		insertKeylruTable(&stats, 2 * NENTRIES - 1, newInt(2 * NENTRIES - 1));
+		assert(getKeylruTable(&stats, 0) == NULL);
+		assert(getKeylruTable(&stats, NENTRIES) != NULL);
+
+		lruTableStats counters;
+		getStatslruTable(&stats, &counters);
+		assert(counters.inserts == 2 * NENTRIES);
+		assert(counters.updates == 1);
+		assert(counters.evictions == NENTRIES);
+		assert(counters.hits == 1);
+		assert(counters.misses == 1);
+
+		// Batched victims: 7 evictions in batches of 4 plus the flush of 3.
+		size_t batches[5] = {0};
+		setBatchEvictionCallbacklruTable(&stats, batchfunc, 4, batches);
+
+		for (int i = 0; i < 7; ++i)
+			insertKeylruTable(&stats, 100 + i, newInt(100 + i));
+		assert(batches[4] == 1);
+		assert(stats.nVictims == 3);
+
+		flushEvictionslruTable(&stats);
+		assert(batches[3] == 1);
+		assert(stats.nVictims == 0);
+
+		resizelruTable(&stats, 2);
+		assert(batches[4] == 3);
+
+		freelruTable(&stats);
+	}
+
+	{   // Explicit removal and purge
+		for (int policy = LRU_TABLE_POLICY_LRU; policy <= LRU_TABLE_POLICY_TINYLFU; ++policy) {
+			lruTable removed;
+			allocInitPolicylruTable(&removed, NENTRIES, policy);
+
+			for (int i = 0; i < NENTRIES; ++i)
+				insertKeylruTable(&removed, i, newInt(i));
+
+			assert(popKeylruTable(&removed, 3) == 1);
+			assert(popKeylruTable(&removed, 3) == 0);
+			assert(peeklruTable(&removed, 3) == NULL);
+			assert(removed.entries == NENTRIES - 1);
+
+			// The predicate is called once per node.
+			int calls = 0;
+			assert(purgelruTable(&removed, isEven, &calls) == NENTRIES / 2);
+			assert(calls == NENTRIES - 1);
+			assert(removed.entries == NENTRIES / 2 - 1);
+
+			for (lruTableNode *it = removed.accesList; it != NULL; it = it->right)
+				assert(it->key % 2 == 1);
+
+			for (int i = 0; i < NENTRIES; ++i)
+				assert((peeklruTable(&removed, i) != NULL) == (i % 2 == 1 && i != 3));
+
+			// The removed nodes are reused.
+			lruTableNode *reused = removed.freeNodes;
+			assert(reused != NULL);
+			assert(insertKeylruTable(&removed, 3, newInt(3)) == reused);
+
+			lruTableStats counters;
+			getStatslruTable(&removed, &counters);
+			assert(counters.removals == NENTRIES / 2 + 1);
+
+			// Evict in advance
+			const size_t entries = removed.entries;
+			assert(evictlruTable(&removed, 2) == 2);
+			assert(removed.entries == entries - 2);
+			assert(evictlruTable(&removed, 10 * NENTRIES) == entries - 2);
+			assert(removed.entries == 0);
+
+			freelruTable(&removed);
+		}
+	}
+
+	{   // Snapshot and reload keeps the recency order
+		char filename[] = "/tmp/testlruTableXXXXXX";
+		const int fd = mkstemp(filename);
+		assert(fd >= 0);
+		close(fd);
+
+		for (int policy = LRU_TABLE_POLICY_LRU; policy <= LRU_TABLE_POLICY_TINYLFU; ++policy) {
+			lruTable saved;
+			allocInitPolicylruTable(&saved, NENTRIES, policy);
+			for (int i = 0; i < 2 * NENTRIES; ++i) {
+				insertKeylruTable(&saved, i % (NENTRIES + 5), newInt(i));
+				getKeylruTable(&saved, i / 3);
+			}
+			assert(dumplruTable(&saved, filename, serializeInt, NULL) == 0);
+
+			lruTable loaded;
+			allocInitPolicylruTable(&loaded, NENTRIES, policy);
+			assert(loadlruTable(&loaded, filename, deserializeInt, NULL) == 0);
+			assert(loaded.entries == saved.entries);
+
+			lruTableNode *it1 = saved.accesList, *it2 = loaded.accesList;
+			for (; it1 != NULL; it1 = it1->right, it2 = it2->right) {
+				assert(it2 != NULL && it1->key == it2->key);
+				assert(*(int *)it1->value == *(int *)it2->value);
+			}
+			assert(it2 == NULL);
+
+			// A smaller table keeps only the most recent entries
+			lruTable small;
+			allocInitPolicylruTable(&small, NENTRIES / 4, LRU_TABLE_POLICY_LRU);
+			assert(loadlruTable(&small, filename, deserializeInt, NULL) == 0);
+			assert(small.entries == NENTRIES / 4);
+			assert(small.lastAccess->key == saved.lastAccess->key);
+
+			freelruTable(&small);
+			freelruTable(&loaded);
+			freelruTable(&saved);
+		}
+
+		lruTable empty;
+		allocInitlruTable(&empty, NENTRIES);
+		assert(loadlruTable(&empty, "/nonexistent/file", deserializeInt, NULL) == -1);
+		freelruTable(&empty);
+
+		// Corrupt snapshots with the header (24 bytes) and two records of
+		// 21 bytes: key, segment, deadline, size and the int value.
+		for (int corruption = 0; corruption < 2; ++corruption) {
+			lruTable saved;
+			allocInitPolicylruTable(&saved, NENTRIES, LRU_TABLE_POLICY_2Q);
+			insertKeylruTable(&saved, 1, newInt(1));
+			insertKeylruTable(&saved, 2, newInt(2));
+			assert(dumplruTable(&saved, filename, serializeInt, NULL) == 0);
+			freelruTable(&saved);
+
+			if (corruption == 0) {
+				// The second record repeats the key of the first one.
+				const int32_t key = 1;
+				patchFile(filename, 24 + 21, &key, sizeof(key));
+			} else {
+				// Live nodes can't be in a ghost segment.
+				const uint8_t segment = 3;
+				patchFile(filename, 24 + 21 + sizeof(int32_t), &segment, sizeof(segment));
+			}
+
+			lruTable loaded;
+			allocInitPolicylruTable(&loaded, NENTRIES, LRU_TABLE_POLICY_2Q);
+			assert(loadlruTable(&loaded, filename, deserializeInt, NULL) == -1);
+			assert(loaded.entries == 1);
+			freelruTable(&loaded);
+		}
+
+		unlink(filename);
+	}
+
+	{   // Load on miss only
+		lruTable loaded;
+		allocInitlruTable(&loaded, NENTRIES);
+
+		int calls = 0;
+		lruTableNode *node = getOrLoadlruTable(&loaded, 3, loader, &calls);
+		assert(node != NULL && *(int *)node->value == 3);
+		assert(getOrLoadlruTable(&loaded, 3, loader, &calls) == node);
+		assert(calls == 1);
+
+		assert(getOrLoadlruTable(&loaded, -1, loader, &calls) == NULL);
+		assert(calls == 2);
+		assert(loaded.entries == 1);
+
+		freelruTable(&loaded);
+
+		// A loaded value too large to admit is released.
+		lruTable weighted;
+		allocInitWeightedlruTable(&weighted, NENTRIES, 100, intWeigher);
+		setValueOpslruTable(&weighted, &countedOps);
+
+		assert(getOrLoadlruTable(&weighted, 101, loader, &calls) == NULL);
+		assert(calls == 3);
+		assert(destroyed == 1);
+		assert(weighted.entries == 0);
+
+		freelruTable(&weighted);
+	}
+
+	{   // Peek and read buffer don't modify the access list immediately.
+		lruTable buffered;
+		allocInitlruTable(&buffered, NENTRIES);
+
+		for (int i = 0; i < NENTRIES; ++i)
+			insertKeylruTable(&buffered, i, newInt(i));
+
+		assert(peeklruTable(&buffered, 0) != NULL);
+		assert(peeklruTable(&buffered, NENTRIES) == NULL);
+		assert(buffered.accesList->key == 0);
+
+		setReadBufferlruTable(&buffered, 4);
+		assert(getKeylruTable(&buffered, 0) != NULL);
+		assert(getKeylruTable(&buffered, 1) != NULL);
+		assert(buffered.readBufferEntries == 2);
+		assert(buffered.accesList->key == 0);
+
+		// The insertion applies the pending accesses first, so 2 is evicted.
+		insertKeylruTable(&buffered, NENTRIES, newInt(NENTRIES));
+		assert(buffered.readBufferEntries == 0);
+		assert(peeklruTable(&buffered, 2) == NULL);
+		assert(buffered.accesList->key == 3);
+
+		// Full buffer is drained automatically.
+		for (int i = 3; i < 7; ++i)
+			assert(getKeylruTable(&buffered, i) != NULL);
+		assert(buffered.readBufferEntries == 0);
+		assert(buffered.accesList->key == 7);
+		assert(buffered.lastAccess->key == 6);
+
+		freelruTable(&buffered);
+	}
+
+	// The scan flushes the hot keys with LRU, but not with the scan resistant
+	// policies.
+	assert(hotKeysAfterScan(LRU_TABLE_POLICY_LRU) == 0);
+	assert(hotKeysAfterScan(LRU_TABLE_POLICY_2Q) >= 40);
+	assert(hotKeysAfterScan(LRU_TABLE_POLICY_ARC) >= 40);
+	assert(hotKeysAfterScan(LRU_TABLE_POLICY_TINYLFU) >= 40);
+
 	return 0;
 }